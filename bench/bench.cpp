@@ -0,0 +1,108 @@
+#include "bench.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+
+// NOLINTBEGIN
+
+namespace {
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> allocated_bytes{0};
+
+void* counted_alloc(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+} // namespace
+
+void* operator new(size_t size) { return counted_alloc(size); }
+void* operator new[](size_t size) { return counted_alloc(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+
+// NOLINTEND
+
+namespace mcpp::bench {
+
+uint64_t alloc_count() { return allocations.load(std::memory_order_relaxed); }
+
+uint64_t alloc_bytes() { return allocated_bytes.load(std::memory_order_relaxed); }
+
+Runner::Runner(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.rfind("--filter=", 0) == 0) {
+      _filter = arg.substr(9);
+    } else if (arg.rfind("--json=", 0) == 0) {
+      _json_path = arg.substr(7);
+    } else if (arg.rfind("--min-time=", 0) == 0) {
+      try {
+        _min_time_s = std::stod(arg.substr(11));
+      } catch (const std::logic_error&) {
+        // std::stod throws invalid_argument or out_of_range
+        throw std::invalid_argument("Invalid number in argument: " + arg);
+      }
+      if (!(_min_time_s >= 0)) {
+        throw std::invalid_argument("--min-time= must not be negative");
+      }
+    } else {
+      throw std::invalid_argument("Unknown argument: " + arg +
+                                  " (expected --filter=, --json= or --min-time=)");
+    }
+  }
+  print_header();
+}
+
+Runner::Runner(double min_time_s) : _min_time_s(min_time_s) { print_header(); }
+
+void Runner::print_header() {
+  std::printf("%-40s %14s %12s %12s %14s\n", "benchmark", "ns/op", "bytes/op", "allocs/op",
+              "alloc B/op");
+}
+
+bool Runner::selected(const std::string& name) const {
+  return _filter.empty() || name.find(_filter) != std::string::npos;
+}
+
+void Runner::report(const Result& result) {
+  std::printf("%-40s %14.1f %12.0f %12.2f %14.1f\n", result.name.c_str(), result.ns_per_op,
+              result.bytes_per_op, result.allocs_per_op, result.alloc_bytes_per_op);
+  std::fflush(stdout);
+  _results.push_back(result);
+}
+
+int Runner::finish() const {
+  if (!_json_path.empty()) {
+    write_json(_results, _json_path);
+  }
+  return 0;
+}
+
+void write_json(const std::vector<Result>& results, const std::string& path) {
+  std::ofstream out(path);
+  if (!out) {
+    throw std::runtime_error("Failed to open benchmark output file: " + path);
+  }
+  out << "{\"benchmarks\":[";
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result& r = results[i];
+    out << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << r.name
+        << "\",\"iterations\":" << r.iterations << ",\"ns_per_op\":" << r.ns_per_op
+        << ",\"bytes_per_op\":" << r.bytes_per_op << ",\"allocs_per_op\":" << r.allocs_per_op
+        << ",\"alloc_bytes_per_op\":" << r.alloc_bytes_per_op << "}";
+  }
+  out << "\n]}\n";
+}
+
+} // namespace mcpp::bench
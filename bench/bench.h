@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** @file
+ * @brief Minimal benchmark harness shared by the benchmark executables.
+ *
+ * Each benchmark is timed over enough iterations to fill a minimum run time
+ * and reports ns/op, processed bytes/op and heap allocations/op. Allocations
+ * are counted by replacing the global operator new in bench.cpp, so they
+ * include allocations made inside libmcpp.
+ */
+namespace mcpp::bench {
+
+struct Result {
+  std::string name;
+  uint64_t iterations;
+  double ns_per_op;
+  /// Payload bytes processed per operation (0 if not meaningful)
+  double bytes_per_op;
+  double allocs_per_op;
+  double alloc_bytes_per_op;
+};
+
+/// Number of heap allocations made by the process so far.
+uint64_t alloc_count();
+
+/// Number of bytes requested from the heap by the process so far.
+uint64_t alloc_bytes();
+
+/**
+ * Prevents the compiler from optimising away a value computed by a benchmark.
+ */
+template <typename T> inline void do_not_optimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * Parses the common command line flags and collects results:
+ *   --filter=<substring>  only run benchmarks whose name contains substring
+ *   --json=<path>         also write results as JSON to path
+ *   --min-time=<seconds>  minimum measured time per benchmark (default 0.2)
+ */
+class Runner {
+private:
+  std::string _filter;
+  std::string _json_path;
+  double _min_time_s = 0.2;
+  std::vector<Result> _results;
+
+  void report(const Result& result);
+  static void print_header();
+
+public:
+  /// Throws std::invalid_argument on an unknown flag or a malformed --min-time=
+  Runner(int argc, char** argv);
+
+  /**
+   * Runs every benchmark with the given minimum measured time, without
+   * filtering or JSON output.
+   */
+  explicit Runner(double min_time_s);
+
+  bool selected(const std::string& name) const;
+
+  /**
+   * Times fn, which performs one operation per call.
+   *
+   * @param name Name to report the benchmark under
+   * @param bytes_per_op Payload size handled by one call, for throughput
+   * @param fn Callable performing the operation
+   */
+  template <typename F> void run(const std::string& name, size_t bytes_per_op, F&& fn) {
+    if (!selected(name)) {
+      return;
+    }
+    using Clock = std::chrono::steady_clock;
+
+    // Warm up and estimate the per-call cost
+    uint64_t iterations = 1;
+    double elapsed_s = 0;
+    while (true) {
+      auto start = Clock::now();
+      for (uint64_t i = 0; i < iterations; i++) {
+        fn();
+      }
+      elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+      if (elapsed_s >= _min_time_s / 10 || iterations >= (1ULL << 40)) {
+        break;
+      }
+      iterations *= 2;
+    }
+    iterations = std::max<uint64_t>(1, iterations * (_min_time_s / std::max(elapsed_s, 1e-9)));
+
+    uint64_t allocs_before = alloc_count();
+    uint64_t bytes_before = alloc_bytes();
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < iterations; i++) {
+      fn();
+    }
+    double total_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    auto allocs = static_cast<double>(alloc_count() - allocs_before);
+    auto alloc_size = static_cast<double>(alloc_bytes() - bytes_before);
+
+    auto n = static_cast<double>(iterations);
+    report({name, iterations, total_ns / n, static_cast<double>(bytes_per_op), allocs / n,
+            alloc_size / n});
+  }
+
+  const std::vector<Result>& results() const { return _results; }
+
+  /**
+   * Writes the JSON report if requested.
+   *
+   * @return Process exit code
+   */
+  int finish() const;
+};
+
+/**
+ * Writes results as a JSON document of the form
+ * {"benchmarks":[{"name":...,"ns_per_op":...,...}]}.
+ */
+void write_json(const std::vector<Result>& results, const std::string& path);
+
+} // namespace mcpp::bench
@@ -0,0 +1,262 @@
+#include "../src/connection.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mcpp;
+using Clock = std::chrono::steady_clock;
+
+/*
+ * Spawns N simulated clients, each with its own SocketConnection, issuing a
+ * weighted mix of commands at a target rate, and reports per-client and
+ * aggregate latency percentiles and error rates.
+ *
+ * Usage: load_generator [--host=localhost] [--port=4711] [--clients=8]
+ *                       [--duration=10] [--rate=50]
+ *                       [--mix=setBlock:50,setBlocks:10,getBlocks:10,getHeights:10,getPos:20]
+ *                       [--area=16]
+ *
+ * --rate is commands per second per client (0 = as fast as possible). Latency
+ * of fire-and-forget commands (setBlock, setBlocks) is the time to hand them
+ * to the socket; request/response commands include the server reply. Every
+ * client works in its own area so clients do not overwrite each other.
+ */
+
+namespace {
+enum class Op { kSetBlock, kSetBlocks, kGetBlocks, kGetHeights, kGetPos };
+
+const char* const OP_NAMES[] = {"setBlock", "setBlocks", "getBlocks", "getHeights", "getPos"};
+constexpr size_t OP_COUNT = 5;
+
+struct Options {
+  std::string host = "localhost";
+  uint16_t port = 4711;
+  int clients = 8;
+  double duration_s = 10;
+  double rate = 50;
+  int area = 16;
+  std::vector<double> weights = {50, 10, 10, 10, 20};
+};
+
+struct ClientStats {
+  std::vector<double> latencies_us[OP_COUNT];
+  uint64_t errors[OP_COUNT] = {};
+  std::string connect_error;
+};
+
+double percentile(std::vector<double>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t rank = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+void run_client(const Options& opts, int client_id, const std::atomic<bool>& go,
+                ClientStats& stats) {
+  std::unique_ptr<SocketConnection> conn;
+  try {
+    conn = std::make_unique<SocketConnection>(opts.host, opts.port);
+  } catch (const std::exception& e) {
+    stats.connect_error = e.what();
+    return;
+  }
+
+  std::mt19937 gen(client_id);
+  std::discrete_distribution<size_t> pick(opts.weights.begin(), opts.weights.end());
+  std::uniform_int_distribution<int> offset(0, opts.area - 1);
+  std::uniform_int_distribution<int> block(1, 5);
+  const int base_x = client_id * (opts.area + 4);
+  const int base_y = 100;
+  const int base_z = 1000;
+
+  while (!go) {
+    std::this_thread::yield();
+  }
+
+  auto interval = opts.rate > 0 ? std::chrono::duration<double>(1.0 / opts.rate)
+                                : std::chrono::duration<double>(0);
+  auto start = Clock::now();
+  auto end = start + std::chrono::duration_cast<Clock::duration>(
+                         std::chrono::duration<double>(opts.duration_s));
+  auto next = start;
+
+  while (Clock::now() < end) {
+    if (opts.rate > 0) {
+      std::this_thread::sleep_until(next);
+      next += std::chrono::duration_cast<Clock::duration>(interval);
+    }
+    auto op = static_cast<Op>(pick(gen));
+    int x = base_x + offset(gen);
+    int z = base_z + offset(gen);
+    int edge = opts.area - 1;
+
+    auto sent = Clock::now();
+    try {
+      switch (op) {
+      case Op::kSetBlock:
+        conn->send_command("world.setBlock", x, base_y, z, block(gen), 0);
+        break;
+      case Op::kSetBlocks:
+        conn->send_command("world.setBlocks", base_x, base_y, base_z, base_x + edge, base_y,
+                           base_z + edge, block(gen), 0);
+        break;
+      case Op::kGetBlocks:
+        (void)conn->send_receive_command("world.getBlocksWithData", base_x, base_y, base_z,
+                                         base_x + edge, base_y + edge, base_z + edge);
+        break;
+      case Op::kGetHeights:
+        (void)conn->send_receive_command("world.getHeights", base_x, base_z, base_x + edge,
+                                         base_z + edge);
+        break;
+      case Op::kGetPos:
+        (void)conn->send_receive_command("player.getPos", "");
+        break;
+      }
+      double us = std::chrono::duration<double, std::micro>(Clock::now() - sent).count();
+      stats.latencies_us[static_cast<size_t>(op)].push_back(us);
+    } catch (const std::exception&) {
+      stats.errors[static_cast<size_t>(op)]++;
+    }
+  }
+}
+
+void print_row(const std::string& label, const std::string& op, std::vector<double>& lat,
+               uint64_t errors, double duration_s) {
+  std::sort(lat.begin(), lat.end());
+  uint64_t total = lat.size() + errors;
+  if (total == 0) {
+    return;
+  }
+  std::printf("%-8s %-10s %9llu %9.1f %9.1f %9.1f %9.1f %9.1f %7.2f%%\n", label.c_str(),
+              op.c_str(), static_cast<unsigned long long>(total), total / duration_s,
+              percentile(lat, 50), percentile(lat, 90), percentile(lat, 99),
+              lat.empty() ? 0.0 : lat.back(), 100.0 * errors / total);
+}
+
+bool parse_options(int argc, char** argv, Options& opts) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = arg.substr(arg.find('=') + 1);
+    if (arg.rfind("--host=", 0) == 0) {
+      opts.host = value;
+    } else if (arg.rfind("--port=", 0) == 0) {
+      opts.port = static_cast<uint16_t>(std::stoi(value));
+    } else if (arg.rfind("--clients=", 0) == 0) {
+      opts.clients = std::stoi(value);
+    } else if (arg.rfind("--duration=", 0) == 0) {
+      opts.duration_s = std::stod(value);
+    } else if (arg.rfind("--rate=", 0) == 0) {
+      opts.rate = std::stod(value);
+    } else if (arg.rfind("--area=", 0) == 0) {
+      opts.area = std::max(1, std::stoi(value));
+    } else if (arg.rfind("--mix=", 0) == 0) {
+      std::fill(opts.weights.begin(), opts.weights.end(), 0);
+      std::stringstream ss(value);
+      std::string item;
+      while (std::getline(ss, item, ',')) {
+        std::string name = item.substr(0, item.find(':'));
+        auto it = std::find(std::begin(OP_NAMES), std::end(OP_NAMES), name);
+        if (it == std::end(OP_NAMES) || item.find(':') == std::string::npos) {
+          std::cerr << "Unknown mix entry: " << item << std::endl;
+          return false;
+        }
+        double weight = std::stod(item.substr(item.find(':') + 1));
+        if (weight < 0) {
+          std::cerr << "Negative mix weight: " << item << std::endl;
+          return false;
+        }
+        opts.weights[it - std::begin(OP_NAMES)] = weight;
+      }
+      // std::discrete_distribution needs at least one positive weight
+      if (std::accumulate(opts.weights.begin(), opts.weights.end(), 0.0) <= 0) {
+        std::cerr << "Mix weights must not all be zero" << std::endl;
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  return opts.clients > 0 && opts.duration_s > 0;
+}
+
+bool parse_args(int argc, char** argv, Options& opts) {
+  try {
+    return parse_options(argc, argv, opts);
+  } catch (const std::logic_error&) {
+    // std::stoi and std::stod throw invalid_argument or out_of_range
+    std::cerr << "Invalid number in arguments" << std::endl;
+    return false;
+  }
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  Options opts;
+  if (!parse_args(argc, argv, opts)) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--host=localhost] [--port=4711] [--clients=8] [--duration=10] [--rate=50]"
+                 " [--mix=setBlock:50,setBlocks:10,getBlocks:10,getHeights:10,getPos:20]"
+                 " [--area=16]"
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<ClientStats> stats(opts.clients);
+  std::vector<std::thread> threads;
+  std::atomic<bool> go{false};
+  for (int i = 0; i < opts.clients; i++) {
+    threads.emplace_back(run_client, std::cref(opts), i, std::cref(go), std::ref(stats[i]));
+  }
+  go = true;
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  std::printf("%-8s %-10s %9s %9s %9s %9s %9s %9s %8s\n", "client", "command", "count", "cmd/s",
+              "p50 us", "p90 us", "p99 us", "max us", "errors");
+  ClientStats aggregate;
+  int failed_clients = 0;
+  for (int i = 0; i < opts.clients; i++) {
+    if (!stats[i].connect_error.empty()) {
+      std::printf("%-8d failed to connect: %s\n", i, stats[i].connect_error.c_str());
+      failed_clients++;
+      continue;
+    }
+    std::vector<double> all;
+    uint64_t all_errors = 0;
+    for (size_t op = 0; op < OP_COUNT; op++) {
+      auto& lat = stats[i].latencies_us[op];
+      aggregate.latencies_us[op].insert(aggregate.latencies_us[op].end(), lat.begin(), lat.end());
+      aggregate.errors[op] += stats[i].errors[op];
+      all.insert(all.end(), lat.begin(), lat.end());
+      all_errors += stats[i].errors[op];
+    }
+    print_row(std::to_string(i), "all", all, all_errors, opts.duration_s);
+  }
+
+  std::vector<double> all;
+  uint64_t all_errors = 0;
+  for (size_t op = 0; op < OP_COUNT; op++) {
+    all.insert(all.end(), aggregate.latencies_us[op].begin(), aggregate.latencies_us[op].end());
+    all_errors += aggregate.errors[op];
+    print_row("total", OP_NAMES[op], aggregate.latencies_us[op], aggregate.errors[op],
+              opts.duration_s);
+  }
+  print_row("total", "all", all, all_errors, opts.duration_s);
+  if (failed_clients > 0) {
+    std::printf("%d of %d clients failed to connect\n", failed_clients, opts.clients);
+  }
+  return failed_clients > 0 ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+#include "micro_benches.h"
+
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+
+/*
+ * Microbenchmarks of the client hot paths that do not need a server: command
+ * encoding, reply parsing and the Chunk/HeightMap/Coordinate containers.
+ *
+ * Usage: micro_bench [--filter=name] [--json=out.json] [--min-time=seconds]
+ */
+int main(int argc, char** argv) {
+  std::optional<mcpp::bench::Runner> runner;
+  try {
+    runner.emplace(argc, argv);
+  } catch (const std::invalid_argument& e) {
+    std::cerr << e.what() << std::endl;
+    std::cerr << "Usage: " << argv[0] << " [--filter=name] [--json=out.json] [--min-time=seconds]"
+              << std::endl;
+    return 2;
+  }
+  mcpp::bench::run_micro_benches(*runner);
+  return runner->finish();
+}
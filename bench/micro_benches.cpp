@@ -0,0 +1,623 @@
+#include "../include/mcpp/mcpp.h"
+#include "../src/block_scan.h"
+#include "../src/connection.h"
+#include "../src/util.h"
+#include "micro_benches.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace mcpp::bench {
+
+namespace {
+std::string blocks_reply(size_t count) {
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> id(0, 255);
+  std::uniform_int_distribution<int> mod(0, 15);
+  std::string reply;
+  for (size_t i = 0; i < count; i++) {
+    if (i != 0) {
+      reply += ';';
+    }
+    reply += std::to_string(id(gen)) + "," + std::to_string(mod(gen));
+  }
+  return reply;
+}
+
+std::string heights_reply(size_t count) {
+  std::mt19937 gen(2);
+  std::uniform_int_distribution<int> height(-64, 319);
+  std::string reply;
+  for (size_t i = 0; i < count; i++) {
+    if (i != 0) {
+      reply += ',';
+    }
+    reply += std::to_string(height(gen));
+  }
+  return reply;
+}
+
+Chunk random_chunk(int len) {
+  std::mt19937 gen(3);
+  std::uniform_int_distribution<int> id(0, 255);
+  std::vector<BlockType> blocks(static_cast<size_t>(len) * len * len);
+  for (BlockType& block : blocks) {
+    block = BlockType(id(gen));
+  }
+  return Chunk{Coordinate{0, 0, 0}, Coordinate{len - 1, len - 1, len - 1}, blocks};
+}
+
+HeightMap random_heights(int len) {
+  std::mt19937 gen(4);
+  std::uniform_int_distribution<int> height(-64, 319);
+  std::vector<int16_t> heights(static_cast<size_t>(len) * len);
+  for (int16_t& h : heights) {
+    h = static_cast<int16_t>(height(gen));
+  }
+  return HeightMap{Coordinate2D{0, 0}, Coordinate2D{len - 1, len - 1}, heights};
+}
+
+void bench_encode(Runner& runner) {
+  Coordinate loc{123, -45, 6789};
+  auto set_block = [&] {
+    return SocketConnection::encode_command("world.setBlock", loc.x, loc.y, loc.z, 35, 14);
+  };
+  runner.run("encode/setBlock", set_block().size(), [&] { do_not_optimize(set_block()); });
+
+  auto set_blocks = [&] {
+    return SocketConnection::encode_command("world.setBlocks", loc.x, loc.y, loc.z, loc.x + 10,
+                                            loc.y + 10, loc.z + 10, 1, 0);
+  };
+  runner.run("encode/setBlocks", set_blocks().size(), [&] { do_not_optimize(set_blocks()); });
+
+  std::string message(64, 'a');
+  auto chat = [&] { return SocketConnection::encode_command("chat.post", message); };
+  runner.run("encode/chat.post", chat().size(), [&] { do_not_optimize(chat()); });
+}
+
+void bench_parse(Runner& runner) {
+  std::string pos = "123.5,64.0,-987.25";
+  runner.run("parse/split_response_pos", pos.size(), [&] {
+    std::vector<int32_t> parsed;
+    split_response(pos, parsed);
+    do_not_optimize(parsed);
+  });
+
+  std::string heights = heights_reply(64 * 64);
+  runner.run("parse/split_response_heights_64x64", heights.size(), [&] {
+    std::vector<int16_t> parsed;
+    split_response(heights, parsed);
+    do_not_optimize(parsed);
+  });
+
+  std::vector<int16_t> height_storage(64 * 64);
+  runner.run("parse/split_response_heights_64x64_into", heights.size(), [&] {
+    split_response(heights, height_storage.data(), height_storage.size());
+    do_not_optimize(height_storage);
+  });
+
+  std::string blocks = blocks_reply(16 * 16 * 16);
+  runner.run("parse/getBlocks_reply_16^3", blocks.size(), [&] {
+    std::vector<BlockType> parsed;
+    parse_blocks(blocks, parsed);
+    do_not_optimize(parsed);
+  });
+
+  std::vector<BlockType> block_storage(16 * 16 * 16);
+  runner.run("parse/getBlocks_reply_16^3_into", blocks.size(), [&] {
+    parse_blocks(blocks, block_storage.data(), block_storage.size());
+    do_not_optimize(block_storage);
+  });
+}
+
+void bench_chunk(Runner& runner) {
+  const int len = 32;
+  const size_t volume = static_cast<size_t>(len) * len * len;
+  const size_t bytes = volume * sizeof(BlockType);
+  std::vector<BlockType> blocks(volume, Blocks::STONE);
+
+  runner.run("chunk/construct_32^3", bytes, [&] {
+    Chunk chunk{Coordinate{0, 0, 0}, Coordinate{len - 1, len - 1, len - 1}, blocks};
+    do_not_optimize(chunk);
+  });
+
+  Chunk chunk = random_chunk(len);
+  runner.run("chunk/copy_construct_32^3", bytes, [&] {
+    Chunk copy(chunk);
+    do_not_optimize(copy);
+  });
+
+  Chunk target = random_chunk(len);
+  runner.run("chunk/copy_assign_32^3", bytes, [&] {
+    target = chunk;
+    do_not_optimize(target);
+  });
+
+  runner.run("chunk/copy_then_set_32^3", bytes, [&] {
+    Chunk copy(chunk);
+    copy.set(0, 0, 0, Blocks::GOLD_BLOCK);
+    do_not_optimize(copy);
+  });
+
+  runner.run("chunk/iterate_32^3", bytes, [&] {
+    unsigned sum = 0;
+    for (BlockType block : std::as_const(chunk)) {
+      sum += block.id;
+    }
+    do_not_optimize(sum);
+  });
+
+  runner.run("chunk/get_32^3", bytes, [&] {
+    unsigned sum = 0;
+    for (int y = 0; y < len; y++) {
+      for (int x = 0; x < len; x++) {
+        for (int z = 0; z < len; z++) {
+          sum += chunk.get(x, y, z).id;
+        }
+      }
+    }
+    do_not_optimize(sum);
+  });
+
+  runner.run("chunk/unchecked_32^3", bytes, [&] {
+    unsigned sum = 0;
+    for (int y = 0; y < len; y++) {
+      for (int x = 0; x < len; x++) {
+        for (int z = 0; z < len; z++) {
+          sum += chunk(x, y, z).id;
+        }
+      }
+    }
+    do_not_optimize(sum);
+  });
+
+  runner.run("chunk/cells_32^3", bytes, [&] {
+    int sum = 0;
+    for (auto [pos, block] : chunk.cells()) {
+      sum += pos.x + pos.y + pos.z + block.id;
+    }
+    do_not_optimize(sum);
+  });
+
+  runner.run("chunk/get_positions_32^3", bytes, [&] {
+    int sum = 0;
+    Coordinate base = chunk.base_pt();
+    for (int y = 0; y < len; y++) {
+      for (int x = 0; x < len; x++) {
+        for (int z = 0; z < len; z++) {
+          sum += base.x + x + base.y + y + base.z + z + chunk.get(x, y, z).id;
+        }
+      }
+    }
+    do_not_optimize(sum);
+  });
+
+  runner.run("chunk/get_worldspace_32^3", bytes, [&] {
+    unsigned sum = 0;
+    Coordinate pos;
+    for (pos.y = 0; pos.y < len; pos.y++) {
+      for (pos.x = 0; pos.x < len; pos.x++) {
+        for (pos.z = 0; pos.z < len; pos.z++) {
+          sum += chunk.get_worldspace(pos).id;
+        }
+      }
+    }
+    do_not_optimize(sum);
+  });
+}
+
+void bench_paletted(Runner& runner) {
+  const int len = 32;
+  const size_t bytes = static_cast<size_t>(len) * len * len * sizeof(BlockType);
+  // 16 distinct blocks, so 4 bits per index
+  std::mt19937 gen(6);
+  std::uniform_int_distribution<int> id(0, 15);
+  std::vector<BlockType> blocks(static_cast<size_t>(len) * len * len);
+  for (BlockType& block : blocks) {
+    block = BlockType(id(gen));
+  }
+  Chunk chunk{Coordinate{0, 0, 0}, Coordinate{len - 1, len - 1, len - 1}, blocks};
+
+  runner.run("paletted/from_chunk_32^3", bytes, [&] {
+    PalettedChunk paletted(chunk);
+    do_not_optimize(paletted);
+  });
+
+  PalettedChunk paletted(chunk);
+  runner.run("paletted/to_chunk_32^3", bytes, [&] {
+    Chunk dense = paletted.to_chunk();
+    do_not_optimize(dense);
+  });
+
+  runner.run("paletted/iterate_32^3", bytes, [&] {
+    unsigned sum = 0;
+    for (BlockType block : paletted) {
+      sum += block.id;
+    }
+    do_not_optimize(sum);
+  });
+
+  runner.run("paletted/get_32^3", bytes, [&] {
+    unsigned sum = 0;
+    for (int y = 0; y < len; y++) {
+      for (int x = 0; x < len; x++) {
+        for (int z = 0; z < len; z++) {
+          sum += paletted.get(x, y, z).id;
+        }
+      }
+    }
+    do_not_optimize(sum);
+  });
+}
+
+void bench_octree(Runner& runner) {
+  // 64^3 region with terrain in the lowest 8 layers and air above
+  const int len = 64;
+  const size_t bytes = static_cast<size_t>(len) * len * len * sizeof(BlockType);
+  std::vector<BlockType> blocks(static_cast<size_t>(len) * len * len, Blocks::AIR);
+  std::fill(blocks.begin(), blocks.begin() + 8 * len * len, Blocks::STONE);
+  Chunk chunk{Coordinate{0, 0, 0}, Coordinate{len - 1, len - 1, len - 1}, blocks};
+
+  runner.run("octree/build_64^3_sky", bytes, [&] {
+    Octree tree(chunk);
+    do_not_optimize(tree);
+  });
+
+  Octree tree(chunk);
+  runner.run("octree/for_each_block_64^3_sky", bytes, [&] {
+    unsigned sum = 0;
+    tree.for_each_block(Coordinate{0, 0, 0}, Coordinate{len - 1, len - 1, len - 1},
+                        [&](const Coordinate&, BlockType block) { sum += block.id; });
+    do_not_optimize(sum);
+  });
+
+  runner.run("chunk/count_non_air_64^3_sky", bytes, [&] {
+    unsigned count = 0;
+    for (BlockType block : std::as_const(chunk)) {
+      count += block != Blocks::AIR ? 1 : 0;
+    }
+    do_not_optimize(count);
+  });
+}
+
+// Neighbourhood access through each layout: a 6-neighbour stencil and reads
+// of scattered 8x8x8 cubes, both of which stride across y in a linear layout
+template <typename Layout>
+void bench_layout(Runner& runner, const std::string& name, const Chunk& terrain, const Chunk& big) {
+  LayoutChunk<Layout> chunk(terrain);
+  const int len = chunk.x_len();
+  runner.run("layout/stencil_128^3_" + name, 0, [&] {
+    unsigned exposed = 0;
+    for (int y = 1; y < len - 1; y++) {
+      for (int x = 1; x < len - 1; x++) {
+        for (int z = 1; z < len - 1; z++) {
+          if (chunk.get(x, y, z).id == 0) {
+            continue;
+          }
+          int solid = (chunk.get(x - 1, y, z).id != 0) + (chunk.get(x + 1, y, z).id != 0) +
+                      (chunk.get(x, y - 1, z).id != 0) + (chunk.get(x, y + 1, z).id != 0) +
+                      (chunk.get(x, y, z - 1).id != 0) + (chunk.get(x, y, z + 1).id != 0);
+          exposed += solid != 6 ? 1 : 0;
+        }
+      }
+    }
+    do_not_optimize(exposed);
+  });
+
+  LayoutChunk<Layout> big_chunk(big);
+  const int big_len = big_chunk.x_len();
+  std::mt19937 gen(6);
+  std::uniform_int_distribution<int> corner(0, (big_len / 8) - 1);
+  // Enough cubes that their cache lines do not stay resident between runs
+  std::vector<Coordinate> cubes(2048);
+  for (Coordinate& cube : cubes) {
+    cube = Coordinate(corner(gen) * 8, corner(gen) * 8, corner(gen) * 8);
+  }
+  runner.run("layout/cubes_2048x8^3_in_256^3_" + name, 0, [&] {
+    unsigned sum = 0;
+    for (const Coordinate& cube : cubes) {
+      for (int y = cube.y; y < cube.y + 8; y++) {
+        for (int x = cube.x; x < cube.x + 8; x++) {
+          for (int z = cube.z; z < cube.z + 8; z++) {
+            sum += big_chunk.get(x, y, z).id;
+          }
+        }
+      }
+    }
+    do_not_optimize(sum);
+  });
+}
+
+void bench_layouts(Runner& runner) {
+  // Building the inputs takes a while, skip it when every layout bench is filtered out
+  bool any = false;
+  for (const char* bench : {"stencil_128^3_", "cubes_2048x8^3_in_256^3_"}) {
+    for (const char* layout : {"linear", "bricked", "morton"}) {
+      any = any || runner.selected(std::string("layout/") + bench + layout);
+    }
+  }
+  if (!any) {
+    return;
+  }
+  // Rolling terrain with caves, so the stencil branches both ways
+  const int len = 128;
+  std::mt19937 gen(5);
+  std::bernoulli_distribution cave(0.1);
+  std::vector<BlockType> blocks(static_cast<size_t>(len) * len * len, Blocks::AIR);
+  for (int y = 0; y < len; y++) {
+    for (int x = 0; x < len; x++) {
+      int height = 48 + static_cast<int>(16 * std::sin(x / 9.0) * std::cos(y / 13.0));
+      for (int z = 0; z < len && z < height; z++) {
+        if (!cave(gen)) {
+          blocks[(static_cast<size_t>(y) * len * len) + (static_cast<size_t>(x) * len) + z] =
+              Blocks::STONE;
+        }
+      }
+    }
+  }
+  Chunk terrain{Coordinate{0, 0, 0}, Coordinate{len - 1, len - 1, len - 1}, blocks};
+  Chunk big = random_chunk(256);
+
+  bench_layout<LinearLayout>(runner, "linear", terrain, big);
+  bench_layout<BrickedLayout>(runner, "bricked", terrain, big);
+  bench_layout<MortonLayout>(runner, "morton", terrain, big);
+}
+
+void bench_scan(Runner& runner) {
+  // 64^3 of stone with 1% ores and a mod on some of the stone
+  const int len = 64;
+  const size_t volume = static_cast<size_t>(len) * len * len;
+  const size_t bytes = volume * sizeof(BlockType);
+  std::mt19937 gen(7);
+  std::bernoulli_distribution ore(0.01);
+  std::bernoulli_distribution granite(0.2);
+  std::vector<BlockType> blocks(volume);
+  for (BlockType& block : blocks) {
+    block = ore(gen) ? Blocks::DIAMOND_ORE : granite(gen) ? BlockType(1, 1) : Blocks::STONE;
+  }
+  Chunk chunk{Coordinate{0, 0, 0}, Coordinate{len - 1, len - 1, len - 1}, blocks};
+
+  runner.run("scan/count_get_loop_64^3", bytes, [&] {
+    size_t count = 0;
+    for (int y = 0; y < len; y++) {
+      for (int x = 0; x < len; x++) {
+        for (int z = 0; z < len; z++) {
+          count += chunk.get(x, y, z) == Blocks::DIAMOND_ORE ? 1 : 0;
+        }
+      }
+    }
+    do_not_optimize(count);
+  });
+
+  const BlockType* data = std::as_const(chunk).data();
+  uint16_t ore_lane = scan::lane(Blocks::DIAMOND_ORE);
+  runner.run("scan/count_scalar_64^3", bytes, [&] {
+    do_not_optimize(scan::kernels(scan::Isa::Scalar).count(data, volume, ore_lane, 0xffff));
+  });
+
+  runner.run("scan/count_64^3", bytes, [&] { do_not_optimize(chunk.count(Blocks::DIAMOND_ORE)); });
+
+  runner.run("scan/find_first_64^3", bytes, [&] {
+    do_not_optimize(chunk.find_first(Blocks::GOLD_BLOCK));
+  });
+
+  runner.run("scan/histogram_get_loop_64^3", bytes, [&] {
+    BlockHistogram histogram;
+    for (int y = 0; y < len; y++) {
+      for (int x = 0; x < len; x++) {
+        for (int z = 0; z < len; z++) {
+          BlockType block = chunk.get(x, y, z);
+          if (block.mod < 16) {
+            histogram.counts[(block.id * 16) + block.mod]++;
+          } else {
+            histogram.other++;
+          }
+        }
+      }
+    }
+    do_not_optimize(histogram);
+  });
+
+  runner.run("scan/histogram_64^3", bytes, [&] { do_not_optimize(chunk.histogram()); });
+
+  runner.run("scan/replace_64^3", bytes, [&] {
+    do_not_optimize(chunk.replace(Blocks::DIAMOND_ORE, Blocks::GOLD_BLOCK));
+    do_not_optimize(chunk.replace(Blocks::GOLD_BLOCK, Blocks::DIAMOND_ORE));
+  });
+
+  // Id-only queries over each storage policy, bytes is what each one scans
+  StorageChunk<AosStorage> aos(chunk);
+  StorageChunk<SoaStorage> soa(chunk);
+  StorageChunk<IdOnlyStorage> ids(chunk);
+  runner.run("scan/count_id_64^3_aos", aos.storage().bytes(), [&] {
+    do_not_optimize(aos.count(Blocks::DIAMOND_ORE, false));
+  });
+  runner.run("scan/count_id_64^3_soa", volume, [&] {
+    do_not_optimize(soa.count(Blocks::DIAMOND_ORE, false));
+  });
+  runner.run("scan/count_id_64^3_ids", ids.storage().bytes(), [&] {
+    do_not_optimize(ids.count(Blocks::DIAMOND_ORE, false));
+  });
+  runner.run("scan/find_id_64^3_soa", volume, [&] {
+    do_not_optimize(soa.find_first(Blocks::GOLD_BLOCK, false));
+  });
+
+  // A later poll of the same area with 0.1% of the blocks changed
+  Chunk later = chunk;
+  for (size_t i = 0; i < volume; i += 1000) {
+    later.data()[i] = Blocks::GOLD_BLOCK;
+  }
+  runner.run("scan/diff_get_loop_64^3", bytes, [&] {
+    std::vector<ChunkDiff::Change> changes;
+    for (int y = 0; y < len; y++) {
+      for (int x = 0; x < len; x++) {
+        for (int z = 0; z < len; z++) {
+          BlockType block = later.get(x, y, z);
+          if (!(chunk.get(x, y, z) == block)) {
+            changes.push_back({Coordinate(x, y, z), block});
+          }
+        }
+      }
+    }
+    do_not_optimize(changes);
+  });
+
+  ChunkDiff changes;
+  runner.run("scan/diff_64^3", bytes, [&] {
+    diff(chunk, later, changes);
+    do_not_optimize(changes);
+  });
+}
+
+void bench_hash(Runner& runner) {
+  const int len = 64;
+  const size_t bytes = static_cast<size_t>(len) * len * len * sizeof(BlockType);
+  const Chunk source = random_chunk(len);
+
+  runner.run("hash/build_64^3", bytes, [&] {
+    Chunk copy = source;
+    do_not_optimize(copy.hashes().root());
+  });
+
+  // One block changed since the last hash, so one of 64 sections is rehashed
+  Chunk chunk = source;
+  chunk.hashes();
+  int i = 0;
+  runner.run("hash/update_one_64^3", bytes, [&] {
+    chunk.set(i % len, (i / len) % len, 7, BlockType(i % 256));
+    i++;
+    do_not_optimize(chunk.hashes().root());
+  });
+
+  // Two snapshots with one changed section, both already hashed
+  Chunk before = source;
+  Chunk after = source;
+  after.set(40, 40, 40, Blocks::GOLD_BLOCK);
+  before.hashes();
+  after.hashes();
+  runner.run("hash/changed_sections_64^3", bytes, [&] {
+    do_not_optimize(changed_sections(before, after));
+  });
+}
+
+void bench_parallel(Runner& runner) {
+  // Per-block work heavy enough for splitting to pay off on several cores
+  const int len = 64;
+  const size_t bytes = static_cast<size_t>(len) * len * len * sizeof(BlockType);
+  Chunk chunk = random_chunk(len);
+  auto weight = [](const BlockType& block) { return (block.id * 2654435761U) >> 28; };
+
+  runner.run("parallel/serial_reduce_64^3", bytes, [&] {
+    unsigned sum = 0;
+    for (const BlockType& block : std::as_const(chunk)) {
+      sum += weight(block);
+    }
+    do_not_optimize(sum);
+  });
+
+  ThreadPool& pool = ThreadPool::shared();
+  runner.run("parallel/reduce_64^3", bytes, [&] {
+    do_not_optimize(
+        parallel_reduce(chunk.cbegin(), chunk.cend(), 0U, std::plus<>(), weight, pool));
+  });
+}
+
+void bench_heightmap(Runner& runner) {
+  const int len = 128;
+  const size_t bytes = static_cast<size_t>(len) * len * sizeof(int16_t);
+  HeightMap heights = random_heights(len);
+
+  runner.run("heightmap/get_128^2", bytes, [&] {
+    int sum = 0;
+    for (int x = 0; x < len; x++) {
+      for (int z = 0; z < len; z++) {
+        sum += heights.get(x, z);
+      }
+    }
+    do_not_optimize(sum);
+  });
+
+  runner.run("heightmap/unchecked_128^2", bytes, [&] {
+    int sum = 0;
+    for (int x = 0; x < len; x++) {
+      for (int z = 0; z < len; z++) {
+        sum += heights(x, z);
+      }
+    }
+    do_not_optimize(sum);
+  });
+
+  runner.run("heightmap/get_worldspace_128^2", bytes, [&] {
+    int sum = 0;
+    for (int x = 0; x < len; x++) {
+      for (int z = 0; z < len; z++) {
+        sum += heights.get_worldspace(Coordinate2D{x, z});
+      }
+    }
+    do_not_optimize(sum);
+  });
+
+  runner.run("heightmap/cells_128^2", bytes, [&] {
+    int sum = 0;
+    for (auto [pos, height] : heights.cells()) {
+      sum += pos.x + pos.z + height;
+    }
+    do_not_optimize(sum);
+  });
+
+  runner.run("heightmap/iterate_128^2", bytes, [&] {
+    int sum = 0;
+    for (int16_t h : heights) {
+      sum += h;
+    }
+    do_not_optimize(sum);
+  });
+}
+
+void bench_coordinate(Runner& runner) {
+  std::mt19937 gen(5);
+  std::uniform_int_distribution<int> horizontal(-30000, 30000);
+  std::uniform_int_distribution<int> vertical(-64, 319);
+  std::vector<Coordinate> coords(4096);
+  for (Coordinate& coord : coords) {
+    coord = Coordinate{horizontal(gen), vertical(gen), horizontal(gen)};
+  }
+
+  Coordinate hasher;
+  runner.run("coordinate/hash_x4096", 0, [&] {
+    size_t acc = 0;
+    for (const Coordinate& coord : coords) {
+      acc ^= hasher(coord);
+    }
+    do_not_optimize(acc);
+  });
+
+  runner.run("coordinate/unordered_set_insert_x4096", 0, [&] {
+    std::unordered_set<Coordinate, Coordinate> set;
+    for (const Coordinate& coord : coords) {
+      set.insert(coord);
+    }
+    do_not_optimize(set);
+  });
+}
+} // namespace
+
+void run_micro_benches(Runner& runner) {
+  bench_encode(runner);
+  bench_parse(runner);
+  bench_chunk(runner);
+  bench_paletted(runner);
+  bench_octree(runner);
+  bench_layouts(runner);
+  bench_scan(runner);
+  bench_hash(runner);
+  bench_parallel(runner);
+  bench_heightmap(runner);
+  bench_coordinate(runner);
+}
+
+} // namespace mcpp::bench
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "bench.h"
+
+/** @file
+ * @brief Microbenchmarks shared by micro_bench and the perf regression gate.
+ */
+namespace mcpp::bench {
+
+/**
+ * Runs the microbenchmarks of the client hot paths that do not need a
+ * server: command encoding, reply parsing and the Chunk/HeightMap/Coordinate
+ * containers.
+ */
+void run_micro_benches(Runner& runner);
+
+} // namespace mcpp::bench
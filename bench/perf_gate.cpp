@@ -0,0 +1,185 @@
+#include "micro_benches.h"
+#include "scenarios.h"
+#include "stub_server.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace mcpp::bench;
+
+/*
+ * Performance regression gate, registered with ctest under the "perf" label
+ * when configured with -DMCPP_PERF_GATE=ON.
+ * Runs the microbenchmarks and the example scenarios (against a stub server)
+ * and compares them with a checked-in baseline file.
+ *
+ * Usage: perf_gate <baseline file> [--update]
+ *
+ * Each baseline line is "<benchmark> <metric> <value> <tolerance>". Lower is
+ * better for ns_per_op, allocs_per_op and allocations, higher is better for
+ * commands_per_s. A result fails when it is worse than the baseline by more
+ * than the tolerance fraction. --update rewrites the values from the current
+ * run, keeping tolerances, and should be run on the machine that runs the gate.
+ */
+
+namespace {
+struct Entry {
+  std::string benchmark;
+  std::string metric;
+  double value;
+  double tolerance;
+};
+
+// Default tolerances for entries added by --update. Timings vary between
+// runs and machines, allocation counts are deterministic.
+double default_tolerance(const std::string& metric) {
+  if (metric == "ns_per_op") {
+    return 1.0;
+  }
+  if (metric == "commands_per_s") {
+    return 0.6;
+  }
+  return 0.1;
+}
+
+bool higher_is_better(const std::string& metric) { return metric == "commands_per_s"; }
+
+bool is_count(const std::string& metric) {
+  return metric == "allocs_per_op" || metric == "allocations";
+}
+
+std::vector<Entry> read_baseline(const std::string& path) {
+  std::ifstream file(path);
+  if (!file) {
+    throw std::runtime_error("Failed to open baseline file: " + path);
+  }
+  std::vector<Entry> entries;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::stringstream ss(line);
+    Entry entry;
+    if (!(ss >> entry.benchmark >> entry.metric >> entry.value >> entry.tolerance)) {
+      throw std::runtime_error("Malformed baseline line: " + line);
+    }
+    entries.push_back(entry);
+  }
+  return entries;
+}
+
+void write_baseline(const std::string& path, const std::vector<Entry>& entries) {
+  std::ofstream file(path);
+  file << "# Performance baseline for the perf ctest label, see bench/perf_gate.cpp.\n"
+       << "# <benchmark> <metric> <value> <tolerance>\n"
+       << "# Regenerate on the machine that runs the gate with: perf_gate <this file> --update\n";
+  for (const Entry& e : entries) {
+    file << e.benchmark << " " << e.metric << " " << e.value << " " << e.tolerance << "\n";
+  }
+}
+
+std::vector<Entry> measure() {
+  // Fork the stub server before any threads exist
+  StubProcess server;
+
+  std::vector<Entry> results;
+  Runner runner(0.05);
+  run_micro_benches(runner);
+  for (const Result& r : runner.results()) {
+    results.push_back({"micro/" + r.name, "ns_per_op", r.ns_per_op, 0});
+    results.push_back({"micro/" + r.name, "allocs_per_op", r.allocs_per_op, 0});
+  }
+
+  // Best of three to damp scheduling noise
+  for (const Scenario& scenario : scenarios()) {
+    ScenarioResult best = run_isolated(scenario, server.port());
+    for (int i = 0; i < 2; i++) {
+      ScenarioResult r = run_isolated(scenario, server.port());
+      if (r.commands_per_s() > best.commands_per_s()) {
+        best = r;
+      }
+    }
+    std::printf("scenario/%-31s %14.0f commands/s %10llu allocs\n", scenario.name.c_str(),
+                best.commands_per_s(), static_cast<unsigned long long>(best.allocations));
+    results.push_back({"scenario/" + scenario.name, "commands_per_s", best.commands_per_s(), 0});
+    results.push_back({"scenario/" + scenario.name, "allocations",
+                       static_cast<double>(best.allocations), 0});
+  }
+  return results;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2 || (argc == 3 && std::string(argv[2]) != "--update") || argc > 3) {
+    std::cerr << "Usage: " << argv[0] << " <baseline file> [--update]" << std::endl;
+    return 2;
+  }
+  std::string path = argv[1];
+  bool update = argc == 3;
+
+  std::vector<Entry> baseline;
+  std::ifstream exists(path);
+  if (exists || !update) {
+    baseline = read_baseline(path);
+  }
+  std::vector<Entry> results = measure();
+
+  std::map<std::pair<std::string, std::string>, const Entry*> measured;
+  for (const Entry& r : results) {
+    measured[{r.benchmark, r.metric}] = &r;
+  }
+
+  if (update) {
+    std::map<std::pair<std::string, std::string>, double> tolerances;
+    for (const Entry& b : baseline) {
+      tolerances[{b.benchmark, b.metric}] = b.tolerance;
+    }
+    for (Entry& r : results) {
+      auto it = tolerances.find({r.benchmark, r.metric});
+      r.tolerance = it != tolerances.end() ? it->second : default_tolerance(r.metric);
+    }
+    write_baseline(path, results);
+    std::printf("Baseline written to %s\n", path.c_str());
+    return 0;
+  }
+
+  int failures = 0;
+  std::printf("\n%-48s %-15s %14s %14s %8s\n", "benchmark", "metric", "baseline", "current",
+              "result");
+  for (const Entry& b : baseline) {
+    auto it = measured.find({b.benchmark, b.metric});
+    if (it == measured.end()) {
+      std::printf("%-48s %-15s %14.2f %14s %8s\n", b.benchmark.c_str(), b.metric.c_str(), b.value,
+                  "-", "MISSING");
+      failures++;
+      continue;
+    }
+    double current = it->second->value;
+    bool ok;
+    if (higher_is_better(b.metric)) {
+      ok = current >= b.value * (1 - b.tolerance);
+    } else {
+      // Half an allocation of slack so a zero baseline still allows rounding
+      double slack = is_count(b.metric) ? 0.5 : 0;
+      ok = current <= b.value * (1 + b.tolerance) + slack;
+    }
+    failures += ok ? 0 : 1;
+    std::printf("%-48s %-15s %14.2f %14.2f %8s\n", b.benchmark.c_str(), b.metric.c_str(), b.value,
+                current, ok ? "ok" : "REGRESSED");
+  }
+
+  if (failures > 0) {
+    std::printf("\n%d metric(s) regressed beyond tolerance\n", failures);
+    return 1;
+  }
+  std::printf("\nAll metrics within tolerance\n");
+  return 0;
+}
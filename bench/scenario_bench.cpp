@@ -0,0 +1,62 @@
+#include "scenarios.h"
+#include "stub_server.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace mcpp::bench;
+
+/*
+ * Replays the example workloads against a stub server running in a separate
+ * process. Each scenario runs in its own client process so peak RSS is per
+ * scenario.
+ *
+ * Usage: scenario_bench [--filter=name] [--json=out.json] [--delay-us=N]
+ *
+ * --delay-us adds artificial server processing time to every reply, which
+ * approximates the latency of a real server.
+ */
+int main(int argc, char** argv) {
+  std::string filter;
+  std::string json_path;
+  long delay_us = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.rfind("--filter=", 0) == 0) {
+      filter = arg.substr(9);
+    } else if (arg.rfind("--json=", 0) == 0) {
+      json_path = arg.substr(7);
+    } else if (arg.rfind("--delay-us=", 0) == 0) {
+      delay_us = std::stol(arg.substr(11));
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--filter=name] [--json=out.json] [--delay-us=N]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  StubProcess server{std::chrono::microseconds(delay_us)};
+
+  std::printf("%-16s %10s %10s %14s %14s %12s %12s\n", "scenario", "wall ms", "commands",
+              "commands/s", "bytes/s", "allocs", "peak RSS KiB");
+  std::vector<ScenarioResult> results;
+  for (const Scenario& scenario : scenarios()) {
+    if (!filter.empty() && scenario.name.find(filter) == std::string::npos) {
+      continue;
+    }
+    ScenarioResult r = run_isolated(scenario, server.port());
+    std::printf("%-16s %10.1f %10llu %14.0f %14.0f %12llu %12llu\n", r.name.c_str(),
+                r.wall_s * 1000, static_cast<unsigned long long>(r.commands), r.commands_per_s(),
+                r.bytes_per_s(), static_cast<unsigned long long>(r.allocations),
+                static_cast<unsigned long long>(r.peak_rss_kb));
+    std::fflush(stdout);
+    results.push_back(r);
+  }
+
+  if (!json_path.empty()) {
+    write_json(results, json_path);
+  }
+  return 0;
+}
@@ -0,0 +1,263 @@
+#include "scenarios.h"
+#include "../src/connection.h"
+#include "bench.h"
+#include "stub_server.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+namespace mcpp::bench {
+namespace {
+const Coordinate ORIGIN{0, 4, 0};
+
+void pyramid(MinecraftConnection& mc) {
+  const int height = 30;
+  const int base_len = height * 2;
+
+  HeightMap heights = mc.getHeights(ORIGIN, ORIGIN + Coordinate(base_len, 0, base_len));
+  int min_height = *std::min_element(heights.begin(), heights.end());
+
+  Coordinate base_pt = heights.base_pt().with_height(min_height);
+  for (int i = 0; i < height; i++) {
+    Coordinate ring = base_pt + Coordinate(i, i, i);
+    int side_len = base_len - (i * 2);
+    mc.setBlocks(ring, ring + Coordinate(side_len, 0, side_len), Blocks::SANDSTONE);
+    ring = ring + Coordinate(1, 0, 1);
+    mc.setBlocks(ring, ring + Coordinate(side_len - 2, 0, side_len - 2), Blocks::AIR);
+  }
+}
+
+void video_mc(MinecraftConnection& mc) {
+  const int width = 64;
+  const int height = 36;
+  const int frames = 30;
+  const std::array<BlockType, 8> palette = {
+      Blocks::WHITE_WOOL, Blocks::ORANGE_WOOL, Blocks::MAGENTA_WOOL, Blocks::LIGHT_BLUE_WOOL,
+      Blocks::YELLOW_WOOL, Blocks::LIME_WOOL,  Blocks::PINK_WOOL,    Blocks::BLACK_WOOL};
+
+  // Roughly a quarter of the pixels change between frames
+  std::mt19937 gen(26);
+  std::uniform_int_distribution<int> colour(0, palette.size() - 1);
+  std::bernoulli_distribution changes(0.25);
+  std::vector<int> previous(width * height, -1);
+  std::vector<int> frame(width * height);
+
+  Coordinate position = ORIGIN + Coordinate(0, height, 100);
+  for (int f = 0; f < frames; f++) {
+    for (size_t i = 0; i < frame.size(); i++) {
+      frame[i] = (f == 0 || changes(gen)) ? colour(gen) : previous[i];
+    }
+    for (size_t i = 0; i < frame.size(); i++) {
+      if (frame[i] == previous[i]) {
+        continue;
+      }
+      Coordinate pixel = position;
+      pixel.z += static_cast<int>(i % width);
+      pixel.y -= static_cast<int>(i / width);
+      mc.setBlock(pixel, palette[frame[i]]);
+    }
+    previous.swap(frame);
+  }
+}
+
+void obj_mc(MinecraftConnection& mc) {
+  // Solid ellipsoid standing in for a voxelised mesh
+  const int rx = 14;
+  const int ry = 10;
+  const int rz = 12;
+  Coordinate centre = ORIGIN + Coordinate(200, ry, 0);
+  for (int x = -rx; x <= rx; x++) {
+    for (int y = -ry; y <= ry; y++) {
+      for (int z = -rz; z <= rz; z++) {
+        double d = static_cast<double>(x * x) / (rx * rx) + static_cast<double>(y * y) / (ry * ry) +
+                   static_cast<double>(z * z) / (rz * rz);
+        if (d <= 1.0) {
+          mc.setBlock(centre + Coordinate(x, y, z), Blocks::GRAY_CONCRETE);
+        }
+      }
+    }
+  }
+}
+
+void game_of_life(MinecraftConnection& mc) {
+  const int width = 40;
+  const int depth = 40;
+  const int generations = 20;
+  Coordinate build = ORIGIN + Coordinate(300, 0, 0);
+  Coordinate bounds = build + Coordinate(width - 1, 0, depth - 1);
+  Coordinate upper_build = build + Coordinate(0, 1, 0);
+  Coordinate upper_bounds = bounds + Coordinate(0, 1, 0);
+
+  std::mt19937 gen(27);
+  std::bernoulli_distribution alive(0.4);
+  std::vector<uint8_t> game(width * depth);
+  for (uint8_t& cell : game) {
+    cell = alive(gen);
+  }
+  std::vector<uint8_t> next(game.size());
+
+  for (int g = 0; g < generations; g++) {
+    Chunk controls = mc.getBlocks(upper_build, upper_bounds);
+    for (int x = 0; x < width; x++) {
+      for (int z = 0; z < depth; z++) {
+        if (controls.get(x, 0, z) != Blocks::AIR) {
+          mc.setBlock(upper_build + Coordinate(x, 0, z), Blocks::AIR);
+        }
+      }
+    }
+
+    for (int x = 0; x < width; x++) {
+      for (int z = 0; z < depth; z++) {
+        int neighbours = 0;
+        for (int dx = -1; dx <= 1; dx++) {
+          for (int dz = -1; dz <= 1; dz++) {
+            int nx = (x + dx + width) % width;
+            int nz = (z + dz + depth) % depth;
+            neighbours += (dx != 0 || dz != 0) ? game[nx * depth + nz] : 0;
+          }
+        }
+        uint8_t cell = game[x * depth + z];
+        next[x * depth + z] = (neighbours == 3 || (cell && neighbours == 2)) ? 1 : 0;
+      }
+    }
+    game.swap(next);
+
+    mc.setBlocks(build, bounds, Blocks::BLACK_CONCRETE);
+    for (int x = 0; x < width; x++) {
+      for (int z = 0; z < depth; z++) {
+        if (game[x * depth + z]) {
+          mc.setBlock(build + Coordinate(x, 0, z), Blocks::WHITE_CONCRETE);
+        }
+      }
+    }
+  }
+}
+
+void minesweeper(MinecraftConnection& mc) {
+  const int polls = 200;
+  Coordinate corner = ORIGIN + Coordinate(400, 1, 0);
+  Coordinate opposite = corner + Coordinate(9, 0, 9);
+  mc.setBlocks(corner - Coordinate(0, 1, 0), opposite - Coordinate(0, 1, 0),
+               Blocks::LIGHT_GRAY_CONCRETE);
+
+  for (int i = 0; i < polls; i++) {
+    auto board = mc.getBlocks<10, 1, 10>(corner);
+    for (int x = 0; x < 10; x++) {
+      for (int z = 0; z < 10; z++) {
+        if (board.get(x, 0, z) == Blocks::TNT) {
+          mc.setBlock(corner + Coordinate(x, 0, z), Blocks::AIR);
+        }
+      }
+    }
+    Coordinate player = mc.getPlayerPosition();
+    (void)player;
+  }
+}
+} // namespace
+
+const std::vector<Scenario>& scenarios() {
+  static const std::vector<Scenario> all = {{"pyramid", pyramid},
+                                            {"video_mc", video_mc},
+                                            {"obj_mc", obj_mc},
+                                            {"game_of_life", game_of_life},
+                                            {"minesweeper", minesweeper}};
+  return all;
+}
+
+ScenarioResult run_isolated(const Scenario& scenario, uint16_t port) {
+  // Only plain data crosses the pipe, the name is filled in by the parent
+  struct Report {
+    bool ok;
+    double wall_s;
+    StubStats stats;
+    uint64_t allocations;
+    uint64_t peak_rss_kb;
+    char error[256];
+  };
+
+  int report_pipe[2];
+  if (pipe(report_pipe) < 0) {
+    throw std::runtime_error("Failed to create scenario pipe.");
+  }
+  pid_t pid = fork();
+  if (pid < 0) {
+    throw std::runtime_error("Failed to fork scenario process.");
+  }
+
+  if (pid == 0) {
+    close(report_pipe[0]);
+    Report report{};
+    try {
+      MinecraftConnection mc("127.0.0.1", port);
+      SocketConnection stats_conn("127.0.0.1", port);
+      StubStats before = parse_stats(stats_conn.send_receive_command("stub.stats", ""));
+      uint64_t allocs_before = alloc_count();
+
+      auto start = std::chrono::steady_clock::now();
+      scenario.run(mc);
+      // setBlock(s) are not acknowledged, so finish with a round trip to make
+      // the timing include the server draining them
+      (void)mc.getPlayerPosition();
+      report.wall_s =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      report.allocations = alloc_count() - allocs_before;
+      StubStats after = parse_stats(stats_conn.send_receive_command("stub.stats", ""));
+      report.stats = {after.commands - before.commands, after.bytes_in - before.bytes_in,
+                      after.bytes_out - before.bytes_out};
+
+      rusage usage{};
+      getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+      report.peak_rss_kb = usage.ru_maxrss / 1024;
+#else
+      report.peak_rss_kb = usage.ru_maxrss;
+#endif
+      report.ok = true;
+    } catch (const std::exception& e) {
+      std::strncpy(report.error, e.what(), sizeof(report.error) - 1);
+    }
+    write(report_pipe[1], &report, sizeof(report));
+    _exit(report.ok ? 0 : 1);
+  }
+
+  close(report_pipe[1]);
+  Report report{};
+  ssize_t got = read(report_pipe[0], &report, sizeof(report));
+  close(report_pipe[0]);
+  waitpid(pid, nullptr, 0);
+  if (got != sizeof(report) || !report.ok) {
+    throw std::runtime_error("Scenario " + scenario.name + " failed: " + report.error);
+  }
+  return {scenario.name,        report.wall_s,      report.stats.commands,
+          report.stats.bytes_in, report.stats.bytes_out, report.allocations,
+          report.peak_rss_kb};
+}
+
+void write_json(const std::vector<ScenarioResult>& results, const std::string& path) {
+  std::ofstream out(path);
+  if (!out) {
+    throw std::runtime_error("Failed to open benchmark output file: " + path);
+  }
+  out << "{\"scenarios\":[";
+  for (size_t i = 0; i < results.size(); i++) {
+    const ScenarioResult& r = results[i];
+    out << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << r.name << "\",\"wall_s\":" << r.wall_s
+        << ",\"commands\":" << r.commands << ",\"bytes_in\":" << r.bytes_in
+        << ",\"bytes_out\":" << r.bytes_out << ",\"commands_per_s\":" << r.commands_per_s()
+        << ",\"bytes_per_s\":" << r.bytes_per_s() << ",\"allocations\":" << r.allocations
+        << ",\"peak_rss_kb\":" << r.peak_rss_kb << "}";
+  }
+  out << "\n]}\n";
+}
+
+} // namespace mcpp::bench
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../include/mcpp/mcpp.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** @file
+ * @brief End-to-end workloads replaying the command patterns of the examples.
+ *
+ * Each scenario issues the same sequence of calls as the matching program in
+ * example/, with the game logic and delays stripped out, so that library
+ * changes can be judged against the workloads that are actually run.
+ */
+namespace mcpp::bench {
+
+struct Scenario {
+  std::string name;
+  void (*run)(MinecraftConnection& mc);
+};
+
+/**
+ * pyramid: getHeights over the base, then two setBlocks per ring.
+ * video_mc: frames of 64x36 pixels, setBlock for every pixel that changed.
+ * obj_mc: voxelise a solid model and place it one setBlock per voxel.
+ * game_of_life: per generation read the control layer with getBlocks, clear
+ *   the board with setBlocks and setBlock each live cell.
+ * minesweeper: poll a 10x1x10 board with getBlocks plus getPlayerPosition.
+ */
+const std::vector<Scenario>& scenarios();
+
+struct ScenarioResult {
+  std::string name;
+  double wall_s;
+  /// Commands and bytes as counted by the stub server
+  uint64_t commands;
+  uint64_t bytes_in;
+  uint64_t bytes_out;
+  /// Heap allocations made by the client while running the scenario
+  uint64_t allocations;
+  /// Peak resident set size of the client process in KiB
+  uint64_t peak_rss_kb;
+
+  double commands_per_s() const { return commands / wall_s; }
+  double bytes_per_s() const { return (bytes_in + bytes_out) / wall_s; }
+};
+
+/**
+ * Runs a scenario in a forked client process against the stub server on port,
+ * so that peak RSS covers only that scenario.
+ */
+ScenarioResult run_isolated(const Scenario& scenario, uint16_t port);
+
+/**
+ * Writes results as a JSON document of the form {"scenarios":[{...}]}.
+ */
+void write_json(const std::vector<ScenarioResult>& results, const std::string& path);
+
+} // namespace mcpp::bench
@@ -0,0 +1,355 @@
+#include "stub_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace mcpp::bench {
+
+Coordinate StubWorld::section_of(const Coordinate& pos) {
+  auto floor_div = [](int v) {
+    return v >= 0 ? v / kSectionSize : -((-v - 1) / kSectionSize) - 1;
+  };
+  return {floor_div(pos.x), floor_div(pos.y), floor_div(pos.z)};
+}
+
+size_t StubWorld::index_in_section(const Coordinate& pos) {
+  auto local = [](int v) {
+    return static_cast<size_t>(((v % kSectionSize) + kSectionSize) % kSectionSize);
+  };
+  return (local(pos.y) * kSectionSize + local(pos.x)) * kSectionSize + local(pos.z);
+}
+
+BlockType StubWorld::get(const Coordinate& pos) const {
+  auto it = _sections.find(section_of(pos));
+  if (it != _sections.end()) {
+    return it->second[index_in_section(pos)];
+  }
+  return pos.y == kFloorY ? Blocks::BEDROCK : Blocks::AIR;
+}
+
+void StubWorld::set(const Coordinate& pos, BlockType block) {
+  Coordinate section_pos = section_of(pos);
+  auto it = _sections.find(section_pos);
+  if (it == _sections.end()) {
+    Section section(kSectionSize * kSectionSize * kSectionSize, Blocks::AIR);
+    if (section_pos.y * kSectionSize == kFloorY) {
+      std::fill(section.begin(), section.begin() + kSectionSize * kSectionSize, Blocks::BEDROCK);
+    }
+    it = _sections.emplace(section_pos, std::move(section)).first;
+  }
+  it->second[index_in_section(pos)] = block;
+
+  // Keep column heights current so getHeight does not have to scan
+  int current = height(pos.x, pos.z);
+  if (block != Blocks::AIR && pos.y > current) {
+    _heights[Coordinate2D{pos.x, pos.z}] = pos.y;
+  } else if (block == Blocks::AIR && pos.y == current) {
+    int y = pos.y - 1;
+    while (y > kFloorY && get(Coordinate{pos.x, y, pos.z}) == Blocks::AIR) {
+      y--;
+    }
+    _heights[Coordinate2D{pos.x, pos.z}] = y;
+  }
+}
+
+int StubWorld::height(int x, int z) const {
+  auto it = _heights.find(Coordinate2D{x, z});
+  return it != _heights.end() ? it->second : kFloorY;
+}
+
+StubServer::StubServer(uint16_t port, std::chrono::microseconds reply_delay)
+    : _reply_delay(reply_delay) {
+  _listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (_listen_fd == -1) {
+    throw std::runtime_error("Failed to create stub server socket.");
+  }
+  int enable = 1;
+  setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      listen(_listen_fd, 128) < 0) {
+    close(_listen_fd);
+    throw std::runtime_error("Failed to listen on stub server port " + std::to_string(port));
+  }
+
+  socklen_t len = sizeof(addr);
+  getsockname(_listen_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+  _port = ntohs(addr.sin_port);
+
+  _accept_thread = std::thread(&StubServer::accept_loop, this);
+}
+
+StubServer::~StubServer() { stop(); }
+
+StubStats StubServer::stats() const {
+  return {_commands.load(), _bytes_in.load(), _bytes_out.load()};
+}
+
+void StubServer::stop() {
+  if (!_running.exchange(false)) {
+    return;
+  }
+  shutdown(_listen_fd, SHUT_RDWR);
+  close(_listen_fd);
+  _accept_thread.join();
+
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(_clients_mutex);
+    for (int fd : _client_fds) {
+      shutdown(fd, SHUT_RDWR);
+    }
+    threads.swap(_client_threads);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+void StubServer::accept_loop() {
+  while (_running) {
+    int fd = accept(_listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    std::lock_guard<std::mutex> lock(_clients_mutex);
+    if (!_running) {
+      close(fd);
+      break;
+    }
+    _client_fds.push_back(fd);
+    _client_threads.emplace_back(&StubServer::serve, this, fd);
+  }
+}
+
+void StubServer::serve(int fd) {
+  std::string pending;
+  char buffer[4096];
+  while (true) {
+    ssize_t bytes_read = read(fd, buffer, sizeof(buffer));
+    if (bytes_read <= 0) {
+      break;
+    }
+    pending.append(buffer, bytes_read);
+
+    size_t line_end;
+    while ((line_end = pending.find('\n')) != std::string::npos) {
+      std::string line = pending.substr(0, line_end);
+      pending.erase(0, line_end + 1);
+
+      std::string reply = handle(line);
+      // Stub-only queries are not part of the measured traffic
+      bool counted = line.rfind("stub.", 0) != 0;
+      if (counted) {
+        _commands++;
+        _bytes_in += line.size() + 1;
+      }
+      if (reply.empty()) {
+        continue;
+      }
+      if (_reply_delay.count() > 0) {
+        std::this_thread::sleep_for(_reply_delay);
+      }
+      reply += '\n';
+      if (counted) {
+        _bytes_out += reply.size();
+      }
+      size_t written = 0;
+      while (written < reply.size()) {
+        ssize_t result = write(fd, reply.data() + written, reply.size() - written);
+        if (result <= 0) {
+          break;
+        }
+        written += result;
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(_clients_mutex);
+  _client_fds.erase(std::remove(_client_fds.begin(), _client_fds.end(), fd), _client_fds.end());
+  close(fd);
+}
+
+std::string StubServer::handle(const std::string& line) {
+  size_t open = line.find('(');
+  size_t close_pos = line.rfind(')');
+  if (open == std::string::npos || close_pos == std::string::npos || close_pos < open) {
+    return "Fail";
+  }
+  std::string name = line.substr(0, open);
+  std::string arg_str = line.substr(open + 1, close_pos - open - 1);
+
+  // Chat and commands carry free text, everything else is numeric. Only
+  // teleports are simulated out of the in-game commands.
+  if (name == "chat.post" || name == "player.doCommand") {
+    double x;
+    double y;
+    double z;
+    if (name == "player.doCommand" &&
+        std::sscanf(arg_str.c_str(), "tp %lf %lf %lf", &x, &y, &z) == 3) {
+      std::lock_guard<std::mutex> lock(_world_mutex);
+      _player = Coordinate(std::floor(x), std::floor(y), std::floor(z));
+    }
+    return "";
+  }
+  if (name == "stub.stats") {
+    return std::to_string(_commands.load()) + "," + std::to_string(_bytes_in.load()) + "," +
+           std::to_string(_bytes_out.load());
+  }
+
+  std::vector<int> args;
+  size_t start = 0;
+  while (start <= arg_str.size() && !arg_str.empty()) {
+    size_t comma = arg_str.find(',', start);
+    std::string item = arg_str.substr(start, comma == std::string::npos ? comma : comma - start);
+    args.push_back(static_cast<int>(std::floor(std::strtod(item.c_str(), nullptr))));
+    if (comma == std::string::npos) {
+      break;
+    }
+    start = comma + 1;
+  }
+  auto arg_count_is = [&](size_t lo, size_t hi) { return args.size() >= lo && args.size() <= hi; };
+
+  std::lock_guard<std::mutex> lock(_world_mutex);
+  if (name == "world.setBlock" && arg_count_is(4, 5)) {
+    BlockType block(args[3], args.size() > 4 ? args[4] : 0);
+    _world.set({args[0], args[1], args[2]}, block);
+    return "";
+  }
+  if (name == "world.setBlocks" && arg_count_is(7, 8)) {
+    BlockType block(args[6], args.size() > 7 ? args[7] : 0);
+    for (int y = std::min(args[1], args[4]); y <= std::max(args[1], args[4]); y++) {
+      for (int x = std::min(args[0], args[3]); x <= std::max(args[0], args[3]); x++) {
+        for (int z = std::min(args[2], args[5]); z <= std::max(args[2], args[5]); z++) {
+          _world.set({x, y, z}, block);
+        }
+      }
+    }
+    return "";
+  }
+  if (name == "world.getBlock" && arg_count_is(3, 3)) {
+    return std::to_string(_world.get({args[0], args[1], args[2]}).id);
+  }
+  if (name == "world.getBlockWithData" && arg_count_is(3, 3)) {
+    BlockType block = _world.get({args[0], args[1], args[2]});
+    return std::to_string(block.id) + "," + std::to_string(block.mod);
+  }
+  if (name == "world.getBlocksWithData" && arg_count_is(6, 6)) {
+    std::string reply;
+    for (int y = std::min(args[1], args[4]); y <= std::max(args[1], args[4]); y++) {
+      for (int x = std::min(args[0], args[3]); x <= std::max(args[0], args[3]); x++) {
+        for (int z = std::min(args[2], args[5]); z <= std::max(args[2], args[5]); z++) {
+          BlockType block = _world.get({x, y, z});
+          if (!reply.empty()) {
+            reply += ';';
+          }
+          reply += std::to_string(block.id);
+          reply += ',';
+          reply += std::to_string(block.mod);
+        }
+      }
+    }
+    return reply;
+  }
+  if (name == "world.getHeight" && arg_count_is(2, 2)) {
+    return std::to_string(_world.height(args[0], args[1]));
+  }
+  if (name == "world.getHeights" && arg_count_is(4, 4)) {
+    std::string reply;
+    for (int x = std::min(args[0], args[2]); x <= std::max(args[0], args[2]); x++) {
+      for (int z = std::min(args[1], args[3]); z <= std::max(args[1], args[3]); z++) {
+        if (!reply.empty()) {
+          reply += ',';
+        }
+        reply += std::to_string(_world.height(x, z));
+      }
+    }
+    return reply;
+  }
+  if (name == "player.setPos" && arg_count_is(3, 3)) {
+    _player = {args[0], args[1], args[2]};
+    return "";
+  }
+  if (name == "player.getPos") {
+    return std::to_string(_player.x) + "," + std::to_string(_player.y) + "," +
+           std::to_string(_player.z);
+  }
+  return "Fail";
+}
+
+StubProcess::StubProcess(std::chrono::microseconds reply_delay) {
+  int port_pipe[2];
+  int control_pipe[2];
+  if (pipe(port_pipe) < 0 || pipe(control_pipe) < 0) {
+    throw std::runtime_error("Failed to create stub server pipes.");
+  }
+
+  _pid = fork();
+  if (_pid < 0) {
+    throw std::runtime_error("Failed to fork stub server.");
+  }
+  if (_pid == 0) {
+    close(port_pipe[0]);
+    close(control_pipe[1]);
+    uint16_t port = 0;
+    try {
+      StubServer server(0, reply_delay);
+      port = server.port();
+      write(port_pipe[1], &port, sizeof(port));
+      close(port_pipe[1]);
+
+      // Serve until the parent closes the control pipe or exits
+      char byte;
+      while (read(control_pipe[0], &byte, 1) > 0) {
+      }
+      server.stop();
+    } catch (const std::exception&) {
+      write(port_pipe[1], &port, sizeof(port));
+      _exit(1);
+    }
+    _exit(0);
+  }
+
+  close(port_pipe[1]);
+  close(control_pipe[0]);
+  _control_fd = control_pipe[1];
+  ssize_t got = read(port_pipe[0], &_port, sizeof(_port));
+  close(port_pipe[0]);
+  if (got != sizeof(_port) || _port == 0) {
+    throw std::runtime_error("Stub server process failed to start.");
+  }
+}
+
+StubProcess::~StubProcess() {
+  close(_control_fd);
+  waitpid(_pid, nullptr, 0);
+}
+
+StubStats parse_stats(const std::string& reply) {
+  unsigned long long commands = 0;
+  unsigned long long bytes_in = 0;
+  unsigned long long bytes_out = 0;
+  if (std::sscanf(reply.c_str(), "%llu,%llu,%llu", &commands, &bytes_in, &bytes_out) != 3) {
+    throw std::runtime_error("Malformed stub.stats reply: " + reply);
+  }
+  return {commands, bytes_in, bytes_out};
+}
+
+} // namespace mcpp::bench
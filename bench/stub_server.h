@@ -0,0 +1,131 @@
+#pragma once
+
+#include "../include/mcpp/block.h"
+#include "../include/mcpp/coordinate.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/** @file
+ * @brief StubServer class.
+ *
+ * Local stand-in for a Spigot server running ELCI, used by the benchmarks so
+ * that results do not depend on a real Minecraft server. It speaks the same
+ * line protocol and keeps an in-memory world, but does no game simulation.
+ */
+namespace mcpp::bench {
+
+struct StubStats {
+  uint64_t commands;
+  uint64_t bytes_in;
+  uint64_t bytes_out;
+};
+
+/**
+ * Sparse in-memory world stored as 16x16x16 sections. Everything is air except
+ * a bedrock floor at y = -64.
+ */
+class StubWorld {
+private:
+  static constexpr int kSectionSize = 16;
+  static constexpr int kFloorY = -64;
+
+  using Section = std::vector<BlockType>;
+
+  std::unordered_map<Coordinate, Section, Coordinate> _sections;
+  std::unordered_map<Coordinate2D, int, Coordinate2D> _heights;
+
+  static Coordinate section_of(const Coordinate& pos);
+  static size_t index_in_section(const Coordinate& pos);
+
+public:
+  BlockType get(const Coordinate& pos) const;
+  void set(const Coordinate& pos, BlockType block);
+  int height(int x, int z) const;
+};
+
+class StubServer {
+private:
+  int _listen_fd = -1;
+  uint16_t _port = 0;
+  std::chrono::microseconds _reply_delay;
+
+  std::atomic<bool> _running{true};
+  std::thread _accept_thread;
+  std::mutex _clients_mutex;
+  std::vector<int> _client_fds;
+  std::vector<std::thread> _client_threads;
+
+  std::mutex _world_mutex;
+  StubWorld _world;
+  Coordinate _player{0, 0, 0};
+
+  std::atomic<uint64_t> _commands{0};
+  std::atomic<uint64_t> _bytes_in{0};
+  std::atomic<uint64_t> _bytes_out{0};
+
+  void accept_loop();
+  void serve(int fd);
+  std::string handle(const std::string& line);
+
+public:
+  /**
+   * Starts listening on 127.0.0.1.
+   *
+   * @param port Port to listen on, 0 picks a free port
+   * @param reply_delay Artificial processing time added before every reply
+   */
+  explicit StubServer(uint16_t port = 0,
+                      std::chrono::microseconds reply_delay = std::chrono::microseconds(0));
+  ~StubServer();
+
+  StubServer(const StubServer&) = delete;
+  StubServer& operator=(const StubServer&) = delete;
+
+  uint16_t port() const { return _port; }
+
+  StubStats stats() const;
+
+  /**
+   * Stops accepting connections, disconnects clients and joins all threads.
+   */
+  void stop();
+};
+
+/**
+ * Runs a StubServer in a forked child process, so that the memory and CPU use
+ * of the stand-in world are not attributed to the client being measured. Must
+ * be created before the calling process starts any threads.
+ */
+class StubProcess {
+private:
+  int _pid = -1;
+  int _control_fd = -1;
+  uint16_t _port = 0;
+
+public:
+  explicit StubProcess(std::chrono::microseconds reply_delay = std::chrono::microseconds(0));
+  ~StubProcess();
+
+  StubProcess(const StubProcess&) = delete;
+  StubProcess& operator=(const StubProcess&) = delete;
+
+  uint16_t port() const { return _port; }
+};
+
+/**
+ * Parses the reply of the stub-only "stub.stats()" command, which reports the
+ * server's traffic counters as "commands,bytes_in,bytes_out". Counts exclude
+ * all stub.* queries.
+ *
+ * @param reply Response of the stub.stats command
+ */
+StubStats parse_stats(const std::string& reply);
+
+} // namespace mcpp::bench
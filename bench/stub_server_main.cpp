@@ -0,0 +1,55 @@
+#include "stub_server.h"
+
+#include <csignal>
+#include <iostream>
+#include <limits>
+#include <pthread.h>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+/*
+ * Standalone stub server, handy for running the test suite or the examples
+ * without a Minecraft server.
+ *
+ * Usage: stub_server [port] [reply_delay_us]
+ */
+namespace {
+// Parses a whole argument as a number in [min, max]
+bool parse_arg(const std::string& arg, long min, long max, long& value) {
+  size_t end = 0;
+  try {
+    value = std::stol(arg, &end);
+  } catch (const std::logic_error&) {
+    // std::stol throws invalid_argument or out_of_range
+    return false;
+  }
+  return end == arg.size() && value >= min && value <= max;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+  long port = 4711;
+  long delay_us = 0;
+  if (argc > 3 || (argc > 1 && !parse_arg(argv[1], 0, 65535, port)) ||
+      (argc > 2 && !parse_arg(argv[2], 0, std::numeric_limits<long>::max(), delay_us))) {
+    std::cerr << "Usage: stub_server [port] [reply_delay_us]" << std::endl;
+    return 2;
+  }
+
+  // Blocked before the server starts its threads so they inherit the mask
+  // and the signals are left to sigwait below
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  mcpp::bench::StubServer server(static_cast<uint16_t>(port), std::chrono::microseconds(delay_us));
+  std::cout << "Stub server listening on 127.0.0.1:" << server.port() << std::endl;
+
+  // Serve until interrupted
+  int received;
+  sigwait(&signals, &received);
+  return 0;
+}
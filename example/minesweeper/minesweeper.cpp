@@ -14,8 +14,8 @@
 
 class Minesweeper {
 private:
-  const int X_SIZE = 10;
-  const int Z_SIZE = 10;
+  static constexpr int X_SIZE = 10;
+  static constexpr int Z_SIZE = 10;
   const int MINE_COUNT = 20;
 
   int*** field;
@@ -70,7 +70,7 @@ bool Minesweeper::GameLoop() {
   bool finish = true;
   while (finish) {
     usleep(50000);
-    mcpp::Chunk choices = mc.getBlocks(cornerOrigin, cornerOpposite);
+    auto choices = mc.getBlocks<X_SIZE, 1, Z_SIZE>(cornerOrigin);
     for (int x = 0; x < X_SIZE; x++) {
       for (int z = 0; z < Z_SIZE; z++) {
         printer.x = origin.x + x;
@@ -172,7 +172,7 @@ Minesweeper::Minesweeper() {
 }
 
 bool Minesweeper::Playing() {
-  mcpp::Chunk choices = mc.getBlocks(cornerOrigin, cornerOpposite);
+  auto choices = mc.getBlocks<X_SIZE, 1, Z_SIZE>(cornerOrigin);
   for (int x = 0; x < X_SIZE; x++) {
     for (int z = 0; z < Z_SIZE; z++) {
       printer.x = origin.x + x;
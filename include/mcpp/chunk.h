@@ -2,38 +2,177 @@
 
 #include "block.h"
 #include "coordinate.h"
+#include "hash_tree.h"
+#include <array>
+#include <cstdint>
+#include <iterator>
 #include <memory>
+#include <optional>
+#include <type_traits>
 #include <vector>
 
 namespace mcpp {
+class MinecraftConnection;
+
+/**
+ * Number of blocks of each BlockType in a Chunk, for ids 0-255 with mods
+ * 0-15.
+ */
+struct BlockHistogram {
+  /// Counts indexed id * 16 + mod
+  std::array<uint64_t, 256 * 16> counts{};
+  /// Blocks with a mod above 15, which have no slot of their own
+  uint64_t other = 0;
+
+  /**
+   * Gets the number of blocks of a BlockType.
+   * @param block: BlockType to look up, with a mod below 16
+   * @return number of blocks
+   */
+  uint64_t count(const BlockType& block) const {
+    return block.mod < 16 ? counts[(block.id * 16) + block.mod] : 0;
+  }
+};
+
+/**
+ * Blocks that differ between two Chunks covering the same area, see diff().
+ */
+struct ChunkDiff {
+  /// A changed block and the BlockType it changed to
+  struct Change {
+    Coordinate pos;
+    BlockType block;
+  };
+
+  /// One bit per block in Chunk iteration order, set where the chunks differ
+  std::vector<uint64_t> mask;
+  /// Every changed block in iteration order (y, then x, then z)
+  std::vector<Change> changes;
+
+  /**
+   * Checks whether a block changed.
+   * @param i: Index of the block in Chunk iteration order
+   * @return true if the block differs between the chunks
+   */
+  bool changed(size_t i) const { return ((mask[i / 64] >> (i % 64)) & 1) != 0; }
+
+  size_t size() const { return changes.size(); }
+  bool empty() const { return changes.empty(); }
+};
+
 /**
  * Stores a 3D cuboid of BlockTypes while preserving their relative location to
  * the base point they were gathered at and each other.
+ *
+ * Copies share their blocks until one of them is changed, so copying a chunk
+ * to keep a snapshot or pass it on is cheap. The first change to a shared
+ * chunk (set, replace, reshape, or taking a mutable iterator or data()
+ * pointer) gives it a private copy of the blocks first. Pointers and
+ * iterators obtained before copying a chunk must not be written through
+ * afterwards, as the blocks they point to are now shared.
+ *
+ * Changes waiting for commit() are not copied: a copy is a snapshot with
+ * nothing to commit, and assigning to a chunk drops its own pending changes.
  */
 struct Chunk {
 private:
   Coordinate _base_pt;
-  uint16_t _x_len;
-  uint16_t _y_len;
-  uint16_t _z_len;
-  std::unique_ptr<BlockType[]> _raw_data;
+  int32_t _x_len;
+  int32_t _y_len;
+  int32_t _z_len;
+  /// Shared between copies until one of them is changed
+  std::shared_ptr<BlockType[]> _raw_data;
+  /// One bit per block changed by set() since the last commit, allocated on
+  /// the first change so read-only chunks pay nothing for it
+  std::vector<uint64_t> _dirty;
+  /// Built by the first hashes() call and marked stale by changes from then
+  /// on, shared between copies like the blocks
+  mutable std::shared_ptr<HashTree> _hashes;
+
+  // Index and size arithmetic is done in size_t, large areas overflow int
+  size_t volume() const {
+    return static_cast<size_t>(_x_len) * static_cast<size_t>(_y_len) * static_cast<size_t>(_z_len);
+  }
+
+  size_t index(int x, int y, int z) const {
+    return (static_cast<size_t>(y) * static_cast<size_t>(_x_len) * static_cast<size_t>(_z_len)) +
+           (static_cast<size_t>(x) * static_cast<size_t>(_z_len)) + static_cast<size_t>(z);
+  }
+
+  // Sets the extents only, leaving the storage empty
+  Chunk(const Coordinate& loc1, const Coordinate& loc2);
+
+  // Gives this chunk its own copy of the blocks if they are shared
+  void unshare() {
+    if (_raw_data.use_count() > 1) {
+      copy_storage();
+    }
+  }
+  void copy_storage();
+
+  // Gives this chunk its own copy of the hashes if they are shared, returns
+  // nothing if they were never built
+  HashTree* own_hashes() {
+    if (_hashes && _hashes.use_count() > 1) {
+      _hashes = std::make_shared<HashTree>(*_hashes);
+    }
+    return _hashes.get();
+  }
+  // For writes that could touch any block
+  void invalidate_hashes() {
+    if (HashTree* hashes = own_hashes()) {
+      hashes->invalidate_all();
+    }
+  }
 
 public:
   // Constructors and assignment
   Chunk(const Coordinate& loc1, const Coordinate& loc2, const std::vector<BlockType>& block_list);
-  ~Chunk() = default;
 
-  Chunk(const Chunk& other)
-      : _base_pt(other._base_pt), _x_len(other._x_len), _y_len(other._y_len), _z_len(other._z_len) {
-    size_t size = _x_len * _y_len * _z_len;
-    _raw_data.reset(new BlockType[size]);
-    std::copy(other._raw_data.get(), other._raw_data.get() + size, _raw_data.get());
+  /**
+   * Constructs a chunk that takes ownership of an existing block array
+   * instead of copying it.
+   * @param loc1: 1st corner of the cuboid
+   * @param loc2: 2nd corner of the cuboid
+   * @param blocks: Array of exactly as many blocks as the cuboid holds, laid
+   * out as described by data()
+   */
+  template <typename Blocks,
+            typename = std::enable_if_t<std::is_same_v<Blocks, std::unique_ptr<BlockType[]>>>>
+  Chunk(const Coordinate& loc1, const Coordinate& loc2, Blocks&& blocks) : Chunk(loc1, loc2) {
+    // A template so that braced lists such as {0} still pick the vector
+    // constructor instead of converting to a null pointer
+    _raw_data = std::move(blocks);
   }
+  ~Chunk() = default;
 
+  Chunk(const Chunk& other)
+      : _base_pt(other._base_pt), _x_len(other._x_len), _y_len(other._y_len),
+        _z_len(other._z_len), _raw_data(other._raw_data), _hashes(other._hashes) {}
   Chunk(Chunk&& other) noexcept = default;
-  Chunk& operator=(const Chunk& other);
+  Chunk& operator=(const Chunk& other) {
+    // Assigning a chunk to itself must not drop its pending changes
+    if (this == &other) {
+      return *this;
+    }
+    _base_pt = other._base_pt;
+    _x_len = other._x_len;
+    _y_len = other._y_len;
+    _z_len = other._z_len;
+    _raw_data = other._raw_data;
+    _hashes = other._hashes;
+    _dirty.clear();
+    return *this;
+  }
   Chunk& operator=(Chunk&& other) = default;
 
+  /**
+   * Checks whether the blocks are currently shared with a copy of this
+   * chunk, in which case the next change will copy them.
+   * @return true if the storage is shared
+   */
+  bool is_shared() const { return _raw_data.use_count() > 1; }
+
   /**
    * Accesses the Minecraft block at absolute position pos and returns its
    * BlockType if it is in the included area.
@@ -53,23 +192,123 @@ public:
    */
   BlockType get(int x, int y, int z) const;
 
+  /**
+   * Replaces the block at an absolute position in the Minecraft world and
+   * marks it to be written by commit().
+   * @param pos: Absolute position in the Minecraft world
+   * @param block: BlockType to store
+   */
+  void set_worldspace(const Coordinate& pos, const BlockType& block);
+
+  /**
+   * Local equivalent of set_worldspace, replaces the block at an offset from
+   * the base point and marks it to be written by commit(). Writes through
+   * iterators are not tracked.
+   * @param x: x element of array access
+   * @param y: y element of array access
+   * @param z: z element of array access
+   * @param block: BlockType to store
+   */
+  void set(int x, int y, int z, const BlockType& block);
+
+  /**
+   * Makes the chunk cover the cuboid between loc1 and loc2, keeping its
+   * storage when the number of blocks is unchanged so it can be refilled
+   * without allocating. The blocks are unspecified afterwards and changes
+   * not yet committed are dropped.
+   * @param loc1: 1st corner of the cuboid
+   * @param loc2: 2nd corner of the cuboid
+   */
+  void reshape(const Coordinate& loc1, const Coordinate& loc2);
+
+  /**
+   * Gets the number of blocks changed by set() since the last commit.
+   * @return number of changed blocks
+   */
+  size_t dirty_count() const;
+
+  /**
+   * Writes the blocks changed by set() back to the world and clears the
+   * changes. Changed blocks of the same BlockType are merged into as few
+   * cuboids as possible, each sent as a single setBlocks, and unchanged
+   * blocks are never written.
+   * @param mc: Connection to write through
+   * @return number of setBlock and setBlocks calls made
+   */
+  size_t commit(MinecraftConnection& mc);
+
+  /*
+   * Scans over the whole chunk. These run vectorised kernels over the block
+   * storage, using AVX2 or SSE2 when the CPU supports them. With match_mod
+   * false only the ids of blocks are compared.
+   */
+
+  /**
+   * Counts the blocks matching a BlockType.
+   * @param block: BlockType to count
+   * @param match_mod: Whether the mod has to match as well as the id
+   * @return number of matching blocks
+   */
+  size_t count(const BlockType& block, bool match_mod = true) const;
+
+  /**
+   * Finds the first block matching a BlockType, in iteration order (y, then
+   * x, then z).
+   * @param block: BlockType to find
+   * @param match_mod: Whether the mod has to match as well as the id
+   * @return Absolute position of the block, or nothing if there is none
+   */
+  std::optional<Coordinate> find_first(const BlockType& block, bool match_mod = true) const;
+
+  /**
+   * Counts the blocks of every BlockType.
+   * @return Histogram of the chunk's blocks
+   */
+  BlockHistogram histogram() const;
+
+  /**
+   * Replaces every block matching a BlockType, marking the replaced blocks
+   * to be written by commit().
+   * @param from: BlockType to replace
+   * @param to: BlockType to replace with
+   * @param match_mod: Whether the mod has to match as well as the id
+   * @return number of replaced blocks
+   */
+  size_t replace(const BlockType& from, const BlockType& to, bool match_mod = true);
+
+  /**
+   * Gets a Merkle tree of hashes over the chunk's 16x16x16 sections. The
+   * tree is built on the first call and afterwards kept up to date by
+   * rehashing only the sections changed since the previous call: set()
+   * marks the section it writes to, while replace() and mutable iterators
+   * or data() mark every section, so the next call rehashes the whole chunk
+   * even if nothing was written. That includes a range-for over a non-const
+   * chunk; read through std::as_const(chunk), cbegin() or a const reference
+   * to keep the tree current. Not safe to call concurrently on the same
+   * chunk, as it may update the cached tree, but copies sharing a tree can
+   * be hashed on different threads: a stale shared tree is copied before it
+   * is refreshed.
+   * @return Hash tree, valid until the chunk is next changed
+   */
+  const HashTree& hashes() const;
+
   /**
    * Gets the x length of the Chunk.
    * @return x length of the Chunk
    */
-  uint16_t x_len() const;
+  int32_t x_len() const;
 
   /**
    * Gets the y length of the Chunk.
    * @return y length of the Chunk
    */
-  uint16_t y_len() const;
+  int32_t y_len() const;
 
   /**
    * Gets the z length of the Chunk.
    * @return z length of the Chunk
    */
-  uint16_t z_len() const;
+  int32_t z_len() const;
 
   /**
    * Gets the minimum coordinate in the Chunk.
@@ -77,6 +316,56 @@ public:
    */
   Coordinate base_pt() const;
 
+  /*
+   * Unchecked access. These are inline and do no bounds checking, so an
+   * offset outside the chunk is undefined behaviour. Use get() and
+   * get_worldspace() unless the loop bounds already guarantee the offsets.
+   */
+
+  /**
+   * Unchecked equivalent of get.
+   * @param x: x offset from the base point, in [0, x_len)
+   * @param y: y offset from the base point, in [0, y_len)
+   * @param z: z offset from the base point, in [0, z_len)
+   * @return BlockType at specified offset
+   */
+  const BlockType& operator()(int x, int y, int z) const { return _raw_data[index(x, y, z)]; }
+
+  /**
+   * Unchecked equivalent of get_worldspace.
+   * @param pos: Absolute position in the Minecraft world, inside the chunk
+   * @return BlockType at specified location
+   */
+  const BlockType& at_unchecked(const Coordinate& pos) const {
+    return _raw_data[index(pos.x - _base_pt.x, pos.y - _base_pt.y, pos.z - _base_pt.z)];
+  }
+
+  /**
+   * Gets the underlying block array, laid out so the block at offset
+   * (x, y, z) is at y * y_stride() + x * x_stride() + z. Writes through the
+   * array are not tracked by commit(), and the non-const overload marks every
+   * section for rehashing, see hashes().
+   * @return Pointer to the first of size() blocks
+   */
+  BlockType* data() {
+    unshare();
+    invalidate_hashes();
+    return _raw_data.get();
+  }
+  const BlockType* data() const { return _raw_data.get(); }
+
+  /**
+   * Gets the number of blocks in the Chunk.
+   * @return x_len * y_len * z_len
+   */
+  size_t size() const { return volume(); }
+
+  /// Distance in blocks between neighbours along x in data()
+  size_t x_stride() const { return static_cast<size_t>(_z_len); }
+
+  /// Distance in blocks between neighbours along y in data()
+  size_t y_stride() const { return static_cast<size_t>(_x_len) * static_cast<size_t>(_z_len); }
+
   /**
    * @brief An iterator for the Chunk's 3D block data.
    *
@@ -86,7 +375,7 @@ public:
    * access to the elements stored in the chunk.
    */
   struct Iterator {
-    using iterator_category = std::forward_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
     using difference_type = std::ptrdiff_t;
     using value_type = BlockType;
     using pointer = BlockType*;
@@ -97,7 +386,7 @@ public:
      *
      * @param ptr Pointer to the position in the height array.
      */
-    Iterator(pointer ptr) : m_ptr(ptr) {}
+    Iterator(pointer ptr = nullptr) : m_ptr(ptr) {}
 
     /**
      * @brief Dereference the iterator to access the value at the current
@@ -139,6 +428,76 @@ public:
       return tmp;
     }
 
+    /**
+     * @brief Pre-decrement operator. Moves the iterator to the previous
+     * position.
+     *
+     * @return Reference to the updated iterator.
+     */
+    Iterator& operator--() {
+      m_ptr--;
+      return *this;
+    }
+
+    /**
+     * @brief Post-decrement operator. Moves the iterator to the previous
+     * position.
+     *
+     * @param int Unused dummy parameter to differentiate from prefix
+     * decrement.
+     * @return Iterator to the original position before decrementing.
+     */
+    Iterator operator--(int) {
+      Iterator tmp = *this;
+      --(*this);
+      return tmp;
+    }
+
+    /**
+     * @brief Advances the iterator by n positions, which may be negative.
+     *
+     * @param n Number of positions to move.
+     * @return Reference to the updated iterator.
+     */
+    Iterator& operator+=(difference_type n) {
+      m_ptr += n;
+      return *this;
+    }
+
+    /**
+     * @brief Moves the iterator back by n positions.
+     *
+     * @param n Number of positions to move.
+     * @return Reference to the updated iterator.
+     */
+    Iterator& operator-=(difference_type n) {
+      m_ptr -= n;
+      return *this;
+    }
+
+    /**
+     * @brief Accesses the element n positions after the current one.
+     *
+     * @param n Offset from the current position.
+     * @return Reference to the element.
+     */
+    reference operator[](difference_type n) const { return m_ptr[n]; }
+
+    friend Iterator operator+(Iterator it, difference_type n) { return it += n; }
+    friend Iterator operator+(difference_type n, Iterator it) { return it += n; }
+    friend Iterator operator-(Iterator it, difference_type n) { return it -= n; }
+
+    /**
+     * @brief Distance between two iterators.
+     *
+     * @param a End iterator.
+     * @param b Start iterator.
+     * @return Number of positions from b to a.
+     */
+    friend difference_type operator-(const Iterator& a, const Iterator& b) {
+      return a.m_ptr - b.m_ptr;
+    }
+
     /**
      * @brief Equality comparison operator.
      *
@@ -159,6 +518,11 @@ public:
      */
     friend bool operator!=(const Iterator& a, const Iterator& b) { return a.m_ptr != b.m_ptr; };
 
+    friend bool operator<(const Iterator& a, const Iterator& b) { return a.m_ptr < b.m_ptr; }
+    friend bool operator>(const Iterator& a, const Iterator& b) { return a.m_ptr > b.m_ptr; }
+    friend bool operator<=(const Iterator& a, const Iterator& b) { return a.m_ptr <= b.m_ptr; }
+    friend bool operator>=(const Iterator& a, const Iterator& b) { return a.m_ptr >= b.m_ptr; }
+
   private:
     pointer m_ptr;
   };
@@ -172,7 +536,7 @@ public:
    * sequential immutable access to the elements stored in the chunk.
    */
   struct ConstIterator {
-    using iterator_category = std::forward_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
     using difference_type = std::ptrdiff_t;
     using value_type = BlockType;
     using pointer = const BlockType*;
@@ -183,7 +547,7 @@ public:
      *
      * @param ptr Pointer to the position in the height array.
      */
-    ConstIterator(pointer ptr) : m_ptr(ptr) {}
+    ConstIterator(pointer ptr = nullptr) : m_ptr(ptr) {}
 
     /**
      * @brief Dereference the iterator to access the value at the current
@@ -225,6 +589,76 @@ public:
       return tmp;
     }
 
+    /**
+     * @brief Pre-decrement operator. Moves the iterator to the previous
+     * position.
+     *
+     * @return Reference to the updated iterator.
+     */
+    ConstIterator& operator--() {
+      m_ptr--;
+      return *this;
+    }
+
+    /**
+     * @brief Post-decrement operator. Moves the iterator to the previous
+     * position.
+     *
+     * @param int Unused dummy parameter to differentiate from prefix
+     * decrement.
+     * @return Iterator to the original position before decrementing.
+     */
+    ConstIterator operator--(int) {
+      ConstIterator tmp = *this;
+      --(*this);
+      return tmp;
+    }
+
+    /**
+     * @brief Advances the iterator by n positions, which may be negative.
+     *
+     * @param n Number of positions to move.
+     * @return Reference to the updated iterator.
+     */
+    ConstIterator& operator+=(difference_type n) {
+      m_ptr += n;
+      return *this;
+    }
+
+    /**
+     * @brief Moves the iterator back by n positions.
+     *
+     * @param n Number of positions to move.
+     * @return Reference to the updated iterator.
+     */
+    ConstIterator& operator-=(difference_type n) {
+      m_ptr -= n;
+      return *this;
+    }
+
+    /**
+     * @brief Accesses the element n positions after the current one.
+     *
+     * @param n Offset from the current position.
+     * @return Reference to the element.
+     */
+    reference operator[](difference_type n) const { return m_ptr[n]; }
+
+    friend ConstIterator operator+(ConstIterator it, difference_type n) { return it += n; }
+    friend ConstIterator operator+(difference_type n, ConstIterator it) { return it += n; }
+    friend ConstIterator operator-(ConstIterator it, difference_type n) { return it -= n; }
+
+    /**
+     * @brief Distance between two iterators.
+     *
+     * @param a End iterator.
+     * @param b Start iterator.
+     * @return Number of positions from b to a.
+     */
+    friend difference_type operator-(const ConstIterator& a, const ConstIterator& b) {
+      return a.m_ptr - b.m_ptr;
+    }
+
     /**
      * @brief Equality comparison operator.
      *
@@ -249,14 +683,180 @@ public:
       return a.m_ptr != b.m_ptr;
     };
 
+    friend bool operator<(const ConstIterator& a, const ConstIterator& b) {
+      return a.m_ptr < b.m_ptr;
+    }
+    friend bool operator>(const ConstIterator& a, const ConstIterator& b) {
+      return a.m_ptr > b.m_ptr;
+    }
+    friend bool operator<=(const ConstIterator& a, const ConstIterator& b) {
+      return a.m_ptr <= b.m_ptr;
+    }
+    friend bool operator>=(const ConstIterator& a, const ConstIterator& b) {
+      return a.m_ptr >= b.m_ptr;
+    }
+
   private:
     pointer m_ptr;
   };
 
+  /// Block of a Chunk together with its absolute position in the world
+  struct Cell {
+    Coordinate pos;
+    BlockType block;
+  };
+
+  /**
+   * @brief An iterator over the blocks of a const Chunk and their positions.
+   *
+   * Visits blocks in storage order (y, then x, then z) and keeps the
+   * position of the current block up to date by stepping it along with the
+   * pointer, so no index is ever divided back into a position and nothing
+   * is bounds checked.
+   */
+  struct CellIterator {
+    using iterator_category = std::input_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = Cell;
+    using pointer = const Cell*;
+    using reference = Cell;
+
+    /**
+     * @brief Constructs an iterator at the first block of a chunk.
+     *
+     * @param chunk Chunk to iterate over.
+     */
+    explicit CellIterator(const Chunk& chunk)
+        : m_ptr(chunk._raw_data.get()), m_pos(chunk._base_pt),
+          m_x_begin(chunk._base_pt.x), m_x_end(chunk._base_pt.x + chunk._x_len),
+          m_z_begin(chunk._base_pt.z), m_z_end(chunk._base_pt.z + chunk._z_len) {}
+
+    /**
+     * @brief Constructs an end iterator.
+     *
+     * @param ptr Pointer one past the last block.
+     */
+    explicit CellIterator(const BlockType* ptr) : m_ptr(ptr) {}
+
+    /**
+     * @brief Gets the current block and its position.
+     *
+     * @return Cell of the current block.
+     */
+    reference operator*() const { return {m_pos, *m_ptr}; }
+
+    /**
+     * @brief Pre-increment operator. Advances to the next block, wrapping
+     * z into x and x into y at the edges of the chunk.
+     *
+     * @return Reference to the updated iterator.
+     */
+    CellIterator& operator++() {
+      m_ptr++;
+      if (++m_pos.z == m_z_end) {
+        m_pos.z = m_z_begin;
+        if (++m_pos.x == m_x_end) {
+          m_pos.x = m_x_begin;
+          m_pos.y++;
+        }
+      }
+      return *this;
+    }
+
+    /**
+     * @brief Post-increment operator. Advances to the next block.
+     *
+     * @param int Unused dummy parameter to differentiate from prefix
+     * increment.
+     * @return Iterator to the original position before incrementing.
+     */
+    CellIterator operator++(int) {
+      CellIterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    friend bool operator==(const CellIterator& a, const CellIterator& b) {
+      return a.m_ptr == b.m_ptr;
+    }
+
+    friend bool operator!=(const CellIterator& a, const CellIterator& b) {
+      return a.m_ptr != b.m_ptr;
+    }
+
+  private:
+    const BlockType* m_ptr;
+    Coordinate m_pos;
+    int32_t m_x_begin = 0;
+    int32_t m_x_end = 0;
+    int32_t m_z_begin = 0;
+    int32_t m_z_end = 0;
+  };
+
+  /// Range of every Cell in a Chunk, returned by cells()
+  struct CellRange {
+    CellIterator first;
+    CellIterator last;
+
+    CellIterator begin() const { return first; }
+    CellIterator end() const { return last; }
+  };
+
+  /**
+   * Gets a range over every block of the chunk together with its absolute
+   * position, in storage order (y, then x, then z). The range is invalidated
+   * by anything that invalidates the chunk's iterators.
+   * @return Range of Cells, usable as `for (auto [pos, block] : chunk.cells())`
+   */
+  CellRange cells() const {
+    return {CellIterator(*this), CellIterator(_raw_data.get() + volume())};
+  }
+
   // Iterators
-  Iterator begin() { return Iterator(&_raw_data[0]); }
-  Iterator end() { return Iterator(&_raw_data[_x_len * _y_len * _z_len]); }
+  Iterator begin() {
+    unshare();
+    invalidate_hashes();
+    return Iterator(&_raw_data[0]);
+  }
+  Iterator end() {
+    unshare();
+    invalidate_hashes();
+    return Iterator(&_raw_data[volume()]);
+  }
   ConstIterator begin() const { return ConstIterator(&_raw_data[0]); }
-  ConstIterator end() const { return ConstIterator(&_raw_data[_x_len * _y_len * _z_len]); }
+  ConstIterator end() const { return ConstIterator(&_raw_data[volume()]); }
+  ConstIterator cbegin() const { return begin(); }
+  ConstIterator cend() const { return end(); }
 };
+
+/**
+ * Finds the blocks that differ between two polls of the same area. Runs of
+ * 32 blocks that are identical in both are skipped with wide compares, and
+ * chunks that still share their blocks are not compared at all.
+ * @param before: Earlier chunk
+ * @param after: Later chunk, covering the same area as before
+ * @return Mask and list of the changed blocks, with their BlockTypes in after
+ */
+ChunkDiff diff(const Chunk& before, const Chunk& after);
+
+/**
+ * Equivalent of diff that refills an existing ChunkDiff, reusing its storage
+ * so that polling the same area repeatedly does not allocate.
+ * @param before: Earlier chunk
+ * @param after: Later chunk, covering the same area as before
+ * @param out: Overwritten with the changes
+ */
+void diff(const Chunk& before, const Chunk& after, ChunkDiff& out);
+
+/**
+ * Finds the 16x16x16 sections that differ between two polls of the same area
+ * by walking their hash trees, so only sections changed since each chunk was
+ * last hashed are read. Sections at the far edges may be cut short by the
+ * chunks' extents. Taking a mutable iterator or data() from either chunk
+ * since it was last hashed forces a full rehash, see Chunk::hashes().
+ * @param before: Earlier chunk
+ * @param after: Later chunk, covering the same area as before
+ * @return Minimum corners of the changed sections, in iteration order
+ */
+std::vector<Coordinate> changed_sections(const Chunk& before, const Chunk& after);
 } // namespace mcpp
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "block.h"
+#include "chunk.h"
+#include "coordinate.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+/** @file
+ * @brief ChunkView class.
+ */
+namespace mcpp {
+/**
+ * Non-owning, read-only view of a cuboid of blocks inside a Chunk, another
+ * view or any storage laid out like a Chunk. Holds a pointer to the first
+ * block, the extents and the distances between neighbouring blocks along y
+ * and x (blocks along z are always adjacent), so slicing by layer or sub-box
+ * copies nothing. The viewed storage must outlive the view.
+ */
+class ChunkView {
+private:
+  const BlockType* _data;
+  Coordinate _base_pt;
+  int32_t _x_len;
+  int32_t _y_len;
+  int32_t _z_len;
+  size_t _x_stride;
+  size_t _y_stride;
+
+  ChunkView(const BlockType* data, const Coordinate& base_pt, int32_t x_len, int32_t y_len,
+            int32_t z_len, size_t x_stride, size_t y_stride)
+      : _data(data), _base_pt(base_pt), _x_len(x_len), _y_len(y_len), _z_len(z_len),
+        _x_stride(x_stride), _y_stride(y_stride) {}
+
+  const BlockType* at(int x, int y, int z) const {
+    return _data + (static_cast<size_t>(y) * _y_stride) + (static_cast<size_t>(x) * _x_stride) +
+           z;
+  }
+
+public:
+  /**
+   * Views the whole of a chunk.
+   * @param chunk: Chunk to view
+   */
+  ChunkView(const Chunk& chunk);
+
+  // A view of a temporary chunk would dangle as soon as it was made
+  ChunkView(Chunk&&) = delete;
+
+  /**
+   * Views contiguous blocks laid out like a Chunk's (y, then x, then z).
+   * @param data: First block, followed by x_len * y_len * z_len - 1 more
+   * @param base_pt: Minimum corner of the cuboid
+   * @param x_len: x length
+   * @param y_len: y length
+   * @param z_len: z length
+   */
+  ChunkView(const BlockType* data, const Coordinate& base_pt, int32_t x_len, int32_t y_len,
+            int32_t z_len)
+      : ChunkView(data, base_pt, x_len, y_len, z_len, z_len,
+                  static_cast<size_t>(x_len) * static_cast<size_t>(z_len)) {}
+
+  /**
+   * Local equivalent of get_worldspace, equivalent to a 3D array access.
+   * @param x: x element of array access
+   * @param y: y element of array access
+   * @param z: z element of array access
+   * @return BlockType at specified location
+   */
+  BlockType get(int x, int y, int z) const;
+
+  /**
+   * Accesses the Minecraft block at absolute position pos and returns its
+   * BlockType if it is in the viewed area.
+   * @param pos: Absolute position in the Minecraft world to query BlockType
+   * for
+   * @return BlockType at specified location
+   */
+  BlockType get_worldspace(const Coordinate& pos) const;
+
+  /**
+   * Views a single horizontal layer.
+   * @param y: y offset of the layer from the base point
+   * @return View of the layer, with a y length of 1
+   */
+  ChunkView layer(int y) const;
+
+  /**
+   * Views the cuboid between loc1 and loc2, which must lie inside this view.
+   * @param loc1: 1st corner of the cuboid in world coordinates
+   * @param loc2: 2nd corner of the cuboid in world coordinates
+   * @return View of the cuboid
+   */
+  ChunkView slice(const Coordinate& loc1, const Coordinate& loc2) const;
+
+  /**
+   * Copies the viewed blocks into a Chunk of their own.
+   * @return Chunk with the same area and blocks
+   */
+  Chunk to_chunk() const;
+
+  int32_t x_len() const { return _x_len; }
+  int32_t y_len() const { return _y_len; }
+  int32_t z_len() const { return _z_len; }
+  Coordinate base_pt() const { return _base_pt; }
+
+  /// Distance in blocks between neighbours along x
+  size_t x_stride() const { return _x_stride; }
+
+  /// Distance in blocks between neighbours along y
+  size_t y_stride() const { return _y_stride; }
+
+  /**
+   * @brief Forward iterator over the viewed blocks in the same order as
+   * Chunk::ConstIterator (y, then x, then z), jumping between rows.
+   */
+  struct ConstIterator {
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = BlockType;
+    using pointer = const BlockType*;
+    using reference = const BlockType&;
+
+    ConstIterator(const ChunkView* view, int x, int y) : _view(view), _x(x), _y(y) { seek(); }
+
+    reference operator*() const { return *_ptr; }
+
+    pointer operator->() const { return _ptr; }
+
+    ConstIterator& operator++() {
+      if (++_ptr == _row_end) {
+        if (++_x == _view->_x_len) {
+          _x = 0;
+          ++_y;
+        }
+        seek();
+      }
+      return *this;
+    }
+
+    ConstIterator operator++(int) {
+      ConstIterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    friend bool operator==(const ConstIterator& a, const ConstIterator& b) {
+      return a._ptr == b._ptr;
+    }
+
+    friend bool operator!=(const ConstIterator& a, const ConstIterator& b) {
+      return a._ptr != b._ptr;
+    }
+
+  private:
+    // Past the last row the pointer is null rather than beyond the data
+    void seek() {
+      _ptr = _y < _view->_y_len ? _view->at(_x, _y, 0) : nullptr;
+      _row_end = _ptr != nullptr ? _ptr + _view->_z_len : nullptr;
+    }
+
+    const ChunkView* _view;
+    int _x;
+    int _y;
+    pointer _ptr;
+    pointer _row_end;
+  };
+
+  ConstIterator begin() const { return {this, 0, 0}; }
+  ConstIterator end() const { return {this, 0, _y_len}; }
+};
+} // namespace mcpp
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "block.h"
+#include "coordinate.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/** @file
+ * @brief HashTree class.
+ */
+namespace mcpp {
+struct Chunk;
+
+/**
+ * Merkle tree over the 16x16x16 sections of a Chunk, see Chunk::hashes().
+ * Sections are numbered in the same order as blocks (y, then x, then z) and
+ * those at the far edges may be cut short by the chunk's extents. Each leaf
+ * holds the hash of one section's blocks and each inner node the hash of its
+ * two children, so two trees over areas of the same size can be compared
+ * from the root down, visiting only the parts that differ.
+ *
+ * Hashes are for spotting changes, not cryptographic, and are only
+ * comparable between trees built in the same process.
+ */
+class HashTree {
+public:
+  static constexpr int SECTION_LEN = 16;
+
+  /**
+   * Gets the hash of every block in the area.
+   * @return root hash
+   */
+  uint64_t root() const { return _nodes[1]; }
+
+  /**
+   * Gets the number of sections.
+   * @return number of sections
+   */
+  size_t section_count() const { return _section_count; }
+
+  /**
+   * Gets the hash of a single section.
+   * @param section: Index of the section, in [0, section_count())
+   * @return hash of the section's blocks
+   */
+  uint64_t section_hash(size_t section) const { return _nodes[_leaves + section]; }
+
+  /**
+   * Gets the offset of a section's minimum corner from the chunk's base point.
+   * @param section: Index of the section, in [0, section_count())
+   * @return offset of the section's first block
+   */
+  Coordinate section_offset(size_t section) const;
+
+  /**
+   * Finds the sections whose hashes differ from another tree's, descending
+   * only into subtrees whose hashes differ.
+   * @param other: Tree over an area of the same size
+   * @return Indices of the differing sections, in increasing order
+   */
+  std::vector<size_t> changed_sections(const HashTree& other) const;
+
+private:
+  friend struct Chunk;
+
+  HashTree(int32_t x_len, int32_t y_len, int32_t z_len);
+
+  // Marks the section holding an offset from the base point for rehashing
+  void invalidate(int x, int y, int z);
+  void invalidate_all();
+  bool is_stale() const { return _any_stale; }
+
+  // Rehashes stale sections from the blocks of the chunk, and their parents
+  void refresh(const BlockType* blocks);
+  uint64_t hash_section(const BlockType* blocks, size_t section) const;
+
+  int32_t _x_len;
+  int32_t _y_len;
+  int32_t _z_len;
+  int32_t _sections_x;
+  int32_t _sections_z;
+  size_t _section_count;
+  /// Leaves in the tree, section_count rounded up to a power of two
+  size_t _leaves;
+  /// Heap order: the root at 1, the children of node i at 2i and 2i + 1
+  std::vector<uint64_t> _nodes;
+  /// One bit per section that changed since it was last hashed
+  std::vector<uint64_t> _stale;
+  bool _any_stale = true;
+};
+} // namespace mcpp
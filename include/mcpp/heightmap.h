@@ -2,7 +2,9 @@
 
 #include "coordinate.h"
 #include <cstdint>
+#include <iterator>
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace mcpp {
@@ -13,19 +15,42 @@ namespace mcpp {
 struct HeightMap {
 private:
   Coordinate2D _base_pt;
-  uint16_t _x_len;
-  uint16_t _z_len;
+  int32_t _x_len;
+  int32_t _z_len;
   std::unique_ptr<int16_t[]> _raw_heights;
 
+  // Index and size arithmetic is done in size_t, large areas overflow int
+  size_t area() const { return static_cast<size_t>(_x_len) * static_cast<size_t>(_z_len); }
+
+  // Sets the extents only, leaving the storage empty
+  HeightMap(const Coordinate2D& loc1, const Coordinate2D& loc2);
+
 public:
   // Constructors and assignment
   HeightMap(const Coordinate2D& loc1, const Coordinate2D& loc2,
             const std::vector<int16_t>& heights);
+
+  /**
+   * Constructs a height map that takes ownership of an existing height array
+   * instead of copying it.
+   * @param loc1: 1st corner of the rectangle
+   * @param loc2: 2nd corner of the rectangle
+   * @param heights: Array of exactly as many heights as the rectangle holds,
+   * laid out as described by data()
+   */
+  template <typename Heights,
+            typename = std::enable_if_t<std::is_same_v<Heights, std::unique_ptr<int16_t[]>>>>
+  HeightMap(const Coordinate2D& loc1, const Coordinate2D& loc2, Heights&& heights)
+      : HeightMap(loc1, loc2) {
+    // A template so that braced lists such as {0} still pick the vector
+    // constructor instead of converting to a null pointer
+    _raw_heights = std::move(heights);
+  }
   ~HeightMap() = default;
 
   HeightMap(const HeightMap& other)
       : _base_pt(other._base_pt), _x_len(other._x_len), _z_len(other._z_len) {
-    size_t size = _x_len * _z_len;
+    size_t size = area();
     // Allocate memory and copy the heights
     _raw_heights.reset(new int16_t[size]);
     std::copy(other._raw_heights.get(), other._raw_heights.get() + size, _raw_heights.get());
@@ -51,6 +76,15 @@ public:
    */
   int16_t get_worldspace(const Coordinate2D& loc) const;
 
+  /**
+   * Makes the map cover the rectangle between loc1 and loc2, keeping its
+   * storage when the number of heights is unchanged so it can be refilled
+   * without allocating. The heights are unspecified afterwards.
+   * @param loc1: 1st corner of the rectangle
+   * @param loc2: 2nd corner of the rectangle
+   */
+  void reshape(const Coordinate2D& loc1, const Coordinate2D& loc2);
+
   /**
    * Fill a coordinate inplace with the highest y coordinate at the `loc`'s x
    * and z components.
@@ -62,13 +96,13 @@ public:
    * Gets the x length of the HeightMap.
    * @return x length of the HeightMap
    */
-  uint16_t x_len() const;
+  int32_t x_len() const;
 
   /**
    * Gets the z length of the HeightMap.
    * @return z length of the HeightMap
    */
-  uint16_t z_len() const;
+  int32_t z_len() const;
 
   /**
    * Gets the minimum coordinate in the HeightMap.
@@ -76,6 +110,48 @@ public:
    */
   Coordinate2D base_pt() const;
 
+  /*
+   * Unchecked access. These are inline and do no bounds checking, so an
+   * offset outside the map is undefined behaviour.
+   */
+
+  /**
+   * Unchecked equivalent of get.
+   * @param x: x offset from the base point, in [0, x_len)
+   * @param z: z offset from the base point, in [0, z_len)
+   * @return height at specified offset
+   */
+  int16_t operator()(int x, int z) const {
+    return _raw_heights[(static_cast<size_t>(x) * static_cast<size_t>(_z_len)) +
+                        static_cast<size_t>(z)];
+  }
+
+  /**
+   * Unchecked equivalent of get_worldspace.
+   * @param loc: Coordinate2D in Minecraft world, inside the map
+   * @return height at specified coordinate
+   */
+  int16_t at_unchecked(const Coordinate2D& loc) const {
+    return (*this)(loc.x - _base_pt.x, loc.z - _base_pt.z);
+  }
+
+  /**
+   * Gets the underlying height array, laid out so the height at offset
+   * (x, z) is at x * x_stride() + z.
+   * @return Pointer to the first of size() heights
+   */
+  int16_t* data() { return _raw_heights.get(); }
+  const int16_t* data() const { return _raw_heights.get(); }
+
+  /**
+   * Gets the number of heights in the HeightMap.
+   * @return x_len * z_len
+   */
+  size_t size() const { return area(); }
+
+  /// Distance in heights between neighbours along x in data()
+  size_t x_stride() const { return static_cast<size_t>(_z_len); }
+
   /**
    * @brief An iterator for the HeightMap structure.
    *
@@ -83,7 +159,7 @@ public:
    * operations over the height data stored within a HeightMap.
    */
   struct Iterator {
-    using iterator_category = std::forward_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
     using difference_type = std::ptrdiff_t;
     using value_type = int16_t;
     using pointer = int16_t*;
@@ -94,7 +170,7 @@ public:
      *
      * @param ptr Pointer to the position in the height array.
      */
-    Iterator(pointer ptr) : m_ptr(ptr) {}
+    Iterator(pointer ptr = nullptr) : m_ptr(ptr) {}
 
     /**
      * @brief Dereference the iterator to access the value at the current
@@ -136,6 +212,76 @@ public:
       return tmp;
     }
 
+    /**
+     * @brief Pre-decrement operator. Moves the iterator to the previous
+     * position.
+     *
+     * @return Reference to the updated iterator.
+     */
+    Iterator& operator--() {
+      m_ptr--;
+      return *this;
+    }
+
+    /**
+     * @brief Post-decrement operator. Moves the iterator to the previous
+     * position.
+     *
+     * @param int Unused dummy parameter to differentiate from prefix
+     * decrement.
+     * @return Iterator to the original position before decrementing.
+     */
+    Iterator operator--(int) {
+      Iterator tmp = *this;
+      --(*this);
+      return tmp;
+    }
+
+    /**
+     * @brief Advances the iterator by n positions, which may be negative.
+     *
+     * @param n Number of positions to move.
+     * @return Reference to the updated iterator.
+     */
+    Iterator& operator+=(difference_type n) {
+      m_ptr += n;
+      return *this;
+    }
+
+    /**
+     * @brief Moves the iterator back by n positions.
+     *
+     * @param n Number of positions to move.
+     * @return Reference to the updated iterator.
+     */
+    Iterator& operator-=(difference_type n) {
+      m_ptr -= n;
+      return *this;
+    }
+
+    /**
+     * @brief Accesses the element n positions after the current one.
+     *
+     * @param n Offset from the current position.
+     * @return Reference to the element.
+     */
+    reference operator[](difference_type n) const { return m_ptr[n]; }
+
+    friend Iterator operator+(Iterator it, difference_type n) { return it += n; }
+    friend Iterator operator+(difference_type n, Iterator it) { return it += n; }
+    friend Iterator operator-(Iterator it, difference_type n) { return it -= n; }
+
+    /**
+     * @brief Distance between two iterators.
+     *
+     * @param a End iterator.
+     * @param b Start iterator.
+     * @return Number of positions from b to a.
+     */
+    friend difference_type operator-(const Iterator& a, const Iterator& b) {
+      return a.m_ptr - b.m_ptr;
+    }
+
     /**
      * @brief Equality comparison operator.
      *
@@ -156,6 +302,11 @@ public:
      */
     friend bool operator!=(const Iterator& a, const Iterator& b) { return a.m_ptr != b.m_ptr; };
 
+    friend bool operator<(const Iterator& a, const Iterator& b) { return a.m_ptr < b.m_ptr; }
+    friend bool operator>(const Iterator& a, const Iterator& b) { return a.m_ptr > b.m_ptr; }
+    friend bool operator<=(const Iterator& a, const Iterator& b) { return a.m_ptr <= b.m_ptr; }
+    friend bool operator>=(const Iterator& a, const Iterator& b) { return a.m_ptr >= b.m_ptr; }
+
   private:
     pointer m_ptr;
   };
@@ -167,7 +318,7 @@ public:
    * iterator operations over the height data stored within a HeightMap.
    */
   struct ConstIterator {
-    using iterator_category = std::forward_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
     using difference_type = std::ptrdiff_t;
     using value_type = int16_t;
     using pointer = const int16_t*;
@@ -178,7 +329,7 @@ public:
      *
      * @param ptr Pointer to the position in the height array.
      */
-    ConstIterator(pointer ptr) : m_ptr(ptr) {}
+    ConstIterator(pointer ptr = nullptr) : m_ptr(ptr) {}
 
     /**
      * @brief Dereference the iterator to access the value at the current
@@ -220,6 +371,76 @@ public:
       return tmp;
     }
 
+    /**
+     * @brief Pre-decrement operator. Moves the iterator to the previous
+     * position.
+     *
+     * @return Reference to the updated iterator.
+     */
+    ConstIterator& operator--() {
+      m_ptr--;
+      return *this;
+    }
+
+    /**
+     * @brief Post-decrement operator. Moves the iterator to the previous
+     * position.
+     *
+     * @param int Unused dummy parameter to differentiate from prefix
+     * decrement.
+     * @return Iterator to the original position before decrementing.
+     */
+    ConstIterator operator--(int) {
+      ConstIterator tmp = *this;
+      --(*this);
+      return tmp;
+    }
+
+    /**
+     * @brief Advances the iterator by n positions, which may be negative.
+     *
+     * @param n Number of positions to move.
+     * @return Reference to the updated iterator.
+     */
+    ConstIterator& operator+=(difference_type n) {
+      m_ptr += n;
+      return *this;
+    }
+
+    /**
+     * @brief Moves the iterator back by n positions.
+     *
+     * @param n Number of positions to move.
+     * @return Reference to the updated iterator.
+     */
+    ConstIterator& operator-=(difference_type n) {
+      m_ptr -= n;
+      return *this;
+    }
+
+    /**
+     * @brief Accesses the element n positions after the current one.
+     *
+     * @param n Offset from the current position.
+     * @return Reference to the element.
+     */
+    reference operator[](difference_type n) const { return m_ptr[n]; }
+
+    friend ConstIterator operator+(ConstIterator it, difference_type n) { return it += n; }
+    friend ConstIterator operator+(difference_type n, ConstIterator it) { return it += n; }
+    friend ConstIterator operator-(ConstIterator it, difference_type n) { return it -= n; }
+
+    /**
+     * @brief Distance between two iterators.
+     *
+     * @param a End iterator.
+     * @param b Start iterator.
+     * @return Number of positions from b to a.
+     */
+    friend difference_type operator-(const ConstIterator& a, const ConstIterator& b) {
+      return a.m_ptr - b.m_ptr;
+    }
+
     /**
      * @brief Equality comparison operator.
      *
@@ -244,14 +465,132 @@ public:
       return a.m_ptr != b.m_ptr;
     };
 
+    friend bool operator<(const ConstIterator& a, const ConstIterator& b) {
+      return a.m_ptr < b.m_ptr;
+    }
+    friend bool operator>(const ConstIterator& a, const ConstIterator& b) {
+      return a.m_ptr > b.m_ptr;
+    }
+    friend bool operator<=(const ConstIterator& a, const ConstIterator& b) {
+      return a.m_ptr <= b.m_ptr;
+    }
+    friend bool operator>=(const ConstIterator& a, const ConstIterator& b) {
+      return a.m_ptr >= b.m_ptr;
+    }
+
   private:
     pointer m_ptr;
   };
 
+  /// Height of a HeightMap together with its absolute (x, z) position
+  struct Cell {
+    Coordinate2D pos;
+    int16_t height;
+  };
+
+  /**
+   * @brief An iterator over the heights of a const HeightMap and their
+   * positions.
+   *
+   * Visits heights in storage order (x, then z) and steps the position along
+   * with the pointer, so no index is divided back into a position and nothing
+   * is bounds checked.
+   */
+  struct CellIterator {
+    using iterator_category = std::input_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = Cell;
+    using pointer = const Cell*;
+    using reference = Cell;
+
+    /**
+     * @brief Constructs an iterator at the first height of a map.
+     *
+     * @param heights HeightMap to iterate over.
+     */
+    explicit CellIterator(const HeightMap& heights)
+        : m_ptr(heights._raw_heights.get()), m_pos(heights._base_pt),
+          m_z_begin(heights._base_pt.z), m_z_end(heights._base_pt.z + heights._z_len) {}
+
+    /**
+     * @brief Constructs an end iterator.
+     *
+     * @param ptr Pointer one past the last height.
+     */
+    explicit CellIterator(const int16_t* ptr) : m_ptr(ptr) {}
+
+    /**
+     * @brief Gets the current height and its position.
+     *
+     * @return Cell of the current height.
+     */
+    reference operator*() const { return {m_pos, *m_ptr}; }
+
+    /**
+     * @brief Pre-increment operator. Advances to the next height, wrapping z
+     * into x at the edge of the map.
+     *
+     * @return Reference to the updated iterator.
+     */
+    CellIterator& operator++() {
+      m_ptr++;
+      if (++m_pos.z == m_z_end) {
+        m_pos.z = m_z_begin;
+        m_pos.x++;
+      }
+      return *this;
+    }
+
+    /**
+     * @brief Post-increment operator. Advances to the next height.
+     *
+     * @param int Unused dummy parameter to differentiate from prefix
+     * increment.
+     * @return Iterator to the original position before incrementing.
+     */
+    CellIterator operator++(int) {
+      CellIterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    friend bool operator==(const CellIterator& a, const CellIterator& b) {
+      return a.m_ptr == b.m_ptr;
+    }
+
+    friend bool operator!=(const CellIterator& a, const CellIterator& b) {
+      return a.m_ptr != b.m_ptr;
+    }
+
+  private:
+    const int16_t* m_ptr;
+    Coordinate2D m_pos;
+    int32_t m_z_begin = 0;
+    int32_t m_z_end = 0;
+  };
+
+  /// Range of every Cell in a HeightMap, returned by cells()
+  struct CellRange {
+    CellIterator first;
+    CellIterator last;
+
+    CellIterator begin() const { return first; }
+    CellIterator end() const { return last; }
+  };
+
+  /**
+   * Gets a range over every height of the map together with its absolute
+   * (x, z) position, in storage order (x, then z).
+   * @return Range of Cells, usable as `for (auto [pos, height] : heights.cells())`
+   */
+  CellRange cells() const {
+    return {CellIterator(*this), CellIterator(_raw_heights.get() + area())};
+  }
+
   Iterator begin() { return Iterator(&_raw_heights[0]); }
-  Iterator end() { return Iterator(&_raw_heights[_x_len * _z_len]); }
+  Iterator end() { return Iterator(&_raw_heights[area()]); }
   ConstIterator begin() const { return ConstIterator(&_raw_heights[0]); }
-  ConstIterator end() const { return ConstIterator(&_raw_heights[_x_len * _z_len]); }
+  ConstIterator end() const { return ConstIterator(&_raw_heights[area()]); }
 };
 
 } // namespace mcpp
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "coordinate.h"
+#include "heightmap.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+/** @file
+ * @brief HeightMapView class.
+ */
+namespace mcpp {
+/**
+ * Non-owning, read-only view of a rectangle of heights inside a HeightMap or
+ * another view. Holds a pointer to the first height, the extents and the
+ * distance between neighbouring heights along x (heights along z are always
+ * adjacent), so slicing copies nothing. The viewed HeightMap must outlive
+ * the view.
+ */
+class HeightMapView {
+private:
+  const int16_t* _data;
+  Coordinate2D _base_pt;
+  int32_t _x_len;
+  int32_t _z_len;
+  size_t _x_stride;
+
+  HeightMapView(const int16_t* data, const Coordinate2D& base_pt, int32_t x_len, int32_t z_len,
+                size_t x_stride)
+      : _data(data), _base_pt(base_pt), _x_len(x_len), _z_len(z_len), _x_stride(x_stride) {}
+
+  const int16_t* at(int x, int z) const {
+    return _data + (static_cast<size_t>(x) * _x_stride) + z;
+  }
+
+public:
+  /**
+   * Views the whole of a height map.
+   * @param heights: HeightMap to view
+   */
+  HeightMapView(const HeightMap& heights);
+
+  // A view of a temporary height map would dangle as soon as it was made
+  HeightMapView(HeightMap&&) = delete;
+
+  /**
+   * Get the height using an offset from the base point of the view
+   * @param x: x offset from the base point
+   * @param z: z offset from the base point
+   * @return: height at specified offset
+   */
+  int16_t get(int x, int z) const;
+
+  /**
+   * Get the height at a Minecraft coordinate if inside the view
+   * @param loc: Coordinate2D in Minecraft world to access in the view
+   * @return: height at specified coordinate
+   */
+  int16_t get_worldspace(const Coordinate2D& loc) const;
+
+  /**
+   * Fill a coordinate inplace with the highest y coordinate at the `loc`'s x
+   * and z components.
+   * @param loc: Coordinate to fill y value for
+   */
+  void fill_coord(Coordinate& out) const;
+
+  /**
+   * Views the rectangle between loc1 and loc2, which must lie inside this
+   * view.
+   * @param loc1: 1st corner of the rectangle in world coordinates
+   * @param loc2: 2nd corner of the rectangle in world coordinates
+   * @return View of the rectangle
+   */
+  HeightMapView slice(const Coordinate2D& loc1, const Coordinate2D& loc2) const;
+
+  /**
+   * Copies the viewed heights into a HeightMap of their own.
+   * @return HeightMap with the same area and heights
+   */
+  HeightMap to_heightmap() const;
+
+  int32_t x_len() const { return _x_len; }
+  int32_t z_len() const { return _z_len; }
+  Coordinate2D base_pt() const { return _base_pt; }
+
+  /// Distance in heights between neighbours along x
+  size_t x_stride() const { return _x_stride; }
+
+  /**
+   * @brief Forward iterator over the viewed heights in the same order as
+   * HeightMap::ConstIterator (x, then z), jumping between rows.
+   */
+  struct ConstIterator {
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = int16_t;
+    using pointer = const int16_t*;
+    using reference = const int16_t&;
+
+    ConstIterator(const HeightMapView* view, int x) : _view(view), _x(x) { seek(); }
+
+    reference operator*() const { return *_ptr; }
+
+    pointer operator->() const { return _ptr; }
+
+    ConstIterator& operator++() {
+      if (++_ptr == _row_end) {
+        ++_x;
+        seek();
+      }
+      return *this;
+    }
+
+    ConstIterator operator++(int) {
+      ConstIterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    friend bool operator==(const ConstIterator& a, const ConstIterator& b) {
+      return a._ptr == b._ptr;
+    }
+
+    friend bool operator!=(const ConstIterator& a, const ConstIterator& b) {
+      return a._ptr != b._ptr;
+    }
+
+  private:
+    // Past the last row the pointer is null rather than beyond the data
+    void seek() {
+      _ptr = _x < _view->_x_len ? _view->at(_x, 0) : nullptr;
+      _row_end = _ptr != nullptr ? _ptr + _view->_z_len : nullptr;
+    }
+
+    const HeightMapView* _view;
+    int _x;
+    pointer _ptr;
+    pointer _row_end;
+  };
+
+  ConstIterator begin() const { return {this, 0}; }
+  ConstIterator end() const { return {this, _x_len}; }
+};
+} // namespace mcpp
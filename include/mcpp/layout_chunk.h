@@ -0,0 +1,304 @@
+#pragma once
+
+#include "block.h"
+#include "chunk.h"
+#include "coordinate.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+/** @file
+ * @brief LayoutChunk class template and its memory layout policies.
+ */
+namespace mcpp {
+/**
+ * The layout Chunk uses: y-major, then x, then z. Rows along z are
+ * contiguous, neighbours along y are a whole x-z slice apart.
+ */
+struct LinearLayout {
+  LinearLayout(int32_t x_len, int32_t y_len, int32_t z_len)
+      : _x_len(x_len), _y_len(y_len), _z_len(z_len) {}
+
+  /// Number of storage slots, padding included
+  size_t size() const {
+    return static_cast<size_t>(_x_len) * static_cast<size_t>(_y_len) * static_cast<size_t>(_z_len);
+  }
+
+  size_t index(int x, int y, int z) const {
+    return (static_cast<size_t>(y) * static_cast<size_t>(_x_len) * static_cast<size_t>(_z_len)) +
+           (static_cast<size_t>(x) * static_cast<size_t>(_z_len)) + static_cast<size_t>(z);
+  }
+
+private:
+  int32_t _x_len;
+  int32_t _y_len;
+  int32_t _z_len;
+};
+
+/**
+ * Contiguous 8x8x8 bricks laid out like Chunk, each brick itself linear.
+ * Every block within a brick shares a few cache lines with its neighbours,
+ * at the cost of padding each axis to a multiple of 8. The index splits into
+ * one term per axis, which are precomputed so an index is three lookups.
+ */
+struct BrickedLayout {
+  static constexpr int BRICK_LEN = 8;
+  static constexpr size_t BRICK_VOLUME = BRICK_LEN * BRICK_LEN * BRICK_LEN;
+
+  BrickedLayout(int32_t x_len, int32_t y_len, int32_t z_len) {
+    size_t z_stride = BRICK_VOLUME;
+    size_t x_stride = bricks(z_len) * z_stride;
+    size_t y_stride = bricks(x_len) * x_stride;
+    _size = bricks(y_len) * y_stride;
+    fill(_x_table, x_len, x_stride, BRICK_LEN);
+    fill(_y_table, y_len, y_stride, BRICK_LEN * BRICK_LEN);
+    fill(_z_table, z_len, z_stride, 1);
+  }
+
+  size_t size() const { return _size; }
+
+  size_t index(int x, int y, int z) const { return _x_table[x] + _y_table[y] + _z_table[z]; }
+
+private:
+  static size_t bricks(int32_t len) {
+    return (static_cast<size_t>(len) + BRICK_LEN - 1) / BRICK_LEN;
+  }
+
+  /// Offset of every position along an axis, given the distance between
+  /// neighbouring bricks and between neighbouring blocks in a brick
+  static void fill(std::vector<size_t>& table, int32_t len, size_t brick_stride,
+                   size_t block_stride) {
+    table.resize(len);
+    for (size_t i = 0; i < table.size(); i++) {
+      table[i] = ((i / BRICK_LEN) * brick_stride) + ((i % BRICK_LEN) * block_stride);
+    }
+  }
+
+  std::vector<size_t> _x_table;
+  std::vector<size_t> _y_table;
+  std::vector<size_t> _z_table;
+  size_t _size;
+};
+
+/**
+ * Morton (Z-order) layout, interleaving the bits of the x, y and z offsets
+ * so that any aligned power-of-two cube is contiguous. Axes of different
+ * lengths interleave until the shorter ones run out of bits, which bounds
+ * the padding to less than 2x per axis. The spread bits of every offset are
+ * precomputed, so an index is three table lookups.
+ */
+struct MortonLayout {
+  MortonLayout(int32_t x_len, int32_t y_len, int32_t z_len) {
+    int x_bits = bits(x_len);
+    int y_bits = bits(y_len);
+    int z_bits = bits(z_len);
+    _x_table.assign(x_len, 0);
+    _y_table.assign(y_len, 0);
+    _z_table.assign(z_len, 0);
+    // Deal out output bits round robin, z lowest as in the other layouts
+    int out = 0;
+    for (int bit = 0; bit < std::max({x_bits, y_bits, z_bits}); bit++) {
+      if (bit < z_bits) {
+        spread(_z_table, bit, out++);
+      }
+      if (bit < x_bits) {
+        spread(_x_table, bit, out++);
+      }
+      if (bit < y_bits) {
+        spread(_y_table, bit, out++);
+      }
+    }
+    _size = size_t{1} << out;
+  }
+
+  size_t size() const { return _size; }
+
+  size_t index(int x, int y, int z) const { return _x_table[x] | _y_table[y] | _z_table[z]; }
+
+private:
+  static int bits(int32_t len) {
+    int count = 0;
+    while ((int64_t{1} << count) < len) {
+      count++;
+    }
+    return count;
+  }
+
+  static void spread(std::vector<size_t>& table, int bit, int out) {
+    for (size_t i = 0; i < table.size(); i++) {
+      table[i] |= ((i >> bit) & 1) << out;
+    }
+  }
+
+  std::vector<size_t> _x_table;
+  std::vector<size_t> _y_table;
+  std::vector<size_t> _z_table;
+  size_t _size;
+};
+
+/**
+ * Stores a 3D cuboid of BlockTypes like Chunk, but in the memory order given
+ * by the Layout policy: LinearLayout (the order Chunk uses), BrickedLayout
+ * or MortonLayout. Coordinates and iteration order are the same for every
+ * layout, only the cache behaviour of neighbourhood access differs.
+ */
+template <typename Layout> class LayoutChunk {
+private:
+  Coordinate _base_pt;
+  int32_t _x_len;
+  int32_t _y_len;
+  int32_t _z_len;
+  Layout _layout;
+  std::vector<BlockType> _blocks;
+
+  void check(int x, int y, int z) const {
+    if ((x < 0 || y < 0 || z < 0) || (x > _x_len - 1 || y > _y_len - 1 || z > _z_len - 1)) {
+      throw std::out_of_range("Out of bounds LayoutChunk access at " +
+                              to_string(Coordinate(x, y, z)));
+    }
+  }
+
+public:
+  /**
+   * Creates a chunk covering the cuboid between loc1 and loc2 filled with a
+   * single BlockType.
+   * @param loc1: 1st corner of the cuboid
+   * @param loc2: 2nd corner of the cuboid
+   * @param fill: BlockType to fill with
+   */
+  LayoutChunk(const Coordinate& loc1, const Coordinate& loc2, const BlockType& fill = Blocks::AIR)
+      : _base_pt(std::min(loc1.x, loc2.x), std::min(loc1.y, loc2.y), std::min(loc1.z, loc2.z)),
+        _x_len(std::abs(loc1.x - loc2.x) + 1), _y_len(std::abs(loc1.y - loc2.y) + 1),
+        _z_len(std::abs(loc1.z - loc2.z) + 1), _layout(_x_len, _y_len, _z_len),
+        _blocks(_layout.size(), fill) {}
+
+  /**
+   * Copies the blocks of a chunk into this layout.
+   * @param chunk: Chunk to copy
+   */
+  explicit LayoutChunk(const Chunk& chunk)
+      : _base_pt(chunk.base_pt()), _x_len(chunk.x_len()), _y_len(chunk.y_len()),
+        _z_len(chunk.z_len()), _layout(_x_len, _y_len, _z_len), _blocks(_layout.size()) {
+    auto in = chunk.begin();
+    for (int y = 0; y < _y_len; y++) {
+      for (int x = 0; x < _x_len; x++) {
+        for (int z = 0; z < _z_len; z++, ++in) {
+          _blocks[_layout.index(x, y, z)] = *in;
+        }
+      }
+    }
+  }
+
+  /**
+   * Local equivalent of get_worldspace, equivalent to a 3D array access.
+   * @param x: x element of array access
+   * @param y: y element of array access
+   * @param z: z element of array access
+   * @return BlockType at specified location
+   */
+  BlockType get(int x, int y, int z) const {
+    check(x, y, z);
+    return _blocks[_layout.index(x, y, z)];
+  }
+
+  /**
+   * Accesses the Minecraft block at absolute position pos and returns its
+   * BlockType if it is in the included area.
+   * @param pos: Absolute position in the Minecraft world to query BlockType
+   * for
+   * @return BlockType at specified location
+   */
+  BlockType get_worldspace(const Coordinate& pos) const {
+    return get(pos.x - _base_pt.x, pos.y - _base_pt.y, pos.z - _base_pt.z);
+  }
+
+  /**
+   * Replaces the block at an offset from the base point.
+   * @param x: x element of array access
+   * @param y: y element of array access
+   * @param z: z element of array access
+   * @param block: BlockType to store
+   */
+  void set(int x, int y, int z, const BlockType& block) {
+    check(x, y, z);
+    _blocks[_layout.index(x, y, z)] = block;
+  }
+
+  /**
+   * Replaces the block at an absolute position in the Minecraft world.
+   * @param pos: Absolute position in the Minecraft world
+   * @param block: BlockType to store
+   */
+  void set_worldspace(const Coordinate& pos, const BlockType& block) {
+    set(pos.x - _base_pt.x, pos.y - _base_pt.y, pos.z - _base_pt.z, block);
+  }
+
+  /**
+   * Copies the blocks back into a Chunk in its linear order.
+   * @return Chunk with the same area and blocks
+   */
+  Chunk to_chunk() const {
+    std::vector<BlockType> blocks(begin(), end());
+    return Chunk{_base_pt, _base_pt + Coordinate(_x_len - 1, _y_len - 1, _z_len - 1), blocks};
+  }
+
+  int32_t x_len() const { return _x_len; }
+  int32_t y_len() const { return _y_len; }
+  int32_t z_len() const { return _z_len; }
+  Coordinate base_pt() const { return _base_pt; }
+
+  /**
+   * @brief Forward iterator over the blocks in the same order as
+   * Chunk::ConstIterator (y, then x, then z), whatever the layout.
+   */
+  struct ConstIterator {
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = BlockType;
+    using pointer = const BlockType*;
+    using reference = const BlockType&;
+
+    ConstIterator(const LayoutChunk* chunk, int x, int y, int z)
+        : _chunk(chunk), _x(x), _y(y), _z(z) {}
+
+    reference operator*() const { return _chunk->_blocks[_chunk->_layout.index(_x, _y, _z)]; }
+
+    pointer operator->() const { return &**this; }
+
+    ConstIterator& operator++() {
+      if (++_z == _chunk->_z_len) {
+        _z = 0;
+        if (++_x == _chunk->_x_len) {
+          _x = 0;
+          ++_y;
+        }
+      }
+      return *this;
+    }
+
+    ConstIterator operator++(int) {
+      ConstIterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    friend bool operator==(const ConstIterator& a, const ConstIterator& b) {
+      return a._x == b._x && a._y == b._y && a._z == b._z;
+    }
+
+    friend bool operator!=(const ConstIterator& a, const ConstIterator& b) { return !(a == b); }
+
+  private:
+    const LayoutChunk* _chunk;
+    int _x;
+    int _y;
+    int _z;
+  };
+
+  ConstIterator begin() const { return {this, 0, 0, 0}; }
+  ConstIterator end() const { return {this, 0, _y_len, 0}; }
+};
+} // namespace mcpp
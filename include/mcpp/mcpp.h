@@ -2,9 +2,21 @@
 
 #include "block.h"
 #include "chunk.h"
+#include "chunk_view.h"
 #include "coordinate.h"
 #include "heightmap.h"
+#include "heightmap_view.h"
+#include "layout_chunk.h"
+#include "octree.h"
+#include "paletted_chunk.h"
+#include "parallel.h"
+#include "static_chunk.h"
+#include "storage_chunk.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "voxel_world.h"
 
+#include <chrono>
 #include <memory>
 
 /** @file
@@ -22,13 +34,50 @@
 namespace mcpp {
 // Forward declare to avoid polluting namespace
 class SocketConnection;
+class WorldCache;
+class ShadowState;
 
 const uint16_t MCPP_PORT = 4711;
 
+/**
+ * @brief Settings for the client-side block cache, see
+ * MinecraftConnection::enableCache().
+ */
+struct CacheOptions {
+  /// Memory budget for cached blocks, least recently used sections are
+  /// evicted first once it is reached
+  size_t max_bytes = 64 * 1024 * 1024;
+  /// How long a fetched section is trusted before it is fetched again, zero
+  /// keeps sections until they are evicted
+  std::chrono::milliseconds ttl = std::chrono::seconds(10);
+};
+
+/**
+ * @brief Counters of the client-side block cache, hits and misses are counted
+ * per 16x16x16 section.
+ */
+struct CacheStats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  /// Sections currently held
+  size_t sections;
+};
+
 class MinecraftConnection {
 private:
   /// Handle to the socket connection.
   std::unique_ptr<SocketConnection> _conn;
+  /// Optional cache of fetched blocks, null unless enabled.
+  std::unique_ptr<WorldCache> _cache;
+  /// Optional last known world state used to drop redundant writes.
+  std::unique_ptr<ShadowState> _shadow;
+  uint64_t _elided_writes = 0;
+
+  /// Fills out, which holds exactly as many blocks as the cuboid, in the order
+  /// Chunk stores them
+  void load_blocks_into(const Coordinate& loc1, const Coordinate& loc2, BlockType* out,
+                        size_t n) const;
 
 public:
   /**
@@ -133,6 +182,36 @@ public:
    */
   [[nodiscard]] Chunk getBlocks(const Coordinate& loc1, const Coordinate& loc2) const;
 
+  /**
+   * @brief Same as getBlocks, but fills an existing Chunk. Its storage is
+   * reused when the cuboid holds as many blocks as it did before, so polling
+   * the same area repeatedly does not allocate for the result.
+   *
+   * @param loc1 1st corner of the cuboid
+   * @param loc2 2nd corner of the cuboid
+   * @param out Chunk to fill, any uncommitted changes in it are dropped
+   */
+  void getBlocksInto(const Coordinate& loc1, const Coordinate& loc2, Chunk& out) const;
+
+  /**
+   * @brief Returns the blocks of a cuboid whose size is known at compile
+   * time, parsed straight into a StaticChunk without allocating storage for
+   * them.
+   *
+   * @tparam X x length of the cuboid
+   * @tparam Y y length of the cuboid
+   * @tparam Z z length of the cuboid
+   * @param origin Minimum corner of the cuboid
+   * @return StaticChunk containing the blocks in the specified area.
+   */
+  template <int32_t X, int32_t Y, int32_t Z>
+  [[nodiscard]] StaticChunk<X, Y, Z> getBlocks(const Coordinate& origin) const {
+    StaticChunk<X, Y, Z> chunk(origin);
+    load_blocks_into(origin, Coordinate(origin.x + X - 1, origin.y + Y - 1, origin.z + Z - 1),
+                     chunk.data(), chunk.size());
+    return chunk;
+  }
+
   /**
    * @brief Returns the height of the specific provided 2D coordinate
    *
@@ -174,6 +253,77 @@ public:
    */
   [[nodiscard]] HeightMap getHeights(const Coordinate2D& loc1, const Coordinate2D& loc2) const;
 
+  /**
+   * @brief Same as getHeights, but fills an existing HeightMap. Its storage
+   * is reused when the rectangle holds as many heights as it did before.
+   *
+   * @param loc1 1st corner of rectangle
+   * @param loc2 2nd corner of rectangle
+   * @param out HeightMap to fill
+   */
+  void getHeightsInto(const Coordinate2D& loc1, const Coordinate2D& loc2, HeightMap& out) const;
+
+  /**
+   * @brief Enables a client-side cache for getBlock and getBlocks.
+   *
+   * Fetched blocks are kept in 16x16x16 sections. Requests whose sections
+   * are all cached are answered without a round trip, otherwise only the
+   * bounding box of the missing sections is fetched. setBlock and setBlocks
+   * from this connection update the cached blocks. Changes made by anything
+   * else (other clients, players, doCommand) are only seen once the sections
+   * expire, or after clearCache().
+   *
+   * @param options Memory budget and section time to live
+   */
+  void enableCache(const CacheOptions& options = CacheOptions());
+
+  /**
+   * @brief Disables the block cache and frees its memory.
+   */
+  void disableCache();
+
+  /**
+   * @brief Drops every cached section, e.g. after the world was changed by
+   * someone else.
+   */
+  void clearCache();
+
+  /**
+   * @brief Returns the block cache counters, all zero if it is not enabled.
+   */
+  [[nodiscard]] CacheStats cacheStats() const;
+
+  /**
+   * @brief Enables write elision against the last known state of the world.
+   *
+   * The connection remembers every block it reads or writes and every column
+   * height it reads. setBlock and setBlocks calls that would not change any
+   * remembered block are dropped without being sent, so callers no longer
+   * have to diff frames themselves. Heights of remembered columns are kept
+   * current across writes, so getHeight and getHeights on them are answered
+   * locally.
+   *
+   * This assumes the connection is the only writer to the areas it touches.
+   * Call clearShadowState() after the world was changed by anything else.
+   */
+  void enableShadowState();
+
+  /**
+   * @brief Disables write elision and frees the remembered state.
+   */
+  void disableShadowState();
+
+  /**
+   * @brief Forgets every remembered block and height.
+   */
+  void clearShadowState();
+
+  /**
+   * @brief Returns how many setBlock and setBlocks calls were dropped by
+   * write elision.
+   */
+  [[nodiscard]] uint64_t elidedWrites() const;
+
   // NOLINTEND(readability-identifier-naming)
 };
 } // namespace mcpp
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "block.h"
+#include "chunk.h"
+#include "coordinate.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/** @file
+ * @brief Octree class.
+ */
+namespace mcpp {
+/**
+ * Sparse voxel octree over the area of a Chunk, for regions that are mostly
+ * air. Any node whose blocks all share one BlockType is collapsed into a
+ * single leaf, so lookups walk at most log2 of the longest side and
+ * iteration skips air nodes entirely, taking time proportional to the
+ * non-air content rather than the volume.
+ */
+class Octree {
+private:
+  struct Node {
+    BlockType value;
+    /// Index of the first of eight consecutive children, 0 for a leaf
+    uint32_t children;
+  };
+
+  Coordinate _base_pt;
+  int32_t _x_len;
+  int32_t _y_len;
+  int32_t _z_len;
+  /// Side of the root cube, the longest side rounded up to a power of two
+  int _size;
+  std::vector<Node> _nodes;
+
+  Node build(const Chunk& chunk, const Coordinate& origin, int size);
+
+  static Coordinate child_origin(const Coordinate& origin, int half, int i) {
+    return {origin.x + ((i >> 1) & 1) * half, origin.y + ((i >> 2) & 1) * half,
+            origin.z + (i & 1) * half};
+  }
+
+  template <typename Fn>
+  void visit(uint32_t index, const Coordinate& origin, int size, const Coordinate& min,
+             const Coordinate& max, Fn& fn) const {
+    if (origin.x > max.x || origin.y > max.y || origin.z > max.z || origin.x + size <= min.x ||
+        origin.y + size <= min.y || origin.z + size <= min.z) {
+      return;
+    }
+    const Node& node = _nodes[index];
+    if (node.children == 0) {
+      if (node.value != Blocks::AIR) {
+        fn(origin, size, node.value);
+      }
+      return;
+    }
+    int half = size / 2;
+    for (int i = 0; i < 8; i++) {
+      visit(node.children + i, child_origin(origin, half, i), half, min, max, fn);
+    }
+  }
+
+public:
+  /**
+   * Builds the octree of a chunk.
+   * @param chunk: Chunk to build from
+   */
+  explicit Octree(const Chunk& chunk);
+
+  /**
+   * Local equivalent of get_worldspace, equivalent to a 3D array access.
+   * @param x: x element of array access
+   * @param y: y element of array access
+   * @param z: z element of array access
+   * @return BlockType at specified location
+   */
+  BlockType get(int x, int y, int z) const;
+
+  /**
+   * Accesses the Minecraft block at absolute position pos and returns its
+   * BlockType if it is in the included area.
+   * @param pos: Absolute position in the Minecraft world to query BlockType
+   * for
+   * @return BlockType at specified location
+   */
+  BlockType get_worldspace(const Coordinate& pos) const;
+
+  /**
+   * Calls fn(origin, size, block) for every non-air leaf, a cube of side size
+   * in which every block is block, with origin its minimum world coordinate.
+   * @param fn: Callback taking (const Coordinate&, int, BlockType)
+   */
+  template <typename Fn> void for_each_leaf(Fn fn) const {
+    Coordinate max = _base_pt + Coordinate(_size - 1, _size - 1, _size - 1);
+    visit(0, _base_pt, _size, _base_pt, max, fn);
+  }
+
+  /**
+   * Calls fn(pos, block) for every non-air block in the cuboid between loc1
+   * and loc2 in world coordinates, skipping air nodes without visiting them.
+   * @param loc1: 1st corner of the cuboid
+   * @param loc2: 2nd corner of the cuboid
+   * @param fn: Callback taking (const Coordinate&, BlockType)
+   */
+  template <typename Fn>
+  void for_each_block(const Coordinate& loc1, const Coordinate& loc2, Fn fn) const {
+    Coordinate min{std::min(loc1.x, loc2.x), std::min(loc1.y, loc2.y), std::min(loc1.z, loc2.z)};
+    Coordinate max{std::max(loc1.x, loc2.x), std::max(loc1.y, loc2.y), std::max(loc1.z, loc2.z)};
+    auto leaf = [&](const Coordinate& origin, int size, BlockType block) {
+      Coordinate pos;
+      for (pos.y = std::max(min.y, origin.y); pos.y <= std::min(max.y, origin.y + size - 1);
+           pos.y++) {
+        for (pos.x = std::max(min.x, origin.x); pos.x <= std::min(max.x, origin.x + size - 1);
+             pos.x++) {
+          for (pos.z = std::max(min.z, origin.z); pos.z <= std::min(max.z, origin.z + size - 1);
+               pos.z++) {
+            fn(static_cast<const Coordinate&>(pos), block);
+          }
+        }
+      }
+    };
+    visit(0, _base_pt, _size, min, max, leaf);
+  }
+
+  /**
+   * Reconstructs the dense Chunk the octree was built from.
+   * @return Chunk with the same area and blocks
+   */
+  Chunk to_chunk() const;
+
+  /**
+   * Number of nodes in the tree, leaves included.
+   * @return node count
+   */
+  size_t node_count() const { return _nodes.size(); }
+
+  int32_t x_len() const { return _x_len; }
+  int32_t y_len() const { return _y_len; }
+  int32_t z_len() const { return _z_len; }
+  Coordinate base_pt() const { return _base_pt; }
+};
+} // namespace mcpp
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "block.h"
+#include "chunk.h"
+#include "coordinate.h"
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+/** @file
+ * @brief PalettedChunk class.
+ */
+namespace mcpp {
+/**
+ * Compressed alternative to Chunk for keeping large snapshots in memory. The
+ * cuboid is split into 16x16x16 sections relative to its base point, each
+ * with its own palette of the BlockTypes it contains and a bit-packed index
+ * per block, in the style of Minecraft's own chunk format. Sections with a
+ * single BlockType store no indices, sections with up to 256 store 4 to 8
+ * bits per block, and anything more falls back to 16 bits per block.
+ */
+class PalettedChunk {
+public:
+  static constexpr int SECTION_LEN = 16;
+
+private:
+  struct Section {
+    /// Bits per packed index: 0 for a single BlockType, 4 to 8 with a
+    /// palette, 16 for BlockTypes stored directly as (id << 8) | mod
+    uint8_t bits;
+    /// Indices per 64-bit word and ceil(2^32 / per_word), exact division of
+    /// indices below 4096 as a multiply and shift
+    uint8_t per_word;
+    uint32_t div_magic;
+    uint8_t x_len;
+    uint8_t y_len;
+    uint8_t z_len;
+    std::vector<BlockType> palette;
+    /// Indices packed low bits first, never straddling two words
+    std::vector<uint64_t> data;
+  };
+
+  Coordinate _base_pt;
+  int32_t _x_len;
+  int32_t _y_len;
+  int32_t _z_len;
+  int _sections_x;
+  int _sections_z;
+  std::vector<Section> _sections;
+
+  BlockType get_unchecked(int x, int y, int z) const;
+
+public:
+  /**
+   * Compresses the blocks of a chunk.
+   * @param chunk: Chunk to compress
+   */
+  explicit PalettedChunk(const Chunk& chunk);
+
+  /**
+   * Local equivalent of get_worldspace, equivalent to a 3D array access.
+   * @param x: x element of array access
+   * @param y: y element of array access
+   * @param z: z element of array access
+   * @return BlockType at specified location
+   */
+  BlockType get(int x, int y, int z) const;
+
+  /**
+   * Accesses the Minecraft block at absolute position pos and returns its
+   * BlockType if it is in the included area.
+   * @param pos: Absolute position in the Minecraft world to query BlockType
+   * for
+   * @return BlockType at specified location
+   */
+  BlockType get_worldspace(const Coordinate& pos) const;
+
+  /**
+   * Decompresses into a dense Chunk covering the same area.
+   * @return Chunk with the same blocks
+   */
+  Chunk to_chunk() const;
+
+  /**
+   * Approximate heap memory used by the palettes and packed indices.
+   * @return size in bytes
+   */
+  size_t memory_usage() const;
+
+  int32_t x_len() const { return _x_len; }
+  int32_t y_len() const { return _y_len; }
+  int32_t z_len() const { return _z_len; }
+  Coordinate base_pt() const { return _base_pt; }
+
+  /**
+   * @brief Forward iterator decoding blocks in the same order as
+   * Chunk::ConstIterator (y, then x, then z). Steps through the packed
+   * indices of a section row incrementally instead of locating every block.
+   */
+  struct ConstIterator {
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = BlockType;
+    using pointer = const BlockType*;
+    using reference = BlockType;
+
+    ConstIterator(const PalettedChunk* chunk, int x, int y, int z)
+        : _chunk(chunk), _x(x), _y(y), _z(z) {
+      if (_y < _chunk->_y_len) {
+        locate();
+      }
+    }
+
+    reference operator*() const {
+      if (_section->bits == 0) {
+        return _section->palette[0];
+      }
+      auto value = static_cast<uint16_t>((_section->data[_word] >> (_slot * _section->bits)) &
+                                         ((uint64_t{1} << _section->bits) - 1));
+      if (_section->bits == 16) {
+        return {static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value & 0xff)};
+      }
+      return _section->palette[value];
+    }
+
+    ConstIterator& operator++() {
+      if (++_z % SECTION_LEN != 0 && _z != _chunk->_z_len) {
+        if (++_slot == _section->per_word) {
+          _slot = 0;
+          _word++;
+        }
+        return *this;
+      }
+      // Crossed into another section
+      if (_z == _chunk->_z_len) {
+        _z = 0;
+        if (++_x == _chunk->_x_len) {
+          _x = 0;
+          ++_y;
+        }
+      }
+      if (_y < _chunk->_y_len) {
+        locate();
+      }
+      return *this;
+    }
+
+    ConstIterator operator++(int) {
+      ConstIterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    friend bool operator==(const ConstIterator& a, const ConstIterator& b) {
+      return a._x == b._x && a._y == b._y && a._z == b._z;
+    }
+
+    friend bool operator!=(const ConstIterator& a, const ConstIterator& b) { return !(a == b); }
+
+  private:
+    void locate();
+
+    const PalettedChunk* _chunk;
+    int _x;
+    int _y;
+    int _z;
+    const Section* _section = nullptr;
+    size_t _word = 0;
+    size_t _slot = 0;
+  };
+
+  ConstIterator begin() const { return {this, 0, 0, 0}; }
+  ConstIterator end() const { return {this, 0, _y_len, 0}; }
+};
+} // namespace mcpp
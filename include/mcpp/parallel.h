@@ -0,0 +1,164 @@
+#pragma once
+
+#include "chunk.h"
+#include "chunk_view.h"
+#include "heightmap.h"
+#include "heightmap_view.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/** @file
+ * @brief Parallel algorithms over Chunk and HeightMap data.
+ *
+ * The iterator algorithms split [first, last) into contiguous parts, a few
+ * per pool thread so uneven work still balances, and need random-access
+ * iterators such as those of Chunk and HeightMap. The region algorithms hand
+ * each task a view of one Y layer of a Chunk or one tile of a HeightMap.
+ */
+namespace mcpp {
+
+namespace detail {
+/// Number of parts to split n elements into for a pool
+inline size_t parallel_parts(const ThreadPool& pool, size_t n) {
+  return std::min(n, pool.size() == 1 ? size_t{1} : pool.size() * 4);
+}
+} // namespace detail
+
+/**
+ * Calls fn(element) for every element of [first, last) in parallel.
+ * @param first: Start of the range
+ * @param last: End of the range
+ * @param fn: Function called concurrently from several threads
+ * @param pool: Pool to run on
+ */
+template <typename It, typename Fn>
+void parallel_for_each(It first, It last, Fn fn, ThreadPool& pool = ThreadPool::shared()) {
+  auto n = static_cast<size_t>(std::distance(first, last));
+  size_t parts = detail::parallel_parts(pool, n);
+  pool.run(parts, [&](size_t part) {
+    It it = first + static_cast<std::ptrdiff_t>(n * part / parts);
+    It end = first + static_cast<std::ptrdiff_t>(n * (part + 1) / parts);
+    for (; it != end; ++it) {
+      fn(*it);
+    }
+  });
+}
+
+/**
+ * Writes fn(element) for every element of [first, last) to the range
+ * starting at out, in parallel.
+ * @param first: Start of the input range
+ * @param last: End of the input range
+ * @param out: Start of the output range, which must be random access
+ * @param fn: Function called concurrently from several threads
+ * @param pool: Pool to run on
+ * @return End of the output range
+ */
+template <typename It, typename Out, typename Fn>
+Out parallel_transform(It first, It last, Out out, Fn fn, ThreadPool& pool = ThreadPool::shared()) {
+  auto n = static_cast<size_t>(std::distance(first, last));
+  size_t parts = detail::parallel_parts(pool, n);
+  pool.run(parts, [&](size_t part) {
+    auto begin = static_cast<std::ptrdiff_t>(n * part / parts);
+    auto end = static_cast<std::ptrdiff_t>(n * (part + 1) / parts);
+    std::transform(first + begin, first + end, out + begin, fn);
+  });
+  return out + static_cast<std::ptrdiff_t>(n);
+}
+
+/**
+ * Combines map(element) for every element of [first, last) with reduce, in
+ * parallel. Each part is folded from init, so init must be an identity of
+ * reduce, and reduce must be associative.
+ * @param first: Start of the range
+ * @param last: End of the range
+ * @param init: Identity value of reduce
+ * @param reduce: Function combining two T values
+ * @param map: Function turning an element into a T
+ * @param pool: Pool to run on
+ * @return Combined value
+ */
+template <typename It, typename T, typename Reduce, typename Map>
+T parallel_reduce(It first, It last, T init, Reduce reduce, Map map,
+                  ThreadPool& pool = ThreadPool::shared()) {
+  auto n = static_cast<size_t>(std::distance(first, last));
+  size_t parts = detail::parallel_parts(pool, n);
+  std::vector<T> partials(parts, init);
+  pool.run(parts, [&](size_t part) {
+    It it = first + static_cast<std::ptrdiff_t>(n * part / parts);
+    It end = first + static_cast<std::ptrdiff_t>(n * (part + 1) / parts);
+    T acc = init;
+    for (; it != end; ++it) {
+      acc = reduce(acc, map(*it));
+    }
+    partials[part] = acc;
+  });
+  T result = init;
+  for (const T& partial : partials) {
+    result = reduce(result, partial);
+  }
+  return result;
+}
+
+/**
+ * Combines the elements of [first, last) with reduce, in parallel.
+ * @param first: Start of the range
+ * @param last: End of the range
+ * @param init: Identity value of reduce
+ * @param reduce: Associative function combining two values
+ * @param pool: Pool to run on
+ * @return Combined value
+ */
+template <typename It, typename T, typename Reduce>
+T parallel_reduce(It first, It last, T init, Reduce reduce,
+                  ThreadPool& pool = ThreadPool::shared()) {
+  return parallel_reduce(
+      first, last, init, reduce, [](const auto& value) { return value; }, pool);
+}
+
+/**
+ * Calls fn(layer) with a view of every Y layer of a chunk, in parallel.
+ * @param chunk: Chunk to split
+ * @param fn: Function taking a ChunkView, called concurrently
+ * @param pool: Pool to run on
+ */
+template <typename Fn>
+void parallel_for_layers(const Chunk& chunk, Fn fn, ThreadPool& pool = ThreadPool::shared()) {
+  ChunkView view(chunk);
+  pool.run(static_cast<size_t>(chunk.y_len()),
+           [&](size_t y) { fn(view.layer(static_cast<int>(y))); });
+}
+
+/**
+ * Calls fn(tile) with a view of every tile_len x tile_len tile of a height
+ * map, in parallel. Tiles on the far edges may be smaller.
+ * @param heights: HeightMap to split
+ * @param tile_len: Side of a tile, which must be positive
+ * @param fn: Function taking a HeightMapView, called concurrently
+ * @param pool: Pool to run on
+ */
+template <typename Fn>
+void parallel_for_tiles(const HeightMap& heights, int tile_len, Fn fn,
+                        ThreadPool& pool = ThreadPool::shared()) {
+  if (tile_len <= 0) {
+    throw std::invalid_argument("Tile length must be positive, got " + std::to_string(tile_len));
+  }
+  HeightMapView view(heights);
+  Coordinate2D base = heights.base_pt();
+  size_t tiles_x = (static_cast<size_t>(heights.x_len()) + tile_len - 1) / tile_len;
+  size_t tiles_z = (static_cast<size_t>(heights.z_len()) + tile_len - 1) / tile_len;
+  pool.run(tiles_x * tiles_z, [&](size_t tile) {
+    int x = static_cast<int>(tile / tiles_z) * tile_len;
+    int z = static_cast<int>(tile % tiles_z) * tile_len;
+    Coordinate2D loc1(base.x + x, base.z + z);
+    Coordinate2D loc2(base.x + std::min(x + tile_len, heights.x_len()) - 1,
+                      base.z + std::min(z + tile_len, heights.z_len()) - 1);
+    fn(view.slice(loc1, loc2));
+  });
+}
+} // namespace mcpp
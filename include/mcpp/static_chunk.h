@@ -0,0 +1,171 @@
+#pragma once
+
+#include "block.h"
+#include "chunk.h"
+#include "chunk_view.h"
+#include "coordinate.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+/** @file
+ * @brief StaticChunk class template.
+ */
+namespace mcpp {
+/**
+ * Stores a cuboid of BlockTypes whose extents are fixed at compile time, in
+ * the same order as Chunk (y, then x, then z). The blocks live inside the
+ * object rather than on the heap and every index is computed from constant
+ * extents, so small regions that are fetched over and over need no
+ * allocation and loops over them can be fully unrolled.
+ *
+ * @tparam X: x length
+ * @tparam Y: y length
+ * @tparam Z: z length
+ */
+template <int32_t X, int32_t Y, int32_t Z> class StaticChunk {
+  static_assert(X > 0 && Y > 0 && Z > 0, "StaticChunk extents must be positive");
+
+private:
+  Coordinate _base_pt;
+  std::array<BlockType, static_cast<size_t>(X) * Y * Z> _blocks{};
+
+  static constexpr size_t index(int x, int y, int z) {
+    return (static_cast<size_t>(y) * X * Z) + (static_cast<size_t>(x) * Z) +
+           static_cast<size_t>(z);
+  }
+
+  static void check(int x, int y, int z) {
+    if ((x < 0 || y < 0 || z < 0) || (x > X - 1 || y > Y - 1 || z > Z - 1)) {
+      throw std::out_of_range("Out of bounds StaticChunk access at " +
+                              to_string(Coordinate(x, y, z)));
+    }
+  }
+
+public:
+  /**
+   * Creates a chunk at a base point filled with a single BlockType.
+   * @param base_pt: Minimum corner of the cuboid
+   * @param fill: BlockType to fill with
+   */
+  explicit StaticChunk(const Coordinate& base_pt = Coordinate(),
+                       const BlockType& fill = Blocks::AIR)
+      : _base_pt(base_pt) {
+    _blocks.fill(fill);
+  }
+
+  /**
+   * Local equivalent of get_worldspace, equivalent to a 3D array access.
+   * @param x: x element of array access
+   * @param y: y element of array access
+   * @param z: z element of array access
+   * @return BlockType at specified location
+   */
+  BlockType get(int x, int y, int z) const {
+    check(x, y, z);
+    return _blocks[index(x, y, z)];
+  }
+
+  /**
+   * Accesses the Minecraft block at absolute position pos and returns its
+   * BlockType if it is in the included area.
+   * @param pos: Absolute position in the Minecraft world to query BlockType
+   * for
+   * @return BlockType at specified location
+   */
+  BlockType get_worldspace(const Coordinate& pos) const {
+    return get(pos.x - _base_pt.x, pos.y - _base_pt.y, pos.z - _base_pt.z);
+  }
+
+  /**
+   * Replaces the block at an offset from the base point.
+   * @param x: x element of array access
+   * @param y: y element of array access
+   * @param z: z element of array access
+   * @param block: BlockType to store
+   */
+  void set(int x, int y, int z, const BlockType& block) {
+    check(x, y, z);
+    _blocks[index(x, y, z)] = block;
+  }
+
+  /**
+   * Replaces the block at an absolute position in the Minecraft world.
+   * @param pos: Absolute position in the Minecraft world
+   * @param block: BlockType to store
+   */
+  void set_worldspace(const Coordinate& pos, const BlockType& block) {
+    set(pos.x - _base_pt.x, pos.y - _base_pt.y, pos.z - _base_pt.z, block);
+  }
+
+  /**
+   * Unchecked equivalent of get and set, an offset outside the chunk is
+   * undefined behaviour.
+   * @param x: x offset from the base point, in [0, X)
+   * @param y: y offset from the base point, in [0, Y)
+   * @param z: z offset from the base point, in [0, Z)
+   * @return Block at specified offset
+   */
+  const BlockType& operator()(int x, int y, int z) const { return _blocks[index(x, y, z)]; }
+  BlockType& operator()(int x, int y, int z) { return _blocks[index(x, y, z)]; }
+
+  /**
+   * Unchecked equivalent of get_worldspace.
+   * @param pos: Absolute position in the Minecraft world, inside the chunk
+   * @return BlockType at specified location
+   */
+  const BlockType& at_unchecked(const Coordinate& pos) const {
+    return _blocks[index(pos.x - _base_pt.x, pos.y - _base_pt.y, pos.z - _base_pt.z)];
+  }
+
+  /**
+   * Moves the chunk to a new base point without changing its blocks.
+   * @param base_pt: New minimum corner of the cuboid
+   */
+  void set_base_pt(const Coordinate& base_pt) { _base_pt = base_pt; }
+
+  /**
+   * Views the blocks, for use with anything that takes a ChunkView.
+   * @return View of the whole chunk, valid while the chunk is
+   */
+  ChunkView view() const { return ChunkView(_blocks.data(), _base_pt, X, Y, Z); }
+
+  /**
+   * Copies the blocks into a Chunk.
+   * @return Chunk with the same area and blocks
+   */
+  Chunk to_chunk() const {
+    auto blocks = std::make_unique<BlockType[]>(size());
+    std::copy(_blocks.begin(), _blocks.end(), blocks.get());
+    return Chunk{_base_pt, Coordinate(_base_pt.x + X - 1, _base_pt.y + Y - 1, _base_pt.z + Z - 1),
+                 std::move(blocks)};
+  }
+
+  static constexpr int32_t x_len() { return X; }
+  static constexpr int32_t y_len() { return Y; }
+  static constexpr int32_t z_len() { return Z; }
+  Coordinate base_pt() const { return _base_pt; }
+
+  /// Number of blocks, X * Y * Z
+  static constexpr size_t size() { return static_cast<size_t>(X) * Y * Z; }
+
+  /// Distance in blocks between neighbours along x in data()
+  static constexpr size_t x_stride() { return Z; }
+
+  /// Distance in blocks between neighbours along y in data()
+  static constexpr size_t y_stride() { return static_cast<size_t>(X) * Z; }
+
+  BlockType* data() { return _blocks.data(); }
+  const BlockType* data() const { return _blocks.data(); }
+
+  // Iterators, in the same order as Chunk's
+  BlockType* begin() { return _blocks.data(); }
+  BlockType* end() { return _blocks.data() + size(); }
+  const BlockType* begin() const { return _blocks.data(); }
+  const BlockType* end() const { return _blocks.data() + size(); }
+};
+} // namespace mcpp
@@ -0,0 +1,283 @@
+#pragma once
+
+#include "block.h"
+#include "chunk.h"
+#include "coordinate.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+/** @file
+ * @brief StorageChunk class template and its block storage policies.
+ */
+namespace mcpp {
+/**
+ * One BlockType per block, ids and mods interleaved. The storage Chunk uses.
+ */
+struct AosStorage {
+  AosStorage(size_t size, const BlockType& fill) : _blocks(size, fill) {}
+
+  BlockType get(size_t i) const { return _blocks[i]; }
+  void set(size_t i, const BlockType& block) { _blocks[i] = block; }
+
+  /// Number of blocks matching block, comparing ids only unless match_mod
+  size_t count(const BlockType& block, bool match_mod) const;
+  /// Index of the first block matching block, or size() if there is none
+  size_t find(const BlockType& block, bool match_mod) const;
+
+  size_t size() const { return _blocks.size(); }
+  /// Bytes of block storage
+  size_t bytes() const { return _blocks.size() * sizeof(BlockType); }
+  const BlockType* blocks() const { return _blocks.data(); }
+
+private:
+  std::vector<BlockType> _blocks;
+};
+
+/**
+ * Ids and mods in two separate arrays, so work that only looks at ids runs
+ * over contiguous bytes, twice as many per vector as with AosStorage.
+ */
+struct SoaStorage {
+  SoaStorage(size_t size, const BlockType& fill) : _ids(size, fill.id), _mods(size, fill.mod) {}
+
+  BlockType get(size_t i) const { return {_ids[i], _mods[i]}; }
+  void set(size_t i, const BlockType& block) {
+    _ids[i] = block.id;
+    _mods[i] = block.mod;
+  }
+
+  /// Number of blocks matching block, comparing ids only unless match_mod
+  size_t count(const BlockType& block, bool match_mod) const;
+  /// Index of the first block matching block, or size() if there is none
+  size_t find(const BlockType& block, bool match_mod) const;
+
+  size_t size() const { return _ids.size(); }
+  /// Bytes of block storage
+  size_t bytes() const { return _ids.size() + _mods.size(); }
+  const uint8_t* ids() const { return _ids.data(); }
+  const uint8_t* mods() const { return _mods.data(); }
+
+private:
+  std::vector<uint8_t> _ids;
+  std::vector<uint8_t> _mods;
+};
+
+/**
+ * Ids only, half the memory of AosStorage. Mods are dropped when blocks are
+ * stored and read back as 0.
+ */
+struct IdOnlyStorage {
+  IdOnlyStorage(size_t size, const BlockType& fill) : _ids(size, fill.id) {}
+
+  BlockType get(size_t i) const { return BlockType(_ids[i]); }
+  void set(size_t i, const BlockType& block) { _ids[i] = block.id; }
+
+  /// Number of blocks matching block, comparing ids only unless match_mod
+  size_t count(const BlockType& block, bool match_mod) const;
+  /// Index of the first block matching block, or size() if there is none
+  size_t find(const BlockType& block, bool match_mod) const;
+
+  size_t size() const { return _ids.size(); }
+  /// Bytes of block storage
+  size_t bytes() const { return _ids.size(); }
+  const uint8_t* ids() const { return _ids.data(); }
+
+private:
+  std::vector<uint8_t> _ids;
+};
+
+/**
+ * Stores a 3D cuboid of BlockTypes like Chunk, in the same order (y, then x,
+ * then z), but with the blocks held by the Storage policy: AosStorage (the
+ * layout Chunk uses), SoaStorage or IdOnlyStorage. Scans run vectorised
+ * over whatever arrays the policy keeps.
+ */
+template <typename Storage> class StorageChunk {
+private:
+  Coordinate _base_pt;
+  int32_t _x_len;
+  int32_t _y_len;
+  int32_t _z_len;
+  Storage _storage;
+
+  size_t index(int x, int y, int z) const {
+    return (static_cast<size_t>(y) * static_cast<size_t>(_x_len) * static_cast<size_t>(_z_len)) +
+           (static_cast<size_t>(x) * static_cast<size_t>(_z_len)) + static_cast<size_t>(z);
+  }
+
+  void check(int x, int y, int z) const {
+    if ((x < 0 || y < 0 || z < 0) || (x > _x_len - 1 || y > _y_len - 1 || z > _z_len - 1)) {
+      throw std::out_of_range("Out of bounds StorageChunk access at " +
+                              to_string(Coordinate(x, y, z)));
+    }
+  }
+
+public:
+  /**
+   * Creates a chunk covering the cuboid between loc1 and loc2 filled with a
+   * single BlockType.
+   * @param loc1: 1st corner of the cuboid
+   * @param loc2: 2nd corner of the cuboid
+   * @param fill: BlockType to fill with
+   */
+  StorageChunk(const Coordinate& loc1, const Coordinate& loc2, const BlockType& fill = Blocks::AIR)
+      : _base_pt(std::min(loc1.x, loc2.x), std::min(loc1.y, loc2.y), std::min(loc1.z, loc2.z)),
+        _x_len(std::abs(loc1.x - loc2.x) + 1), _y_len(std::abs(loc1.y - loc2.y) + 1),
+        _z_len(std::abs(loc1.z - loc2.z) + 1),
+        _storage(static_cast<size_t>(_x_len) * static_cast<size_t>(_y_len) *
+                     static_cast<size_t>(_z_len),
+                 fill) {}
+
+  /**
+   * Copies the blocks of a chunk into this storage.
+   * @param chunk: Chunk to copy
+   */
+  explicit StorageChunk(const Chunk& chunk)
+      : _base_pt(chunk.base_pt()), _x_len(chunk.x_len()), _y_len(chunk.y_len()),
+        _z_len(chunk.z_len()), _storage(chunk.size(), Blocks::AIR) {
+    const BlockType* data = chunk.data();
+    for (size_t i = 0; i < chunk.size(); i++) {
+      _storage.set(i, data[i]);
+    }
+  }
+
+  /**
+   * Local equivalent of get_worldspace, equivalent to a 3D array access.
+   * @param x: x element of array access
+   * @param y: y element of array access
+   * @param z: z element of array access
+   * @return BlockType at specified location
+   */
+  BlockType get(int x, int y, int z) const {
+    check(x, y, z);
+    return _storage.get(index(x, y, z));
+  }
+
+  /**
+   * Accesses the Minecraft block at absolute position pos and returns its
+   * BlockType if it is in the included area.
+   * @param pos: Absolute position in the Minecraft world to query BlockType
+   * for
+   * @return BlockType at specified location
+   */
+  BlockType get_worldspace(const Coordinate& pos) const {
+    return get(pos.x - _base_pt.x, pos.y - _base_pt.y, pos.z - _base_pt.z);
+  }
+
+  /**
+   * Replaces the block at an offset from the base point.
+   * @param x: x element of array access
+   * @param y: y element of array access
+   * @param z: z element of array access
+   * @param block: BlockType to store
+   */
+  void set(int x, int y, int z, const BlockType& block) {
+    check(x, y, z);
+    _storage.set(index(x, y, z), block);
+  }
+
+  /**
+   * Replaces the block at an absolute position in the Minecraft world.
+   * @param pos: Absolute position in the Minecraft world
+   * @param block: BlockType to store
+   */
+  void set_worldspace(const Coordinate& pos, const BlockType& block) {
+    set(pos.x - _base_pt.x, pos.y - _base_pt.y, pos.z - _base_pt.z, block);
+  }
+
+  /**
+   * Counts the blocks matching a BlockType.
+   * @param block: BlockType to count
+   * @param match_mod: Whether the mod has to match as well as the id
+   * @return number of matching blocks
+   */
+  size_t count(const BlockType& block, bool match_mod = true) const {
+    return _storage.count(block, match_mod);
+  }
+
+  /**
+   * Finds the first block matching a BlockType, in iteration order (y, then
+   * x, then z).
+   * @param block: BlockType to find
+   * @param match_mod: Whether the mod has to match as well as the id
+   * @return Absolute position of the block, or nothing if there is none
+   */
+  std::optional<Coordinate> find_first(const BlockType& block, bool match_mod = true) const {
+    size_t i = _storage.find(block, match_mod);
+    if (i == _storage.size()) {
+      return std::nullopt;
+    }
+    size_t x_stride = _z_len;
+    size_t y_stride = static_cast<size_t>(_x_len) * _z_len;
+    return Coordinate(_base_pt.x + static_cast<int>((i % y_stride) / x_stride),
+                      _base_pt.y + static_cast<int>(i / y_stride),
+                      _base_pt.z + static_cast<int>(i % x_stride));
+  }
+
+  /**
+   * Copies the blocks back into a Chunk.
+   * @return Chunk with the same area and blocks
+   */
+  Chunk to_chunk() const {
+    auto blocks = std::make_unique<BlockType[]>(_storage.size());
+    for (size_t i = 0; i < _storage.size(); i++) {
+      blocks[i] = _storage.get(i);
+    }
+    return Chunk{_base_pt, _base_pt + Coordinate(_x_len - 1, _y_len - 1, _z_len - 1),
+                 std::move(blocks)};
+  }
+
+  int32_t x_len() const { return _x_len; }
+  int32_t y_len() const { return _y_len; }
+  int32_t z_len() const { return _z_len; }
+  Coordinate base_pt() const { return _base_pt; }
+
+  /// The storage policy, for direct access to its arrays
+  const Storage& storage() const { return _storage; }
+
+  /**
+   * @brief Forward iterator over the blocks in the same order as
+   * Chunk::ConstIterator (y, then x, then z), yielding blocks by value.
+   */
+  struct ConstIterator {
+    using iterator_category = std::input_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = BlockType;
+    using pointer = const BlockType*;
+    using reference = BlockType;
+
+    ConstIterator(const Storage* storage, size_t i) : _storage(storage), _i(i) {}
+
+    reference operator*() const { return _storage->get(_i); }
+
+    ConstIterator& operator++() {
+      ++_i;
+      return *this;
+    }
+
+    ConstIterator operator++(int) {
+      ConstIterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    friend bool operator==(const ConstIterator& a, const ConstIterator& b) { return a._i == b._i; }
+
+    friend bool operator!=(const ConstIterator& a, const ConstIterator& b) { return a._i != b._i; }
+
+  private:
+    const Storage* _storage;
+    size_t _i;
+  };
+
+  ConstIterator begin() const { return {&_storage, 0}; }
+  ConstIterator end() const { return {&_storage, _storage.size()}; }
+};
+} // namespace mcpp
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** @file
+ * @brief ThreadPool class.
+ */
+namespace mcpp {
+/**
+ * Fixed set of worker threads for running a batch of independent tasks and
+ * waiting for all of them. The thread that starts a batch works on it too,
+ * so a pool of n threads starts n - 1 workers, and batches may be started
+ * from inside a task.
+ */
+class ThreadPool {
+private:
+  struct Job;
+
+  std::vector<std::thread> _workers;
+  std::deque<std::shared_ptr<Job>> _jobs;
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  std::condition_variable _finished;
+  bool _stopping = false;
+
+  void work(Job& job);
+  void worker_loop();
+
+public:
+  /**
+   * Starts the worker threads.
+   * @param threads: Number of threads working on each batch, the calling
+   * thread included. Defaults to the number of hardware threads.
+   */
+  explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * Calls task(i) for every i in [0, count) across the pool and returns once
+   * all calls have finished. If any call throws, the first exception is
+   * rethrown here after the others have finished.
+   * @param count: Number of tasks
+   * @param task: Task to run, called concurrently from several threads
+   */
+  void run(size_t count, const std::function<void(size_t)>& task);
+
+  /**
+   * Gets the number of threads working on each batch.
+   * @return thread count, the calling thread included
+   */
+  size_t size() const { return _workers.size() + 1; }
+
+  /**
+   * Pool shared by the parallel algorithms when none is given, sized to the
+   * number of hardware threads and started on first use.
+   * @return the shared pool
+   */
+  static ThreadPool& shared();
+};
+} // namespace mcpp
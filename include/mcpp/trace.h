@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/** @file
+ * @brief Tracer class.
+ *
+ */
+namespace mcpp {
+// Forward declare to avoid exposing internal span helper
+class TraceSpan;
+
+/**
+ * @brief Aggregated timing or counter value gathered by the compile-time
+ * instrumentation, summed over all threads.
+ */
+struct ProfileEntry {
+  /// Name given to the instrumented scope or counter.
+  std::string name;
+  /// True for counters, false for timed scopes.
+  bool is_counter;
+  /// Number of times the scope was entered or the counter was bumped.
+  uint64_t calls;
+  /// Total nanoseconds spent in the scope, or the summed counter value.
+  uint64_t total;
+};
+
+/**
+ * @brief Opt-in recorder of timed client activity.
+ *
+ * While started, the library records a span for each stage of a server call
+ * (command encoding, socket send, waiting for the server, receiving the reply
+ * and parsing it) along with the thread it ran on. Recorded spans can be
+ * written out in the Chrome trace-event JSON format and opened in
+ * chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Recording is off by default and costs a single atomic load per span while
+ * stopped.
+ */
+class Tracer {
+public:
+  /**
+   * @brief Starts recording spans from all threads.
+   */
+  static void start();
+
+  /**
+   * @brief Stops recording spans. Already recorded spans are kept until
+   * clear() is called.
+   */
+  static void stop();
+
+  /**
+   * @brief Checks if spans are currently being recorded.
+   *
+   * @return True if the tracer is recording, false otherwise.
+   */
+  static bool enabled();
+
+  /**
+   * @brief Discards all recorded spans and instrumentation data. Should not be
+   * called while other threads are using the library.
+   */
+  static void clear();
+
+  /**
+   * @brief Checks if the library was built with compile-time
+   * instrumentation (the MCPP_INSTRUMENTATION CMake option).
+   *
+   * @return True if instrumented scopes and counters are recorded.
+   */
+  static bool instrumented();
+
+  /**
+   * @brief Gets per-name totals of the compile-time instrumentation. Always
+   * empty unless instrumented() is true.
+   *
+   * @return One entry per instrumented scope or counter name, sorted by name.
+   */
+  static std::vector<ProfileEntry> profile();
+
+  /**
+   * @brief Gets the number of spans recorded so far.
+   *
+   * @return Number of recorded spans.
+   */
+  static size_t event_count();
+
+  /**
+   * @brief Writes all recorded spans as Chrome trace-event JSON. Scopes from
+   * the compile-time instrumentation are included under the "instrument"
+   * category.
+   *
+   * @param out Stream to write the JSON document to.
+   */
+  static void write_chrome_json(std::ostream& out);
+
+  /**
+   * @brief Writes all recorded spans as Chrome trace-event JSON to a file.
+   *
+   * @param path Path of the file to create or overwrite.
+   */
+  static void write_chrome_json(const std::string& path);
+
+private:
+  friend class TraceSpan;
+
+  static void record(const char* name, int64_t start_ns, int64_t end_ns, int64_t bytes);
+};
+} // namespace mcpp
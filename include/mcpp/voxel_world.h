@@ -0,0 +1,182 @@
+#pragma once
+
+#include "block.h"
+#include "chunk.h"
+#include "coordinate.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/** @file
+ * @brief VoxelWorld class.
+ */
+namespace mcpp {
+/**
+ * Sparse block storage for data scattered over large areas. The world is split
+ * into 16x16x16 sections stored in a hash map keyed by section coordinate
+ * (world coordinate divided by 16, rounded down). Sections that are entirely
+ * air are not stored and sections of a single block type are collapsed to
+ * that one value, so memory scales with content rather than with the volume
+ * of the bounding box.
+ */
+class VoxelWorld {
+public:
+  static constexpr int SECTION_LEN = 16;
+  static constexpr int SECTION_VOLUME = SECTION_LEN * SECTION_LEN * SECTION_LEN;
+
+  /**
+   * A 16x16x16 block of the world, either a single uniform value or one
+   * BlockType per block in the same y, x, z order as Chunk.
+   */
+  class Section {
+  public:
+    explicit Section(const BlockType& fill = Blocks::AIR)
+        : _uniform(fill), _non_air(fill == Blocks::AIR ? 0 : SECTION_VOLUME) {}
+
+    /**
+     * Gets the block at a position local to the section.
+     * @param x: x offset in [0, 16)
+     * @param y: y offset in [0, 16)
+     * @param z: z offset in [0, 16)
+     * @return BlockType at specified offset
+     */
+    BlockType get(int x, int y, int z) const {
+      return _blocks.empty() ? _uniform : _blocks[index(x, y, z)];
+    }
+
+    /**
+     * Sets the block at a position local to the section, expanding a
+     * uniform section if the value differs.
+     */
+    void set(int x, int y, int z, const BlockType& block);
+
+    /**
+     * Whether the section is stored as a single value.
+     * @return true if uniform, false if every block is stored
+     */
+    bool is_uniform() const { return _blocks.empty(); }
+
+    /**
+     * Number of blocks in the section that are not air.
+     * @return count in [0, 4096]
+     */
+    int non_air() const { return _non_air; }
+
+    /**
+     * Collapses the section to a single value if all of its blocks are the
+     * same.
+     * @return true if the section is uniform afterwards
+     */
+    bool collapse();
+
+    /**
+     * Hash of the section's blocks, the same for uniform and expanded
+     * sections holding the same blocks. Cached until the section changes.
+     * @return hash of the blocks
+     */
+    uint64_t hash() const;
+
+  private:
+    static size_t index(int x, int y, int z) {
+      return (y * SECTION_LEN * SECTION_LEN) + (x * SECTION_LEN) + z;
+    }
+
+    BlockType _uniform;
+    std::vector<BlockType> _blocks;
+    int _non_air;
+    mutable uint64_t _hash = 0;
+    mutable bool _hashed = false;
+
+    friend class VoxelWorld;
+  };
+
+  using SectionMap = std::unordered_map<Coordinate, Section, Coordinate>;
+
+  VoxelWorld() = default;
+
+  /**
+   * Builds a world holding the blocks of a chunk.
+   * @param chunk: Chunk to import
+   */
+  explicit VoxelWorld(const Chunk& chunk);
+
+  /**
+   * Gets the block at a world position, air where nothing was stored.
+   * @param pos: Absolute position in the Minecraft world
+   * @return BlockType at specified location
+   */
+  BlockType get(const Coordinate& pos) const;
+
+  /**
+   * Sets the block at a world position. Sections left entirely air are
+   * removed.
+   * @param pos: Absolute position in the Minecraft world
+   * @param block: BlockType to store
+   */
+  void set(const Coordinate& pos, const BlockType& block);
+
+  /**
+   * Copies every block of a chunk into the world at the chunk's position,
+   * collapsing the sections it touches where possible.
+   * @param chunk: Chunk to import
+   */
+  void import_chunk(const Chunk& chunk);
+
+  /**
+   * Copies a cuboid of the world into a dense Chunk.
+   * @param loc1: 1st corner of the cuboid
+   * @param loc2: 2nd corner of the cuboid
+   * @return Chunk containing the blocks in the specified area
+   */
+  Chunk export_chunk(const Coordinate& loc1, const Coordinate& loc2) const;
+
+  /**
+   * Collapses every section whose blocks are all the same and removes those
+   * that are all air. set() only removes sections, it does not collapse them.
+   */
+  void compact();
+
+  /**
+   * Stored (non-empty) sections, keyed by section coordinate. Iterate these
+   * to visit only the parts of the world that hold blocks.
+   * @return map of section coordinate to Section
+   */
+  const SectionMap& sections() const { return _sections; }
+
+  /**
+   * Finds the sections holding different blocks from another world's by
+   * comparing section hashes, so only sections changed since they were last
+   * hashed are read. Not safe to call concurrently with itself on the same
+   * world, as it may update the cached hashes.
+   * @param other: World to compare with
+   * @return Section coordinates of the differing sections, in no particular
+   * order
+   */
+  std::vector<Coordinate> changed_sections(const VoxelWorld& other) const;
+
+  /**
+   * Gets the section coordinate containing a world position.
+   * @param pos: Absolute position in the Minecraft world
+   * @return coordinate of the section, pos divided by 16 rounded down
+   */
+  static Coordinate section_of(const Coordinate& pos);
+
+  /**
+   * Gets the world position of the minimum corner of a section.
+   * @param section: Section coordinate
+   * @return world coordinate of the section's first block
+   */
+  static Coordinate section_origin(const Coordinate& section);
+
+  /**
+   * Approximate heap memory used by the stored sections.
+   * @return size in bytes
+   */
+  size_t memory_usage() const;
+
+  void clear() { _sections.clear(); }
+
+private:
+  SectionMap _sections;
+};
+} // namespace mcpp
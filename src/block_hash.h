@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../include/mcpp/block.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/** @file
+ * @brief Non-cryptographic hashing of block rows, for change detection.
+ */
+namespace mcpp::hash {
+
+constexpr uint64_t MULTIPLIER = 0x9e3779b97f4a7c15ULL;
+
+/// splitmix64 finaliser
+inline uint64_t finalize(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/// Hash of a pair of hashes, order dependent
+inline uint64_t combine(uint64_t a, uint64_t b) { return finalize((a * MULTIPLIER) ^ b); }
+
+/**
+ * Hashes blocks fed in rows. Blocks are packed four to a 64-bit word and the
+ * words spread over four independent accumulators, so a 16-block row is four
+ * multiplies with no dependency between them. Rows shorter than a multiple
+ * of four are padded, which is unambiguous as long as the rows of the
+ * regions compared have the same lengths.
+ */
+class Hasher {
+public:
+  void add(const BlockType* blocks, size_t n) {
+    static_assert(sizeof(BlockType) == 2, "blocks are packed as 16-bit lanes");
+    _count += n;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      uint64_t word;
+      std::memcpy(&word, blocks + i, sizeof(word));
+      mix(word);
+    }
+    if (i < n) {
+      uint64_t word = 0;
+      std::memcpy(&word, blocks + i, (n - i) * sizeof(BlockType));
+      mix(word);
+    }
+  }
+
+  uint64_t finish() const {
+    uint64_t h = combine(combine(_acc[0], _acc[1]), combine(_acc[2], _acc[3]));
+    return combine(h, _count);
+  }
+
+private:
+  void mix(uint64_t word) {
+    uint64_t& acc = _acc[_next++ & 3];
+    acc = (acc ^ word) * MULTIPLIER;
+    acc ^= acc >> 32;
+  }
+
+  uint64_t _acc[4] = {1, 2, 3, 4};
+  size_t _next = 0;
+  uint64_t _count = 0;
+};
+
+} // namespace mcpp::hash
@@ -0,0 +1,530 @@
+#include "block_scan.h"
+
+#include <algorithm>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MCPP_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace mcpp::scan {
+
+namespace {
+constexpr size_t OVERFLOW_SLOT = HISTOGRAM_SLOTS - 1;
+
+inline size_t slot(uint16_t value) {
+  size_t id = value & 0xff;
+  size_t mod = value >> 8;
+  return mod < 16 ? (id * 16) + mod : OVERFLOW_SLOT;
+}
+
+inline void mark(uint64_t* dirty, size_t i) { dirty[i / 64] |= uint64_t{1} << (i % 64); }
+
+/// Blocks counted between flushes of the 32-bit histogram tables, which
+/// keeps every counter below 2^32
+constexpr size_t SEGMENT = size_t{1} << 31;
+
+/**
+ * 32-bit counters in four interleaved tables, so that neighbouring blocks of
+ * the same type do not serialise on one counter.
+ */
+class Tables {
+private:
+  static constexpr size_t WAYS = 4;
+
+  std::vector<uint32_t> _counts;
+  uint64_t* _totals;
+
+public:
+  explicit Tables(uint64_t* totals) : _counts(WAYS * HISTOGRAM_SLOTS, 0), _totals(totals) {}
+
+  void add(size_t way, uint16_t value, uint32_t n) {
+    _counts[(way * HISTOGRAM_SLOTS) + slot(value)] += n;
+  }
+
+  /// Moves the counts into the 64-bit totals
+  void flush() {
+    for (size_t way = 0; way < WAYS; way++) {
+      for (size_t i = 0; i < HISTOGRAM_SLOTS; i++) {
+        _totals[i] += _counts[(way * HISTOGRAM_SLOTS) + i];
+        _counts[(way * HISTOGRAM_SLOTS) + i] = 0;
+      }
+    }
+  }
+};
+
+/**
+ * The few BlockTypes seen most recently, which the vector kernels count with
+ * one compare per vector each. A block that misses all of them replaces the
+ * oldest, so chunks made of a handful of blocks rarely fall back to counting
+ * lane by lane.
+ */
+class HotBlocks {
+public:
+  static constexpr size_t SIZE = 4;
+
+private:
+  uint64_t* _totals;
+  uint16_t _values[SIZE] = {};
+  uint64_t _counts[SIZE] = {};
+  size_t _next = 0;
+
+public:
+  explicit HotBlocks(uint64_t* totals) : _totals(totals) {}
+  HotBlocks(const HotBlocks&) = delete;
+  HotBlocks& operator=(const HotBlocks&) = delete;
+  ~HotBlocks() {
+    for (size_t k = 0; k < SIZE; k++) {
+      _totals[slot(_values[k])] += _counts[k];
+    }
+  }
+
+  uint16_t value(size_t k) const { return _values[k]; }
+
+  void add(size_t k, uint32_t n) { _counts[k] += n; }
+
+  void promote(uint16_t value) {
+    _totals[slot(_values[_next])] += _counts[_next];
+    _values[_next] = value;
+    _counts[_next] = 0;
+    _next = (_next + 1) % SIZE;
+  }
+};
+
+size_t count_scalar(const BlockType* data, size_t n, uint16_t value, uint16_t mask) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++) {
+    count += (lane(data[i]) & mask) == value ? 1 : 0;
+  }
+  return count;
+}
+
+size_t find_scalar(const BlockType* data, size_t n, uint16_t value, uint16_t mask) {
+  for (size_t i = 0; i < n; i++) {
+    if ((lane(data[i]) & mask) == value) {
+      return i;
+    }
+  }
+  return n;
+}
+
+void histogram_scalar(const BlockType* data, size_t n, uint64_t* counts) {
+  Tables tables(counts);
+  for (size_t start = 0; start < n; start += SEGMENT) {
+    size_t end = std::min(n, start + SEGMENT);
+    size_t i = start;
+    for (; i + 4 <= end; i += 4) {
+      tables.add(0, lane(data[i]), 1);
+      tables.add(1, lane(data[i + 1]), 1);
+      tables.add(2, lane(data[i + 2]), 1);
+      tables.add(3, lane(data[i + 3]), 1);
+    }
+    for (; i < end; i++) {
+      tables.add(0, lane(data[i]), 1);
+    }
+    tables.flush();
+  }
+}
+
+// Replaces in data[from, n), for the tails of the vectorised loops
+size_t replace_tail(BlockType* data, size_t from, size_t n, uint16_t value, uint16_t mask,
+                    BlockType to, uint64_t* dirty) {
+  size_t replaced = 0;
+  for (size_t i = from; i < n; i++) {
+    if ((lane(data[i]) & mask) == value) {
+      data[i] = to;
+      mark(dirty, i);
+      replaced++;
+    }
+  }
+  return replaced;
+}
+
+size_t replace_scalar(BlockType* data, size_t n, uint16_t value, uint16_t mask, BlockType to,
+                      uint64_t* dirty) {
+  return replace_tail(data, 0, n, value, mask, to, dirty);
+}
+
+size_t count_bytes_scalar(const uint8_t* data, size_t n, uint8_t value) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++) {
+    count += data[i] == value ? 1 : 0;
+  }
+  return count;
+}
+
+size_t find_bytes_scalar(const uint8_t* data, size_t n, uint8_t value) {
+  for (size_t i = 0; i < n; i++) {
+    if (data[i] == value) {
+      return i;
+    }
+  }
+  return n;
+}
+
+// Diffs a[from, n) against b, for the tails of the vectorised loops
+size_t diff_tail(const BlockType* a, const BlockType* b, size_t from, size_t n,
+                 uint64_t* changed) {
+  size_t count = 0;
+  for (size_t i = from; i < n; i++) {
+    if (lane(a[i]) != lane(b[i])) {
+      mark(changed, i);
+      count++;
+    }
+  }
+  return count;
+}
+
+size_t diff_scalar(const BlockType* a, const BlockType* b, size_t n, uint64_t* changed) {
+  return diff_tail(a, b, 0, n, changed);
+}
+
+#ifdef MCPP_SCAN_X86
+// movemask_epi8 yields two bits per 16-bit lane, these keep one per lane
+constexpr uint32_t LANE_BITS = 0x55555555;
+
+__attribute__((target("sse2"))) size_t count_sse2(const BlockType* data, size_t n,
+                                                   uint16_t value, uint16_t mask) {
+  const __m128i v = _mm_set1_epi16(static_cast<short>(value));
+  const __m128i m = _mm_set1_epi16(static_cast<short>(mask));
+  size_t count = 0;
+  size_t i = 0;
+  while (i + 8 <= n) {
+    // 16-bit lane counters, summed before any of them can wrap
+    __m128i acc = _mm_setzero_si128();
+    size_t end = std::min(n - ((n - i) % 8), i + (8 * 0xffff));
+    for (; i < end; i += 8) {
+      __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      acc = _mm_sub_epi16(acc, _mm_cmpeq_epi16(_mm_and_si128(lanes, m), v));
+    }
+    __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_add_epi32(_mm_unpacklo_epi16(acc, zero), _mm_unpackhi_epi16(acc, zero));
+    alignas(16) uint32_t parts[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(parts), sum);
+    count += static_cast<size_t>(parts[0]) + parts[1] + parts[2] + parts[3];
+  }
+  return count + count_scalar(data + i, n - i, value, mask);
+}
+
+__attribute__((target("sse2"))) size_t find_sse2(const BlockType* data, size_t n, uint16_t value,
+                                                  uint16_t mask) {
+  const __m128i v = _mm_set1_epi16(static_cast<short>(value));
+  const __m128i m = _mm_set1_epi16(static_cast<short>(mask));
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    int bits = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(lanes, m), v));
+    if (bits != 0) {
+      return i + (__builtin_ctz(bits) / 2);
+    }
+  }
+  return i + find_scalar(data + i, n - i, value, mask);
+}
+
+__attribute__((target("sse2"))) void histogram_sse2(const BlockType* data, size_t n,
+                                                     uint64_t* counts) {
+  HotBlocks hot(counts);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    uint32_t rest = LANE_BITS & 0xffff;
+    for (size_t k = 0; k < HotBlocks::SIZE && rest != 0; k++) {
+      __m128i eq = _mm_cmpeq_epi16(lanes, _mm_set1_epi16(static_cast<short>(hot.value(k))));
+      uint32_t bits = static_cast<uint32_t>(_mm_movemask_epi8(eq)) & rest;
+      hot.add(k, __builtin_popcount(bits));
+      rest &= ~bits;
+    }
+    for (; rest != 0; rest &= rest - 1) {
+      uint16_t value = lane(data[i + (__builtin_ctz(rest) / 2)]);
+      counts[slot(value)]++;
+      hot.promote(value);
+    }
+  }
+  for (; i < n; i++) {
+    counts[slot(lane(data[i]))]++;
+  }
+}
+
+__attribute__((target("sse2"))) size_t replace_sse2(BlockType* data, size_t n, uint16_t value,
+                                                     uint16_t mask, BlockType to,
+                                                     uint64_t* dirty) {
+  const __m128i v = _mm_set1_epi16(static_cast<short>(value));
+  const __m128i m = _mm_set1_epi16(static_cast<short>(mask));
+  const __m128i t = _mm_set1_epi16(static_cast<short>(lane(to)));
+  size_t replaced = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    auto* ptr = reinterpret_cast<__m128i*>(data + i);
+    __m128i lanes = _mm_loadu_si128(ptr);
+    __m128i eq = _mm_cmpeq_epi16(_mm_and_si128(lanes, m), v);
+    auto bits = static_cast<uint32_t>(_mm_movemask_epi8(eq)) & LANE_BITS;
+    if (bits == 0) {
+      continue;
+    }
+    _mm_storeu_si128(ptr, _mm_or_si128(_mm_and_si128(eq, t), _mm_andnot_si128(eq, lanes)));
+    for (; bits != 0; bits &= bits - 1) {
+      mark(dirty, i + (__builtin_ctz(bits) / 2));
+      replaced++;
+    }
+  }
+  return replaced + replace_tail(data, i, n, value, mask, to, dirty);
+}
+
+__attribute__((target("avx2"))) size_t count_avx2(const BlockType* data, size_t n,
+                                                   uint16_t value, uint16_t mask) {
+  const __m256i v = _mm256_set1_epi16(static_cast<short>(value));
+  const __m256i m = _mm256_set1_epi16(static_cast<short>(mask));
+  size_t count = 0;
+  size_t i = 0;
+  while (i + 16 <= n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t end = std::min(n - ((n - i) % 16), i + (16 * 0xffff));
+    for (; i < end; i += 16) {
+      __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+      acc = _mm256_sub_epi16(acc, _mm256_cmpeq_epi16(_mm256_and_si256(lanes, m), v));
+    }
+    __m256i zero = _mm256_setzero_si256();
+    __m256i sum =
+        _mm256_add_epi32(_mm256_unpacklo_epi16(acc, zero), _mm256_unpackhi_epi16(acc, zero));
+    alignas(32) uint32_t parts[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(parts), sum);
+    for (uint32_t part : parts) {
+      count += part;
+    }
+  }
+  return count + count_scalar(data + i, n - i, value, mask);
+}
+
+__attribute__((target("avx2"))) size_t find_avx2(const BlockType* data, size_t n, uint16_t value,
+                                                  uint16_t mask) {
+  const __m256i v = _mm256_set1_epi16(static_cast<short>(value));
+  const __m256i m = _mm256_set1_epi16(static_cast<short>(mask));
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    auto bits = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(lanes, m), v)));
+    if (bits != 0) {
+      return i + (__builtin_ctz(bits) / 2);
+    }
+  }
+  return i + find_scalar(data + i, n - i, value, mask);
+}
+
+__attribute__((target("avx2"))) void histogram_avx2(const BlockType* data, size_t n,
+                                                     uint64_t* counts) {
+  HotBlocks hot(counts);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i lanes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    uint32_t rest = LANE_BITS;
+    for (size_t k = 0; k < HotBlocks::SIZE && rest != 0; k++) {
+      __m256i eq = _mm256_cmpeq_epi16(lanes, _mm256_set1_epi16(static_cast<short>(hot.value(k))));
+      uint32_t bits = static_cast<uint32_t>(_mm256_movemask_epi8(eq)) & rest;
+      hot.add(k, __builtin_popcount(bits));
+      rest &= ~bits;
+    }
+    for (; rest != 0; rest &= rest - 1) {
+      uint16_t value = lane(data[i + (__builtin_ctz(rest) / 2)]);
+      counts[slot(value)]++;
+      hot.promote(value);
+    }
+  }
+  for (; i < n; i++) {
+    counts[slot(lane(data[i]))]++;
+  }
+}
+
+__attribute__((target("avx2"))) size_t replace_avx2(BlockType* data, size_t n, uint16_t value,
+                                                     uint16_t mask, BlockType to,
+                                                     uint64_t* dirty) {
+  const __m256i v = _mm256_set1_epi16(static_cast<short>(value));
+  const __m256i m = _mm256_set1_epi16(static_cast<short>(mask));
+  const __m256i t = _mm256_set1_epi16(static_cast<short>(lane(to)));
+  size_t replaced = 0;
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    auto* ptr = reinterpret_cast<__m256i*>(data + i);
+    __m256i lanes = _mm256_loadu_si256(ptr);
+    __m256i eq = _mm256_cmpeq_epi16(_mm256_and_si256(lanes, m), v);
+    auto bits = static_cast<uint32_t>(_mm256_movemask_epi8(eq)) & LANE_BITS;
+    if (bits == 0) {
+      continue;
+    }
+    _mm256_storeu_si256(ptr, _mm256_blendv_epi8(lanes, t, eq));
+    for (; bits != 0; bits &= bits - 1) {
+      mark(dirty, i + (__builtin_ctz(bits) / 2));
+      replaced++;
+    }
+  }
+  return replaced + replace_tail(data, i, n, value, mask, to, dirty);
+}
+
+__attribute__((target("sse2"))) size_t count_bytes_sse2(const uint8_t* data, size_t n,
+                                                         uint8_t value) {
+  const __m128i v = _mm_set1_epi8(static_cast<char>(value));
+  const __m128i zero = _mm_setzero_si128();
+  size_t count = 0;
+  size_t i = 0;
+  while (i + 16 <= n) {
+    // 8-bit lane counters, summed by sad_epu8 before any of them can wrap
+    __m128i acc = _mm_setzero_si128();
+    size_t end = std::min(n - ((n - i) % 16), i + (16 * 0xff));
+    for (; i < end; i += 16) {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(bytes, v));
+    }
+    __m128i sum = _mm_sad_epu8(acc, zero);
+    count += static_cast<size_t>(_mm_cvtsi128_si32(sum)) +
+             static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+  }
+  return count + count_bytes_scalar(data + i, n - i, value);
+}
+
+__attribute__((target("sse2"))) size_t find_bytes_sse2(const uint8_t* data, size_t n,
+                                                        uint8_t value) {
+  const __m128i v = _mm_set1_epi8(static_cast<char>(value));
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    int bits = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, v));
+    if (bits != 0) {
+      return i + __builtin_ctz(bits);
+    }
+  }
+  return i + find_bytes_scalar(data + i, n - i, value);
+}
+
+__attribute__((target("avx2"))) size_t count_bytes_avx2(const uint8_t* data, size_t n,
+                                                         uint8_t value) {
+  const __m256i v = _mm256_set1_epi8(static_cast<char>(value));
+  const __m256i zero = _mm256_setzero_si256();
+  size_t count = 0;
+  size_t i = 0;
+  while (i + 32 <= n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t end = std::min(n - ((n - i) % 32), i + (32 * 0xff));
+    for (; i < end; i += 32) {
+      __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+      acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(bytes, v));
+    }
+    alignas(32) uint64_t parts[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(parts), _mm256_sad_epu8(acc, zero));
+    count += parts[0] + parts[1] + parts[2] + parts[3];
+  }
+  return count + count_bytes_scalar(data + i, n - i, value);
+}
+
+__attribute__((target("avx2"))) size_t find_bytes_avx2(const uint8_t* data, size_t n,
+                                                        uint8_t value) {
+  const __m256i v = _mm256_set1_epi8(static_cast<char>(value));
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    auto bits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, v)));
+    if (bits != 0) {
+      return i + __builtin_ctz(bits);
+    }
+  }
+  return i + find_bytes_scalar(data + i, n - i, value);
+}
+
+// Both diff kernels work a 64-byte block (32 lanes) at a time, so each block
+// fills half of a changed word
+__attribute__((target("sse2"))) size_t diff_sse2(const BlockType* a, const BlockType* b,
+                                                  size_t n, uint64_t* changed) {
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m128i eq[4];
+    for (int j = 0; j < 4; j++) {
+      __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + (j * 8)));
+      __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + (j * 8)));
+      eq[j] = _mm_cmpeq_epi16(x, y);
+    }
+    __m128i all = _mm_and_si128(_mm_and_si128(eq[0], eq[1]), _mm_and_si128(eq[2], eq[3]));
+    if (_mm_movemask_epi8(all) == 0xffff) {
+      continue;
+    }
+    // Packing narrows each lane's compare to a byte, so movemask gives one bit per lane
+    auto lo = static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(eq[0], eq[1])));
+    auto hi = static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(eq[2], eq[3])));
+    uint32_t bits = ~(lo | (hi << 16));
+    changed[i / 64] |= static_cast<uint64_t>(bits) << (i % 64);
+    count += __builtin_popcount(bits);
+  }
+  return count + diff_tail(a, b, i, n, changed);
+}
+
+__attribute__((target("avx2"))) size_t diff_avx2(const BlockType* a, const BlockType* b,
+                                                  size_t n, uint64_t* changed) {
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 16));
+    __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 16));
+    __m256i eq0 = _mm256_cmpeq_epi16(a0, b0);
+    __m256i eq1 = _mm256_cmpeq_epi16(a1, b1);
+    if (_mm256_movemask_epi8(_mm256_and_si256(eq0, eq1)) == -1) {
+      continue;
+    }
+    // packs works within 128-bit halves, the permute puts the lanes back in order
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(eq0, eq1), 0xd8);
+    uint32_t bits = ~static_cast<uint32_t>(_mm256_movemask_epi8(packed));
+    changed[i / 64] |= static_cast<uint64_t>(bits) << (i % 64);
+    count += __builtin_popcount(bits);
+  }
+  return count + diff_tail(a, b, i, n, changed);
+}
+#endif
+
+Isa detect() {
+#ifdef MCPP_SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Isa::AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return Isa::SSE2;
+  }
+#endif
+  return Isa::Scalar;
+}
+} // namespace
+
+const Kernels& kernels(Isa isa) {
+  static const Kernels scalar{count_scalar, find_scalar, histogram_scalar, replace_scalar,
+                              count_bytes_scalar, find_bytes_scalar, diff_scalar};
+#ifdef MCPP_SCAN_X86
+  static const Kernels sse2{count_sse2, find_sse2, histogram_sse2, replace_sse2,
+                            count_bytes_sse2, find_bytes_sse2, diff_sse2};
+  static const Kernels avx2{count_avx2, find_avx2, histogram_avx2, replace_avx2,
+                            count_bytes_avx2, find_bytes_avx2, diff_avx2};
+  switch (isa) {
+  case Isa::AVX2:
+    return avx2;
+  case Isa::SSE2:
+    return sse2;
+  case Isa::Scalar:
+    break;
+  }
+#else
+  static_cast<void>(isa);
+#endif
+  return scalar;
+}
+
+Isa best_isa() {
+  static const Isa isa = detect();
+  return isa;
+}
+
+const Kernels& active() {
+  static const Kernels& table = kernels(best_isa());
+  return table;
+}
+
+} // namespace mcpp::scan
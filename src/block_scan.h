@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../include/mcpp/block.h"
+#include <cstddef>
+#include <cstdint>
+
+/** @file
+ * @brief Vectorised kernels over contiguous BlockType arrays.
+ *
+ * Each BlockType is treated as a packed 16-bit lane, id in the low byte and
+ * mod in the high byte. A lane matches when (lane & mask) == value, so a
+ * mask of 0xffff compares whole blocks and 0x00ff compares ids only. Kernels
+ * exist for AVX2, SSE2 and plain C++; the best one the CPU supports is
+ * picked once at runtime.
+ */
+namespace mcpp::scan {
+
+static_assert(sizeof(BlockType) == 2, "kernels treat BlockType as a 16-bit lane");
+
+enum class Isa { Scalar, SSE2, AVX2 };
+
+/// Counters per id and mod, indexed id * 16 + mod, plus one slot for mods
+/// above 15
+constexpr size_t HISTOGRAM_SLOTS = (256 * 16) + 1;
+
+struct Kernels {
+  /// Number of matching lanes
+  size_t (*count)(const BlockType* data, size_t n, uint16_t value, uint16_t mask);
+  /// Index of the first matching lane, or n if there is none
+  size_t (*find)(const BlockType* data, size_t n, uint16_t value, uint16_t mask);
+  /// Adds the number of each block to counts, which has HISTOGRAM_SLOTS
+  void (*histogram)(const BlockType* data, size_t n, uint64_t* counts);
+  /// Overwrites matching lanes with to, setting their bits in dirty (one bit
+  /// per lane from data[0]), and returns how many were replaced
+  size_t (*replace)(BlockType* data, size_t n, uint16_t value, uint16_t mask, BlockType to,
+                    uint64_t* dirty);
+  /// Number of bytes equal to value, for split id or mod arrays
+  size_t (*count_bytes)(const uint8_t* data, size_t n, uint8_t value);
+  /// Index of the first byte equal to value, or n if there is none
+  size_t (*find_bytes)(const uint8_t* data, size_t n, uint8_t value);
+  /// Sets the bits in changed (one bit per lane from a[0], cleared by the
+  /// caller) of lanes that differ between a and b, and returns how many do
+  size_t (*diff)(const BlockType* a, const BlockType* b, size_t n, uint64_t* changed);
+};
+
+/**
+ * Kernels for an instruction set.
+ * @param isa: Instruction set, which must be supported by the CPU
+ * @return Kernel table
+ */
+const Kernels& kernels(Isa isa);
+
+/**
+ * Best instruction set supported by the CPU, detected on first use.
+ * @return Instruction set
+ */
+Isa best_isa();
+
+/**
+ * Kernels for best_isa().
+ * @return Kernel table
+ */
+const Kernels& active();
+
+/// Packs a block into its lane value
+inline uint16_t lane(const BlockType& block) {
+  return static_cast<uint16_t>(block.id | (block.mod << 8));
+}
+
+} // namespace mcpp::scan
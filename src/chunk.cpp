@@ -1,10 +1,42 @@
+#include <bitset>
 #include <memory>
+#include <stdexcept>
 
 #include "../include/mcpp/chunk.h"
+#include "../include/mcpp/mcpp.h"
+#include "block_scan.h"
+#include "instrument.h"
 
 namespace mcpp {
+namespace {
+// Inline comparison, BlockType::operator== is not visible to the optimiser
+bool same(const BlockType& a, const BlockType& b) { return a.id == b.id && a.mod == b.mod; }
+
+int lowest_set_bit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(word);
+#else
+  int bit = 0;
+  while ((word & 1) == 0) {
+    word >>= 1;
+    bit++;
+  }
+  return bit;
+#endif
+}
+
+void check_same_area(const Chunk& a, const Chunk& b) {
+  if (a.base_pt() != b.base_pt() || a.x_len() != b.x_len() || a.y_len() != b.y_len() ||
+      a.z_len() != b.z_len()) {
+    throw std::invalid_argument("Cannot diff Chunks covering different areas");
+  }
+}
+} // namespace
+
 Chunk::Chunk(const Coordinate& loc1, const Coordinate& loc2,
              const std::vector<BlockType>& block_list) {
+  MCPP_TRACE_SCOPE("chunk_construct");
+  MCPP_TRACE_COUNT("chunk_blocks", block_list.size());
   Coordinate min{std::min(loc1.x, loc2.x), std::min(loc1.y, loc2.y), std::min(loc1.z, loc2.z)};
   _base_pt = min;
 
@@ -17,24 +49,41 @@ Chunk::Chunk(const Coordinate& loc1, const Coordinate& loc2,
   std::copy(block_list.begin(), block_list.end(), _raw_data.get());
 }
 
-Chunk& Chunk::operator=(const Chunk& other) {
-  if (this != &other) {
-    _base_pt = other._base_pt;
-    _x_len = other._x_len;
-    _y_len = other._y_len;
-    _z_len = other._z_len;
-    size_t size = _x_len * _y_len * _z_len;
-    _raw_data = std::make_unique<BlockType[]>(size);
-    std::copy(other._raw_data.get(), other._raw_data.get() + size, _raw_data.get());
+void Chunk::copy_storage() {
+  MCPP_TRACE_SCOPE("chunk_unshare");
+  size_t size = volume();
+  std::shared_ptr<BlockType[]> copy(new BlockType[size]);
+  std::copy(_raw_data.get(), _raw_data.get() + size, copy.get());
+  _raw_data = std::move(copy);
+}
+
+Chunk::Chunk(const Coordinate& loc1, const Coordinate& loc2) {
+  _base_pt = {std::min(loc1.x, loc2.x), std::min(loc1.y, loc2.y), std::min(loc1.z, loc2.z)};
+  _x_len = std::abs(loc1.x - loc2.x) + 1;
+  _y_len = std::abs(loc1.y - loc2.y) + 1;
+  _z_len = std::abs(loc1.z - loc2.z) + 1;
+}
+
+void Chunk::reshape(const Coordinate& loc1, const Coordinate& loc2) {
+  size_t old_volume = volume();
+  _base_pt = {std::min(loc1.x, loc2.x), std::min(loc1.y, loc2.y), std::min(loc1.z, loc2.z)};
+  _x_len = std::abs(loc1.x - loc2.x) + 1;
+  _y_len = std::abs(loc1.y - loc2.y) + 1;
+  _z_len = std::abs(loc1.z - loc2.z) + 1;
+  // Shared blocks are left to the copies rather than copied, they are about
+  // to be overwritten anyway
+  if (volume() != old_volume || is_shared()) {
+    _raw_data = std::make_unique<BlockType[]>(volume());
   }
-  return *this;
+  _dirty.clear();
+  _hashes.reset();
 }
 
 BlockType Chunk::get(int x, int y, int z) const {
   if ((x < 0 || y < 0 || z < 0) || (x > _x_len - 1 || y > _y_len - 1 || z > _z_len - 1)) {
     throw std::out_of_range("Out of bounds Chunk access at " + to_string(Coordinate(x, y, z)));
   }
-  return _raw_data[(y * _x_len * _z_len) + (x * _z_len) + z];
+  return _raw_data[index(x, y, z)];
 }
 
 BlockType Chunk::get_worldspace(const Coordinate& pos) const {
@@ -44,14 +93,222 @@ BlockType Chunk::get_worldspace(const Coordinate& pos) const {
     throw std::out_of_range("Out of bounds Chunk access at " + to_string(array_pos) +
                             " (world coordinate " + to_string(pos) + " )");
   }
-  return _raw_data[(array_pos.y * _x_len * _z_len) + (array_pos.x * _z_len) + array_pos.z];
+  return _raw_data[index(array_pos.x, array_pos.y, array_pos.z)];
+}
+
+void Chunk::set(int x, int y, int z, const BlockType& block) {
+  if ((x < 0 || y < 0 || z < 0) || (x > _x_len - 1 || y > _y_len - 1 || z > _z_len - 1)) {
+    throw std::out_of_range("Out of bounds Chunk access at " + to_string(Coordinate(x, y, z)));
+  }
+  unshare();
+  size_t i = index(x, y, z);
+  _raw_data[i] = block;
+  if (HashTree* hashes = own_hashes()) {
+    hashes->invalidate(x, y, z);
+  }
+  if (_dirty.empty()) {
+    _dirty.assign((volume() + 63) / 64, 0);
+  }
+  _dirty[i / 64] |= uint64_t{1} << (i % 64);
+}
+
+void Chunk::set_worldspace(const Coordinate& pos, const BlockType& block) {
+  Coordinate array_pos = pos - _base_pt;
+  if ((array_pos.x < 0 || array_pos.y < 0 || array_pos.z < 0) ||
+      (array_pos.x > _x_len - 1 || array_pos.y > _y_len - 1 || array_pos.z > _z_len - 1)) {
+    throw std::out_of_range("Out of bounds Chunk access at " + to_string(array_pos) +
+                            " (world coordinate " + to_string(pos) + " )");
+  }
+  set(array_pos.x, array_pos.y, array_pos.z, block);
+}
+
+size_t Chunk::dirty_count() const {
+  size_t count = 0;
+  for (uint64_t word : _dirty) {
+    count += std::bitset<64>(word).count();
+  }
+  return count;
+}
+
+size_t Chunk::commit(MinecraftConnection& mc) {
+  MCPP_TRACE_SCOPE("chunk_commit");
+  auto pending = [&](size_t i) { return ((_dirty[i / 64] >> (i % 64)) & 1) != 0; };
+  // Whether a row of run blocks along z is all changed and all block
+  auto row_matches = [&](size_t start, int run, const BlockType& block) {
+    for (size_t i = start; i < start + run; i++) {
+      if (!pending(i) || !same(_raw_data[i], block)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  size_t x_stride = _z_len;
+  size_t y_stride = static_cast<size_t>(_x_len) * _z_len;
+  size_t calls = 0;
+  for (size_t word = 0; word < _dirty.size(); word++) {
+    while (_dirty[word] != 0) {
+      // Grow a box from the first changed block along z, then x, then y
+      size_t start = (word * 64) + lowest_set_bit(_dirty[word]);
+      int y = static_cast<int>(start / y_stride);
+      int x = static_cast<int>((start % y_stride) / x_stride);
+      int z = static_cast<int>(start % x_stride);
+      BlockType block = _raw_data[start];
+
+      int dz = 1;
+      while (z + dz < _z_len && pending(start + dz) && same(_raw_data[start + dz], block)) {
+        dz++;
+      }
+      int dx = 1;
+      while (x + dx < _x_len && row_matches(start + (dx * x_stride), dz, block)) {
+        dx++;
+      }
+      int dy = 1;
+      while (y + dy < _y_len) {
+        bool layer_matches = true;
+        for (int i = 0; i < dx && layer_matches; i++) {
+          layer_matches = row_matches(start + (dy * y_stride) + (i * x_stride), dz, block);
+        }
+        if (!layer_matches) {
+          break;
+        }
+        dy++;
+      }
+
+      Coordinate loc1 = _base_pt + Coordinate(x, y, z);
+      if (dx == 1 && dy == 1 && dz == 1) {
+        mc.setBlock(loc1, block);
+      } else {
+        mc.setBlocks(loc1, loc1 + Coordinate(dx - 1, dy - 1, dz - 1), block);
+      }
+      calls++;
+
+      for (int j = 0; j < dy; j++) {
+        for (int i = 0; i < dx; i++) {
+          size_t row = start + (j * y_stride) + (i * x_stride);
+          for (size_t k = row; k < row + dz; k++) {
+            _dirty[k / 64] &= ~(uint64_t{1} << (k % 64));
+          }
+        }
+      }
+    }
+  }
+  _dirty.clear();
+  return calls;
+}
+
+size_t Chunk::count(const BlockType& block, bool match_mod) const {
+  uint16_t mask = match_mod ? 0xffff : 0x00ff;
+  return scan::active().count(_raw_data.get(), volume(), scan::lane(block) & mask, mask);
 }
 
-uint16_t Chunk::x_len() const { return this->_x_len; }
+std::optional<Coordinate> Chunk::find_first(const BlockType& block, bool match_mod) const {
+  uint16_t mask = match_mod ? 0xffff : 0x00ff;
+  size_t n = volume();
+  size_t i = scan::active().find(_raw_data.get(), n, scan::lane(block) & mask, mask);
+  if (i == n) {
+    return std::nullopt;
+  }
+  size_t x_stride = _z_len;
+  size_t y_stride = static_cast<size_t>(_x_len) * _z_len;
+  return _base_pt + Coordinate(static_cast<int>((i % y_stride) / x_stride),
+                               static_cast<int>(i / y_stride), static_cast<int>(i % x_stride));
+}
 
-uint16_t Chunk::y_len() const { return this->_y_len; }
+BlockHistogram Chunk::histogram() const {
+  std::array<uint64_t, scan::HISTOGRAM_SLOTS> counts{};
+  scan::active().histogram(_raw_data.get(), volume(), counts.data());
+  BlockHistogram histogram;
+  std::copy(counts.begin(), counts.end() - 1, histogram.counts.begin());
+  histogram.other = counts.back();
+  return histogram;
+}
 
-uint16_t Chunk::z_len() const { return this->_z_len; }
+size_t Chunk::replace(const BlockType& from, const BlockType& to, bool match_mod) {
+  uint16_t mask = match_mod ? 0xffff : 0x00ff;
+  if (is_shared()) {
+    // Only copy shared blocks when something will actually change
+    if (scan::active().find(_raw_data.get(), volume(), scan::lane(from) & mask, mask) ==
+        volume()) {
+      return 0;
+    }
+    copy_storage();
+  }
+  if (_dirty.empty()) {
+    _dirty.assign((volume() + 63) / 64, 0);
+  }
+  // The kernel does not report which sections it touched
+  invalidate_hashes();
+  return scan::active().replace(_raw_data.get(), volume(), scan::lane(from) & mask, mask, to,
+                                _dirty.data());
+}
+
+const HashTree& Chunk::hashes() const {
+  if (!_hashes) {
+    _hashes.reset(new HashTree(_x_len, _y_len, _z_len));
+  }
+  if (_hashes->is_stale()) {
+    // A tree shared with a copy may be hashed by the copy on another thread,
+    // so refresh a private copy of it rather than the shared one
+    if (_hashes.use_count() > 1) {
+      _hashes = std::make_shared<HashTree>(*_hashes);
+    }
+    _hashes->refresh(_raw_data.get());
+  }
+  return *_hashes;
+}
+
+int32_t Chunk::x_len() const { return this->_x_len; }
+
+int32_t Chunk::y_len() const { return this->_y_len; }
+
+int32_t Chunk::z_len() const { return this->_z_len; }
 
 Coordinate Chunk::base_pt() const { return this->_base_pt; }
+
+ChunkDiff diff(const Chunk& before, const Chunk& after) {
+  ChunkDiff out;
+  diff(before, after, out);
+  return out;
+}
+
+void diff(const Chunk& before, const Chunk& after, ChunkDiff& out) {
+  MCPP_TRACE_SCOPE("chunk_diff");
+  check_same_area(before, after);
+  size_t n = after.size();
+  out.mask.assign((n + 63) / 64, 0);
+  out.changes.clear();
+  // Copies that still share their blocks cannot differ
+  if (before.data() == after.data()) {
+    return;
+  }
+  size_t count = scan::active().diff(before.data(), after.data(), n, out.mask.data());
+  out.changes.reserve(count);
+
+  size_t x_stride = after.x_stride();
+  size_t y_stride = after.y_stride();
+  const BlockType* blocks = after.data();
+  for (size_t word = 0; word < out.mask.size(); word++) {
+    for (uint64_t bits = out.mask[word]; bits != 0; bits &= bits - 1) {
+      size_t i = (word * 64) + lowest_set_bit(bits);
+      Coordinate offset(static_cast<int>((i % y_stride) / x_stride),
+                        static_cast<int>(i / y_stride), static_cast<int>(i % x_stride));
+      out.changes.push_back({after.base_pt() + offset, blocks[i]});
+    }
+  }
+}
+
+std::vector<Coordinate> changed_sections(const Chunk& before, const Chunk& after) {
+  MCPP_TRACE_SCOPE("chunk_changed_sections");
+  check_same_area(before, after);
+  if (before.data() == after.data()) {
+    return {};
+  }
+  const HashTree& tree = after.hashes();
+  std::vector<Coordinate> changed;
+  for (size_t section : tree.changed_sections(before.hashes())) {
+    changed.push_back(after.base_pt() + tree.section_offset(section));
+  }
+  return changed;
+}
 } // namespace mcpp
@@ -0,0 +1,65 @@
+#include "../include/mcpp/chunk_view.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace mcpp {
+
+ChunkView::ChunkView(const Chunk& chunk)
+    : _data(chunk.data()), _base_pt(chunk.base_pt()), _x_len(chunk.x_len()),
+      _y_len(chunk.y_len()), _z_len(chunk.z_len()), _x_stride(chunk.x_stride()),
+      _y_stride(chunk.y_stride()) {}
+
+BlockType ChunkView::get(int x, int y, int z) const {
+  if ((x < 0 || y < 0 || z < 0) || (x > _x_len - 1 || y > _y_len - 1 || z > _z_len - 1)) {
+    throw std::out_of_range("Out of bounds ChunkView access at " + to_string(Coordinate(x, y, z)));
+  }
+  return *at(x, y, z);
+}
+
+BlockType ChunkView::get_worldspace(const Coordinate& pos) const {
+  Coordinate array_pos = pos - _base_pt;
+  if ((array_pos.x < 0 || array_pos.y < 0 || array_pos.z < 0) ||
+      (array_pos.x > _x_len - 1 || array_pos.y > _y_len - 1 || array_pos.z > _z_len - 1)) {
+    throw std::out_of_range("Out of bounds ChunkView access at " + to_string(array_pos) +
+                            " (world coordinate " + to_string(pos) + " )");
+  }
+  return *at(array_pos.x, array_pos.y, array_pos.z);
+}
+
+ChunkView ChunkView::layer(int y) const {
+  if (y < 0 || y > _y_len - 1) {
+    throw std::out_of_range("Out of bounds ChunkView layer " + std::to_string(y));
+  }
+  return {at(0, y, 0), Coordinate(_base_pt.x, _base_pt.y + y, _base_pt.z),
+          _x_len, 1, _z_len, _x_stride, _y_stride};
+}
+
+ChunkView ChunkView::slice(const Coordinate& loc1, const Coordinate& loc2) const {
+  Coordinate min{std::min(loc1.x, loc2.x), std::min(loc1.y, loc2.y), std::min(loc1.z, loc2.z)};
+  Coordinate max{std::max(loc1.x, loc2.x), std::max(loc1.y, loc2.y), std::max(loc1.z, loc2.z)};
+  Coordinate lo = min - _base_pt;
+  Coordinate hi = max - _base_pt;
+  if ((lo.x < 0 || lo.y < 0 || lo.z < 0) ||
+      (hi.x > _x_len - 1 || hi.y > _y_len - 1 || hi.z > _z_len - 1)) {
+    throw std::out_of_range("ChunkView slice " + to_string(min) + " to " + to_string(max) +
+                            " is not inside the view");
+  }
+  return {at(lo.x, lo.y, lo.z), min,      hi.x - lo.x + 1, hi.y - lo.y + 1,
+          hi.z - lo.z + 1,      _x_stride, _y_stride};
+}
+
+Chunk ChunkView::to_chunk() const {
+  std::vector<BlockType> blocks;
+  blocks.reserve(static_cast<size_t>(_x_len) * _y_len * _z_len);
+  for (int y = 0; y < _y_len; y++) {
+    for (int x = 0; x < _x_len; x++) {
+      const BlockType* row = at(x, y, 0);
+      blocks.insert(blocks.end(), row, row + _z_len);
+    }
+  }
+  return Chunk{_base_pt, _base_pt + Coordinate(_x_len - 1, _y_len - 1, _z_len - 1), blocks};
+}
+
+} // namespace mcpp
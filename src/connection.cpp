@@ -1,10 +1,13 @@
 #include "connection.h"
+#include "instrument.h"
 
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 
@@ -30,6 +33,12 @@ SocketConnection::SocketConnection(const std::string& address_str, uint16_t port
               sizeof(server_addr)) < 0) {
     throw std::runtime_error("Failed to connect to the server. Check if the server is running.");
   }
+
+  // Commands are small and often follow an unacknowledged one (e.g. setBlock
+  // then getBlocks), which Nagle's algorithm would hold back until the
+  // server's delayed ACK arrives
+  int no_delay = 1;
+  setsockopt(_socket_handle, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
 }
 
 std::string SocketConnection::resolve_hostname(const std::string& hostname) {
@@ -54,6 +63,10 @@ std::string SocketConnection::resolve_hostname(const std::string& hostname) {
 }
 
 void SocketConnection::send(const std::string& data_string) {
+  MCPP_TRACE_SCOPE("socket_send");
+  MCPP_TRACE_COUNT("bytes_sent", data_string.length());
+  TraceSpan span("send");
+  span.set_bytes(static_cast<int64_t>(data_string.length()));
   _last_sent = data_string;
   ssize_t result = write(_socket_handle, data_string.c_str(), data_string.length());
   if (result < 0) {
@@ -62,19 +75,35 @@ void SocketConnection::send(const std::string& data_string) {
 }
 
 std::string SocketConnection::recv() const {
+  MCPP_TRACE_SCOPE("socket_recv");
   std::stringstream response_stream;
   char buffer[BUFFER_SIZE];
 
+  // Time until the first bytes arrive is spent on the server, the rest on the
+  // wire and in copying
+  TraceSpan wait_span("wait");
+  std::optional<TraceSpan> receive_span;
+  int64_t total_read = 0;
+
   ssize_t bytes_read;
   do {
     bytes_read = read(_socket_handle, buffer, sizeof(buffer));
     if (bytes_read < 0) {
       throw std::runtime_error("Failed to receive data.");
     }
+    if (!receive_span) {
+      wait_span.end();
+      receive_span.emplace("receive");
+    }
+    total_read += bytes_read;
 
     response_stream.write(buffer, bytes_read);
   } while (buffer[bytes_read - 1] != '\n');
 
+  MCPP_TRACE_COUNT("bytes_received", total_read);
+  receive_span->set_bytes(total_read);
+  receive_span->end();
+
   std::string response = response_stream.str();
 
   // Remove trailing \n
@@ -5,6 +5,8 @@
 #include <sstream>
 #include <string>
 
+#include "trace_span.h"
+
 #define FAIL_RESPONSE "Fail"
 
 /** @file
@@ -30,13 +32,15 @@ public:
   /**
    * Takes in parameters supporting std::stringstream conversion and a string
    * prefix and transforms them into format "prefix(arg1,arg2,arg3)\n" e.g.
-   * "chat.post(test)\n)" and sends command to the server.
+   * "chat.post(test)\n)".
    *
    * @tparam Types
    * @param prefix
    * @param args
+   * @return Encoded command ready to be sent
    */
-  template <typename... Types> void send_command(const std::string& prefix, const Types&... args) {
+  template <typename... Types>
+  static std::string encode_command(const std::string& prefix, const Types&... args) {
     std::stringstream ss;
 
     ss << prefix << "(";
@@ -48,7 +52,23 @@ public:
 
     ss << ")\n";
 
-    send(ss.str());
+    return ss.str();
+  }
+
+  /**
+   * Encodes the command via encode_command() and sends it to the server.
+   *
+   * @tparam Types
+   * @param prefix
+   * @param args
+   */
+  template <typename... Types> void send_command(const std::string& prefix, const Types&... args) {
+    TraceSpan encode_span("encode");
+    std::string command = encode_command(prefix, args...);
+    encode_span.set_bytes(static_cast<int64_t>(command.size()));
+    encode_span.end();
+
+    send(command);
   }
 
   /**
@@ -0,0 +1,111 @@
+#include "../include/mcpp/hash_tree.h"
+#include "block_hash.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace mcpp {
+
+namespace {
+int32_t sections_along(int32_t len) {
+  return (len + HashTree::SECTION_LEN - 1) / HashTree::SECTION_LEN;
+}
+} // namespace
+
+HashTree::HashTree(int32_t x_len, int32_t y_len, int32_t z_len)
+    : _x_len(x_len), _y_len(y_len), _z_len(z_len), _sections_x(sections_along(x_len)),
+      _sections_z(sections_along(z_len)) {
+  _section_count = static_cast<size_t>(_sections_x) * sections_along(y_len) * _sections_z;
+  _leaves = 1;
+  while (_leaves < _section_count) {
+    _leaves *= 2;
+  }
+  _nodes.assign(2 * _leaves, 0);
+  _stale.assign((_section_count + 63) / 64, ~uint64_t{0});
+}
+
+Coordinate HashTree::section_offset(size_t section) const {
+  size_t per_layer = static_cast<size_t>(_sections_x) * _sections_z;
+  return Coordinate(static_cast<int>((section % per_layer) / _sections_z) * SECTION_LEN,
+                    static_cast<int>(section / per_layer) * SECTION_LEN,
+                    static_cast<int>(section % _sections_z) * SECTION_LEN);
+}
+
+std::vector<size_t> HashTree::changed_sections(const HashTree& other) const {
+  if (_x_len != other._x_len || _y_len != other._y_len || _z_len != other._z_len) {
+    throw std::invalid_argument("Cannot compare HashTrees over areas of different sizes");
+  }
+  std::vector<size_t> changed;
+  std::vector<size_t> pending{1};
+  while (!pending.empty()) {
+    size_t node = pending.back();
+    pending.pop_back();
+    if (_nodes[node] == other._nodes[node]) {
+      continue;
+    }
+    if (node >= _leaves) {
+      changed.push_back(node - _leaves);
+      continue;
+    }
+    // Right first so that sections come off the stack in increasing order
+    pending.push_back((2 * node) + 1);
+    pending.push_back(2 * node);
+  }
+  return changed;
+}
+
+void HashTree::invalidate(int x, int y, int z) {
+  size_t section = (static_cast<size_t>(y / SECTION_LEN) * _sections_x * _sections_z) +
+                   (static_cast<size_t>(x / SECTION_LEN) * _sections_z) +
+                   static_cast<size_t>(z / SECTION_LEN);
+  _stale[section / 64] |= uint64_t{1} << (section % 64);
+  _any_stale = true;
+}
+
+void HashTree::invalidate_all() {
+  std::fill(_stale.begin(), _stale.end(), ~uint64_t{0});
+  _any_stale = true;
+}
+
+uint64_t HashTree::hash_section(const BlockType* blocks, size_t section) const {
+  Coordinate from = section_offset(section);
+  int x_end = std::min(from.x + SECTION_LEN, _x_len);
+  int y_end = std::min(from.y + SECTION_LEN, _y_len);
+  size_t run = std::min(from.z + SECTION_LEN, _z_len) - from.z;
+  size_t x_stride = _z_len;
+  size_t y_stride = static_cast<size_t>(_x_len) * _z_len;
+
+  hash::Hasher hasher;
+  for (int y = from.y; y < y_end; y++) {
+    for (int x = from.x; x < x_end; x++) {
+      hasher.add(blocks + (y * y_stride) + (x * x_stride) + from.z, run);
+    }
+  }
+  return hasher.finish();
+}
+
+void HashTree::refresh(const BlockType* blocks) {
+  if (!_any_stale) {
+    return;
+  }
+  // Rehash the stale leaves, then their parents a level at a time
+  std::vector<size_t> touched;
+  touched.reserve(_section_count);
+  for (size_t section = 0; section < _section_count; section++) {
+    if (((_stale[section / 64] >> (section % 64)) & 1) != 0) {
+      _nodes[_leaves + section] = hash_section(blocks, section);
+      touched.push_back((_leaves + section) / 2);
+    }
+  }
+  std::fill(_stale.begin(), _stale.end(), 0);
+  while (!touched.empty() && touched.front() != 0) {
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    for (size_t& node : touched) {
+      _nodes[node] = hash::combine(_nodes[2 * node], _nodes[(2 * node) + 1]);
+      node /= 2;
+    }
+  }
+  _any_stale = false;
+}
+
+} // namespace mcpp
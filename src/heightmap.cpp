@@ -1,9 +1,11 @@
 #include "../include/mcpp/heightmap.h"
+#include "instrument.h"
 #include <cstdint>
 
 namespace mcpp {
 HeightMap::HeightMap(const Coordinate2D& loc1, const Coordinate2D& loc2,
                      const std::vector<int16_t>& heights) {
+  MCPP_TRACE_SCOPE("heightmap_construct");
   _base_pt = Coordinate{
       std::min(loc1.x, loc2.x),
       0,
@@ -17,12 +19,31 @@ HeightMap::HeightMap(const Coordinate2D& loc1, const Coordinate2D& loc2,
   std::copy(heights.begin(), heights.end(), _raw_heights.get());
 }
 
+HeightMap::HeightMap(const Coordinate2D& loc1, const Coordinate2D& loc2) {
+  _base_pt = Coordinate2D(std::min(loc1.x, loc2.x), std::min(loc1.z, loc2.z));
+  _x_len = std::abs(loc1.x - loc2.x) + 1;
+  _z_len = std::abs(loc1.z - loc2.z) + 1;
+}
+
+void HeightMap::reshape(const Coordinate2D& loc1, const Coordinate2D& loc2) {
+  size_t old_area = area();
+  _base_pt = Coordinate2D(std::min(loc1.x, loc2.x), std::min(loc1.z, loc2.z));
+  _x_len = std::abs(loc1.x - loc2.x) + 1;
+  _z_len = std::abs(loc1.z - loc2.z) + 1;
+  if (area() != old_area) {
+    _raw_heights = std::make_unique<int16_t[]>(area());
+  }
+}
+
 HeightMap& HeightMap::operator=(const HeightMap& other) {
+  MCPP_TRACE_SCOPE("heightmap_copy_assign");
   if (this != &other) {
     // Copy data from the other object
     _base_pt = other._base_pt;
     _x_len = other._x_len;
     _z_len = other._z_len;
+    _raw_heights = std::make_unique<int16_t[]>(area());
+    std::copy(other._raw_heights.get(), other._raw_heights.get() + area(), _raw_heights.get());
   }
   return *this;
 }
@@ -34,7 +55,7 @@ int16_t HeightMap::get(int x, int z) const {
                             ",z=" + std::to_string(_base_pt.z + z));
   }
   // Get 2D from flat vector
-  return _raw_heights[(x * _z_len) + z];
+  return _raw_heights[(static_cast<size_t>(x) * static_cast<size_t>(_z_len)) + z];
 }
 
 int16_t HeightMap::get_worldspace(const Coordinate2D& loc) const {
@@ -43,9 +64,9 @@ int16_t HeightMap::get_worldspace(const Coordinate2D& loc) const {
 
 void HeightMap::fill_coord(Coordinate& out) const { out.y = get_worldspace(out); }
 
-uint16_t HeightMap::x_len() const { return _x_len; }
+int32_t HeightMap::x_len() const { return _x_len; }
 
-uint16_t HeightMap::z_len() const { return _z_len; }
+int32_t HeightMap::z_len() const { return _z_len; }
 
 Coordinate2D HeightMap::base_pt() const { return _base_pt; }
 } // namespace mcpp
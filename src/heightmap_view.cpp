@@ -0,0 +1,56 @@
+#include "../include/mcpp/heightmap_view.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace mcpp {
+
+HeightMapView::HeightMapView(const HeightMap& heights)
+    : _data(heights.data()), _base_pt(heights.base_pt()), _x_len(heights.x_len()),
+      _z_len(heights.z_len()), _x_stride(heights.x_stride()) {}
+
+int16_t HeightMapView::get(int x, int z) const {
+  if ((x < 0 || x >= _x_len) || (z < 0 || z >= _z_len)) {
+    throw std::out_of_range("Out of range access of heightmap view at " + std::to_string(x) +
+                            "," + std::to_string(z) + " (worldspace x=" +
+                            std::to_string(_base_pt.x + x) + ",z=" +
+                            std::to_string(_base_pt.z + z));
+  }
+  return *at(x, z);
+}
+
+int16_t HeightMapView::get_worldspace(const Coordinate2D& loc) const {
+  return get(loc.x - _base_pt.x, loc.z - _base_pt.z);
+}
+
+void HeightMapView::fill_coord(Coordinate& out) const { out.y = get_worldspace(out); }
+
+HeightMapView HeightMapView::slice(const Coordinate2D& loc1, const Coordinate2D& loc2) const {
+  Coordinate2D min{std::min(loc1.x, loc2.x), std::min(loc1.z, loc2.z)};
+  Coordinate2D max{std::max(loc1.x, loc2.x), std::max(loc1.z, loc2.z)};
+  int lo_x = min.x - _base_pt.x;
+  int lo_z = min.z - _base_pt.z;
+  int hi_x = max.x - _base_pt.x;
+  int hi_z = max.z - _base_pt.z;
+  if (lo_x < 0 || lo_z < 0 || hi_x >= _x_len || hi_z >= _z_len) {
+    throw std::out_of_range("HeightMapView slice x=" + std::to_string(min.x) + "..." +
+                            std::to_string(max.x) + ",z=" + std::to_string(min.z) + "..." +
+                            std::to_string(max.z) + " is not inside the view");
+  }
+  return {at(lo_x, lo_z), min, hi_x - lo_x + 1, hi_z - lo_z + 1, _x_stride};
+}
+
+HeightMap HeightMapView::to_heightmap() const {
+  std::vector<int16_t> heights;
+  heights.reserve(static_cast<size_t>(_x_len) * _z_len);
+  for (int x = 0; x < _x_len; x++) {
+    const int16_t* row = at(x, 0);
+    heights.insert(heights.end(), row, row + _z_len);
+  }
+  Coordinate2D max{_base_pt.x + _x_len - 1, _base_pt.z + _z_len - 1};
+  return HeightMap{_base_pt, max, heights};
+}
+
+} // namespace mcpp
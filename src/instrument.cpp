@@ -0,0 +1,170 @@
+#include "instrument.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace mcpp::instrument {
+namespace {
+/// Buffers of exited threads kept for reuse, each is over a megabyte
+constexpr size_t kSpareBuffers = 4;
+
+std::mutex registry_mutex;
+std::vector<std::shared_ptr<ThreadBuffer>> registry;
+std::vector<std::shared_ptr<ThreadBuffer>> spares;
+
+std::shared_ptr<ThreadBuffer> make_buffer(uint32_t tid) {
+  auto created = std::make_shared<ThreadBuffer>();
+  created->tid = tid;
+  created->records = std::make_unique<ScopeRecord[]>(kRecordCapacity);
+  return created;
+}
+
+// What exited threads recorded, only written with registry_mutex held
+ThreadBuffer& retired() {
+  static const std::shared_ptr<ThreadBuffer> buffer = [] {
+    std::shared_ptr<ThreadBuffer> created = make_buffer(0);
+    created->record_tids = std::make_unique<uint32_t[]>(kRecordCapacity);
+    return created;
+  }();
+  return *buffer;
+}
+
+Stat* find_stat(ThreadBuffer& buffer, const char* name, bool is_counter) {
+  size_t start = (reinterpret_cast<uintptr_t>(name) >> 3) % kStatSlots;
+  for (size_t i = 0; i < kStatSlots; i++) {
+    Stat& stat = buffer.stats[(start + i) % kStatSlots];
+    const char* slot_name = stat.name.load(std::memory_order_relaxed);
+    if (slot_name == name) {
+      return &stat;
+    }
+    if (slot_name == nullptr) {
+      stat.is_counter.store(is_counter, std::memory_order_relaxed);
+      stat.name.store(name, std::memory_order_release);
+      return &stat;
+    }
+  }
+  // Out of slots, drop the sample rather than block
+  return nullptr;
+}
+
+void clear(ThreadBuffer& buffer) {
+  buffer.size.store(0, std::memory_order_relaxed);
+  for (Stat& stat : buffer.stats) {
+    stat.calls.store(0, std::memory_order_relaxed);
+    stat.total.store(0, std::memory_order_relaxed);
+  }
+}
+
+// Moves a buffer's records and stats into retired(), with registry_mutex held
+void merge_into_retired(const ThreadBuffer& buffer) {
+  ThreadBuffer& into = retired();
+  size_t size = buffer.size.load(std::memory_order_relaxed);
+  size_t start = into.size.load(std::memory_order_relaxed);
+  size_t count = std::min(size, kRecordCapacity - start);
+  std::copy(buffer.records.get(), buffer.records.get() + count, into.records.get() + start);
+  std::fill(into.record_tids.get() + start, into.record_tids.get() + start + count, buffer.tid);
+  into.size.store(start + count, std::memory_order_release);
+
+  for (const Stat& stat : buffer.stats) {
+    const char* name = stat.name.load(std::memory_order_relaxed);
+    if (name == nullptr) {
+      continue;
+    }
+    if (Stat* merged = find_stat(into, name, stat.is_counter.load(std::memory_order_relaxed))) {
+      merged->calls.fetch_add(stat.calls.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+      merged->total.fetch_add(stat.total.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+    }
+  }
+}
+
+// Owns a thread's buffer and hands it back when the thread exits
+struct LocalBuffer {
+  std::shared_ptr<ThreadBuffer> buffer;
+
+  LocalBuffer() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    // Readers copy buffers out of the registry under the lock, so a spare
+    // nobody else holds cannot be picked up by one while it is reset
+    auto spare = std::find_if(spares.begin(), spares.end(),
+                              [](const auto& candidate) { return candidate.use_count() == 1; });
+    if (spare != spares.end()) {
+      buffer = std::move(*spare);
+      spares.erase(spare);
+      clear(*buffer);
+      for (Stat& stat : buffer->stats) {
+        stat.name.store(nullptr, std::memory_order_relaxed);
+      }
+      buffer->tid = trace_thread_id();
+    } else {
+      buffer = make_buffer(trace_thread_id());
+    }
+    registry.push_back(buffer);
+  }
+
+  ~LocalBuffer() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    merge_into_retired(*buffer);
+    registry.erase(std::find(registry.begin(), registry.end(), buffer));
+    if (spares.size() < kSpareBuffers) {
+      spares.push_back(std::move(buffer));
+    }
+  }
+
+  LocalBuffer(const LocalBuffer&) = delete;
+  LocalBuffer& operator=(const LocalBuffer&) = delete;
+};
+
+// Registration takes the lock once per thread, recording never does
+ThreadBuffer& local_buffer() {
+  thread_local LocalBuffer local;
+  return *local.buffer;
+}
+} // namespace
+
+void record_scope(const char* name, int64_t start_ns, int64_t end_ns) {
+  ThreadBuffer& buffer = local_buffer();
+
+  size_t size = buffer.size.load(std::memory_order_relaxed);
+  if (size < kRecordCapacity) {
+    buffer.records[size] = {name, start_ns, end_ns};
+    buffer.size.store(size + 1, std::memory_order_release);
+  }
+
+  if (Stat* stat = find_stat(buffer, name, false)) {
+    stat->calls.fetch_add(1, std::memory_order_relaxed);
+    stat->total.fetch_add(static_cast<uint64_t>(end_ns - start_ns), std::memory_order_relaxed);
+  }
+}
+
+void add_count(const char* name, uint64_t n) {
+  if (Stat* stat = find_stat(local_buffer(), name, true)) {
+    stat->calls.fetch_add(1, std::memory_order_relaxed);
+    stat->total.fetch_add(n, std::memory_order_relaxed);
+  }
+}
+
+void for_each_buffer(const std::function<void(const ThreadBuffer&)>& visit) {
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    buffers = registry;
+  }
+  for (const auto& buffer : buffers) {
+    visit(*buffer);
+  }
+  // Written by exiting threads with the lock held, but like any buffer its
+  // published records are never modified again
+  visit(retired());
+}
+
+void reset() {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  for (const auto& buffer : registry) {
+    clear(*buffer);
+  }
+  clear(retired());
+}
+} // namespace mcpp::instrument
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "trace_span.h"
+
+/** @file
+ * @brief Compile-time instrumentation macros.
+ *
+ * MCPP_TRACE_SCOPE(name) times the enclosing scope and MCPP_TRACE_COUNT(name, n)
+ * adds n to a named counter. Both expand to nothing unless the library is
+ * configured with -DMCPP_INSTRUMENTATION=ON. When enabled, every thread
+ * records into its own buffer, so recording never takes a lock.
+ *
+ * Names must be string literals as only the pointer is stored.
+ */
+
+#define MCPP_CONCAT_IMPL(a, b) a##b
+#define MCPP_CONCAT(a, b) MCPP_CONCAT_IMPL(a, b)
+
+#ifdef MCPP_INSTRUMENTATION
+#define MCPP_TRACE_SCOPE(name)                                                                     \
+  ::mcpp::instrument::ScopedTimer MCPP_CONCAT(mcpp_trace_scope_, __LINE__)(name)
+#define MCPP_TRACE_COUNT(name, n) ::mcpp::instrument::add_count(name, static_cast<uint64_t>(n))
+#else
+#define MCPP_TRACE_SCOPE(name) static_cast<void>(0)
+#define MCPP_TRACE_COUNT(name, n) static_cast<void>(0)
+#endif
+
+namespace mcpp::instrument {
+/// Maximum number of timed scopes kept per thread for trace export.
+constexpr size_t kRecordCapacity = 1 << 16;
+/// Maximum number of distinct scope/counter names per thread.
+constexpr size_t kStatSlots = 64;
+
+struct ScopeRecord {
+  const char* name;
+  int64_t start_ns;
+  int64_t end_ns;
+};
+
+/**
+ * Aggregated statistic for one name on one thread. Only the owning thread
+ * writes to it, other threads may read it at any time.
+ */
+struct Stat {
+  std::atomic<const char*> name{nullptr};
+  std::atomic<bool> is_counter{false};
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> total{0};
+};
+
+/**
+ * Per-thread recording buffer. Records below the published size are never
+ * modified again, which lets readers walk them without synchronising with
+ * the writer. Once full, further scopes only update the aggregated stats.
+ *
+ * When a thread exits its records and stats are merged into a single buffer
+ * for exited threads and its own buffer is recycled for a later thread, so
+ * thread churn does not grow memory.
+ */
+struct ThreadBuffer {
+  uint32_t tid;
+  std::unique_ptr<ScopeRecord[]> records;
+  /// Thread of each record, only for the buffer of exited threads, which
+  /// holds records from many
+  std::unique_ptr<uint32_t[]> record_tids;
+  std::atomic<size_t> size{0};
+  Stat stats[kStatSlots];
+
+  uint32_t record_tid(size_t i) const { return record_tids ? record_tids[i] : tid; }
+};
+
+void record_scope(const char* name, int64_t start_ns, int64_t end_ns);
+
+void add_count(const char* name, uint64_t n);
+
+/**
+ * Calls visit for the buffer of every running thread that has recorded, and
+ * for the buffer holding what exited threads recorded.
+ */
+void for_each_buffer(const std::function<void(const ThreadBuffer&)>& visit);
+
+/**
+ * Discards all recorded scopes and statistics. Must not race with recording
+ * threads.
+ */
+void reset();
+
+class ScopedTimer {
+private:
+  const char* _name;
+  int64_t _start_ns;
+
+public:
+  explicit ScopedTimer(const char* name) : _name(name), _start_ns(TraceSpan::now_ns()) {}
+  ~ScopedTimer() { record_scope(_name, _start_ns, TraceSpan::now_ns()); }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+} // namespace mcpp::instrument
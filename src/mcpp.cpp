@@ -1,15 +1,93 @@
+#include <algorithm>
 #include <cmath>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "../include/mcpp/mcpp.h"
 #include "connection.h"
+#include "instrument.h"
+#include "trace_span.h"
+#include "shadow_state.h"
 #include "util.h"
+#include "world_cache.h"
 
 using namespace std::string_literals;
 
 namespace mcpp {
 
+namespace {
+Chunk fetch_blocks(SocketConnection& conn, const Coordinate& loc1, const Coordinate& loc2) {
+  std::string response = conn.send_receive_command("world.getBlocksWithData", loc1.x, loc1.y,
+                                                   loc1.z, loc2.x, loc2.y, loc2.z);
+
+  // Parsed straight into the chunk's storage, which is handed over without a copy
+  TraceSpan parse_span("parse");
+  size_t volume = static_cast<size_t>(std::abs(loc1.x - loc2.x) + 1) *
+                  static_cast<size_t>(std::abs(loc1.y - loc2.y) + 1) *
+                  static_cast<size_t>(std::abs(loc1.z - loc2.z) + 1);
+  auto blocks = std::make_unique<BlockType[]>(volume);
+  {
+    MCPP_TRACE_SCOPE("parse_blocks");
+    parse_blocks(response, blocks.get(), volume);
+  }
+  parse_span.end();
+
+  return Chunk{loc1, loc2, std::move(blocks)};
+}
+
+BlockType load_block(SocketConnection& conn, WorldCache* cache, const Coordinate& loc) {
+  if (cache == nullptr) {
+    std::string return_str =
+        conn.send_receive_command("world.getBlockWithData", loc.x, loc.y, loc.z);
+    std::vector<uint8_t> parsed;
+    {
+      MCPP_TRACE_SCOPE("split_response");
+      split_response(return_str, parsed);
+    }
+
+    // Values are id and mod
+    return {parsed[0], parsed[1]};
+  }
+
+  if (std::optional<BlockType> cached = cache->get(loc)) {
+    return *cached;
+  }
+  // Fetch the whole section so that neighbouring lookups hit
+  Coordinate origin = WorldCache::section_origin(loc);
+  Coordinate last = origin + Coordinate(WorldCache::SECTION_LEN - 1, WorldCache::SECTION_LEN - 1,
+                                        WorldCache::SECTION_LEN - 1);
+  Chunk section = fetch_blocks(conn, origin, last);
+  cache->insert(section);
+  return section.get_worldspace(loc);
+}
+
+Chunk load_blocks(SocketConnection& conn, WorldCache* cache, const Coordinate& loc1,
+                  const Coordinate& loc2) {
+  MCPP_TRACE_SCOPE("load_blocks");
+  Coordinate min{std::min(loc1.x, loc2.x), std::min(loc1.y, loc2.y), std::min(loc1.z, loc2.z)};
+  Coordinate max{std::max(loc1.x, loc2.x), std::max(loc1.y, loc2.y), std::max(loc1.z, loc2.z)};
+  if (cache == nullptr || !cache->fits(min, max)) {
+    return fetch_blocks(conn, loc1, loc2);
+  }
+
+  std::vector<Coordinate> missing = cache->missing(min, max);
+  if (!missing.empty()) {
+    // One round trip for the bounding box of the missing sections
+    Coordinate lo = missing.front();
+    Coordinate hi = missing.front();
+    for (const Coordinate& origin : missing) {
+      lo = {std::min(lo.x, origin.x), std::min(lo.y, origin.y), std::min(lo.z, origin.z)};
+      hi = {std::max(hi.x, origin.x), std::max(hi.y, origin.y), std::max(hi.z, origin.z)};
+    }
+    const int last = WorldCache::SECTION_LEN - 1;
+    cache->insert(fetch_blocks(conn, lo, hi + Coordinate(last, last, last)));
+  }
+  return cache->read(min, max);
+}
+} // namespace
+
 MinecraftConnection::MinecraftConnection(const std::string& address, uint16_t port) {
   _conn = std::make_unique<SocketConnection>(address, port);
 }
@@ -31,7 +109,10 @@ void MinecraftConnection::setPlayerPosition(const Coordinate& pos) {
 Coordinate MinecraftConnection::getPlayerPosition() const {
   std::string response = _conn->send_receive_command("player.getPos", "");
   std::vector<int32_t> parsed;
-  split_response(response, parsed);
+  {
+    MCPP_TRACE_SCOPE("split_response");
+    split_response(response, parsed);
+  }
   return {parsed[0], parsed[1], parsed[2]};
 }
 
@@ -48,64 +129,99 @@ Coordinate MinecraftConnection::getPlayerTilePosition() const {
 }
 
 void MinecraftConnection::setBlock(const Coordinate& loc, const BlockType& block_type) {
+  if (_shadow && _shadow->get(loc) == block_type) {
+    _elided_writes++;
+    return;
+  }
   // Static cast required because of stupid ss default of uint8_t as char
   _conn->send_command("world.setBlock", loc.x, loc.y, loc.z, static_cast<int>(block_type.id),
                       static_cast<int>(block_type.mod));
+  if (_cache) {
+    _cache->write(loc, block_type);
+  }
+  if (_shadow) {
+    _shadow->write(loc, block_type);
+  }
 }
 
 void MinecraftConnection::setBlocks(const Coordinate& loc1, const Coordinate& loc2,
                                     const BlockType& block_type) {
+  MCPP_TRACE_SCOPE("setBlocks");
   auto [x1, y1, z1] = loc1;
   auto [x2, y2, z2] = loc2;
+  Coordinate min{std::min(x1, x2), std::min(y1, y2), std::min(z1, z2)};
+  Coordinate max{std::max(x1, x2), std::max(y1, y2), std::max(z1, z2)};
+  if (_shadow && _shadow->matches(min, max, block_type)) {
+    _elided_writes++;
+    return;
+  }
   _conn->send_command("world.setBlocks", x1, y1, z1, x2, y2, z2, static_cast<int>(block_type.id),
                       static_cast<int>(block_type.mod));
+  if (_cache) {
+    _cache->fill(min, max, block_type);
+  }
+  if (_shadow) {
+    _shadow->fill(min, max, block_type);
+  }
 }
 
 BlockType MinecraftConnection::getBlock(const Coordinate& loc) const {
-  std::string return_str =
-      _conn->send_receive_command("world.getBlockWithData", loc.x, loc.y, loc.z);
-  std::vector<uint8_t> parsed;
-  split_response(return_str, parsed);
-
-  // Values are id and mod
-  return {parsed[0], parsed[1]};
+  BlockType block = load_block(*_conn, _cache.get(), loc);
+  if (_shadow) {
+    _shadow->observe(loc, block);
+  }
+  return block;
 }
 
 Chunk MinecraftConnection::getBlocks(const Coordinate& loc1, const Coordinate& loc2) const {
-  std::string response = _conn->send_receive_command("world.getBlocksWithData", loc1.x, loc1.y,
-                                                     loc1.z, loc2.x, loc2.y, loc2.z);
-
-  // Received in format 1,2;1,2;1,2 where 1,2 is a block of type 1 and mod 2
-  std::vector<BlockType> result;
-  std::stringstream stream(response);
-
-  // uint16_t because stupid << is overloaded to read first character instead
-  // of number for uint8_t raaaa
-  // This shouldn't return anything larger than a uint8_t anyway
-  uint16_t id;
-  uint16_t mod;
-  char delimiter;
-  while (stream >> id) {
-    stream >> delimiter;
-    if (delimiter == ',') {
-      stream >> mod;
-      result.emplace_back(id, mod);
-      stream >> delimiter;
-    }
-    if (delimiter == ';') {
-      continue;
-    }
-    if (delimiter == EOF) {
-      break;
-    }
+  TraceSpan span("getBlocks");
+  MCPP_TRACE_SCOPE("getBlocks");
+  Chunk chunk = load_blocks(*_conn, _cache.get(), loc1, loc2);
+  if (_shadow) {
+    _shadow->observe(chunk);
   }
+  return chunk;
+}
+
+void MinecraftConnection::getBlocksInto(const Coordinate& loc1, const Coordinate& loc2,
+                                        Chunk& out) const {
+  out.reshape(loc1, loc2);
+  load_blocks_into(loc1, loc2, out.data(), out.size());
+}
 
-  return Chunk{loc1, loc2, result};
+void MinecraftConnection::load_blocks_into(const Coordinate& loc1, const Coordinate& loc2,
+                                           BlockType* out, size_t n) const {
+  TraceSpan span("getBlocks");
+  MCPP_TRACE_SCOPE("load_blocks_into");
+  if (_cache) {
+    const Chunk chunk = load_blocks(*_conn, _cache.get(), loc1, loc2);
+    std::copy(chunk.begin(), chunk.end(), out);
+  } else {
+    std::string response = _conn->send_receive_command("world.getBlocksWithData", loc1.x, loc1.y,
+                                                       loc1.z, loc2.x, loc2.y, loc2.z);
+    TraceSpan parse_span("parse");
+    MCPP_TRACE_SCOPE("parse_blocks");
+    parse_blocks(response, out, n);
+  }
+  if (_shadow) {
+    Coordinate min{std::min(loc1.x, loc2.x), std::min(loc1.y, loc2.y), std::min(loc1.z, loc2.z)};
+    _shadow->observe(ChunkView(out, min, std::abs(loc1.x - loc2.x) + 1,
+                               std::abs(loc1.y - loc2.y) + 1, std::abs(loc1.z - loc2.z) + 1));
+  }
 }
 
 int MinecraftConnection::getHeight(Coordinate2D loc) const {
+  if (_shadow) {
+    if (std::optional<int32_t> height = _shadow->height(loc)) {
+      return *height;
+    }
+  }
   std::string response = _conn->send_receive_command("world.getHeight", loc.x, loc.z);
-  return stoi(response);
+  int height = stoi(response);
+  if (_shadow) {
+    _shadow->observe_height(loc, height);
+  }
+  return height;
 }
 
 Coordinate MinecraftConnection::fillHeight(Coordinate2D loc) const {
@@ -115,14 +231,86 @@ Coordinate MinecraftConnection::fillHeight(Coordinate2D loc) const {
 
 HeightMap MinecraftConnection::getHeights(const Coordinate2D& loc1,
                                           const Coordinate2D& loc2) const {
+  TraceSpan span("getHeights");
+  MCPP_TRACE_SCOPE("getHeights");
+  if (_shadow) {
+    if (std::optional<HeightMap> known = _shadow->heights(loc1, loc2)) {
+      return std::move(*known);
+    }
+  }
   std::string response =
       _conn->send_receive_command("world.getHeights", loc1.x, loc1.z, loc2.x, loc2.z);
 
+  TraceSpan parse_span("parse");
   // Returned in format "1,2,3,4,5"
-  std::vector<int16_t> parsed;
-  split_response(response, parsed);
+  size_t area = static_cast<size_t>(std::abs(loc1.x - loc2.x) + 1) *
+                static_cast<size_t>(std::abs(loc1.z - loc2.z) + 1);
+  auto parsed = std::make_unique<int16_t[]>(area);
+  {
+    MCPP_TRACE_SCOPE("split_response");
+    split_response(response, parsed.get(), area);
+  }
+  parse_span.end();
 
-  return HeightMap{loc1, loc2, parsed};
+  HeightMap heights{loc1, loc2, std::move(parsed)};
+  if (_shadow) {
+    _shadow->observe(heights);
+  }
+  return heights;
 }
 
+void MinecraftConnection::getHeightsInto(const Coordinate2D& loc1, const Coordinate2D& loc2,
+                                         HeightMap& out) const {
+  TraceSpan span("getHeights");
+  MCPP_TRACE_SCOPE("getHeights");
+  if (_shadow) {
+    if (std::optional<HeightMap> known = _shadow->heights(loc1, loc2)) {
+      out = std::move(*known);
+      return;
+    }
+  }
+  std::string response =
+      _conn->send_receive_command("world.getHeights", loc1.x, loc1.z, loc2.x, loc2.z);
+
+  TraceSpan parse_span("parse");
+  out.reshape(loc1, loc2);
+  {
+    MCPP_TRACE_SCOPE("split_response");
+    split_response(response, out.data(), out.size());
+  }
+  parse_span.end();
+
+  if (_shadow) {
+    _shadow->observe(out);
+  }
+}
+
+void MinecraftConnection::enableCache(const CacheOptions& options) {
+  _cache = std::make_unique<WorldCache>(options);
+}
+
+void MinecraftConnection::disableCache() { _cache.reset(); }
+
+void MinecraftConnection::clearCache() {
+  if (_cache) {
+    _cache->clear();
+  }
+}
+
+CacheStats MinecraftConnection::cacheStats() const {
+  return _cache ? _cache->stats() : CacheStats{};
+}
+
+void MinecraftConnection::enableShadowState() { _shadow = std::make_unique<ShadowState>(); }
+
+void MinecraftConnection::disableShadowState() { _shadow.reset(); }
+
+void MinecraftConnection::clearShadowState() {
+  if (_shadow) {
+    _shadow->clear();
+  }
+}
+
+uint64_t MinecraftConnection::elidedWrites() const { return _elided_writes; }
+
 } // namespace mcpp
@@ -0,0 +1,116 @@
+#include "../include/mcpp/octree.h"
+
+#include <stdexcept>
+
+namespace mcpp {
+
+namespace {
+// Inline comparison, BlockType::operator== is not visible to the optimiser
+bool same(const BlockType& a, const BlockType& b) { return a.id == b.id && a.mod == b.mod; }
+} // namespace
+
+Octree::Octree(const Chunk& chunk)
+    : _base_pt(chunk.base_pt()), _x_len(chunk.x_len()), _y_len(chunk.y_len()),
+      _z_len(chunk.z_len()), _size(1) {
+  int longest = std::max({_x_len, _y_len, _z_len});
+  while (_size < longest) {
+    _size *= 2;
+  }
+  // Root first so that a child index of 0 can mark leaves
+  _nodes.emplace_back();
+  Node root = build(chunk, Coordinate(0, 0, 0), _size);
+  _nodes[0] = root;
+}
+
+Octree::Node Octree::build(const Chunk& chunk, const Coordinate& origin, int size) {
+  // Padding outside the chunk's area is air
+  if (origin.x >= _x_len || origin.y >= _y_len || origin.z >= _z_len) {
+    return {Blocks::AIR, 0};
+  }
+  const BlockType* data = chunk.data();
+  auto block_at = [&](const Coordinate& pos) {
+    if (pos.x >= _x_len || pos.y >= _y_len || pos.z >= _z_len) {
+      return Blocks::AIR;
+    }
+    return data[(static_cast<size_t>(pos.y) * _x_len * _z_len) +
+                (static_cast<size_t>(pos.x) * _z_len) + pos.z];
+  };
+  if (size == 1) {
+    return {block_at(origin), 0};
+  }
+
+  auto first = static_cast<uint32_t>(_nodes.size());
+  int half = size / 2;
+  if (size == 2) {
+    // Lowest level inline, only appended when the eight blocks differ
+    Node children[8];
+    bool uniform = true;
+    for (int i = 0; i < 8; i++) {
+      children[i] = {block_at(child_origin(origin, 1, i)), 0};
+      uniform = uniform && same(children[i].value, children[0].value);
+    }
+    if (uniform) {
+      return children[0];
+    }
+    _nodes.insert(_nodes.end(), children, children + 8);
+    return {BlockType(), first};
+  }
+
+  _nodes.resize(first + 8);
+  bool uniform = true;
+  for (int i = 0; i < 8; i++) {
+    // Building the child may grow _nodes, assign through the index after
+    Node child = build(chunk, child_origin(origin, half, i), half);
+    _nodes[first + i] = child;
+    uniform = uniform && child.children == 0 && same(child.value, _nodes[first].value);
+  }
+  if (uniform) {
+    BlockType value = _nodes[first].value;
+    _nodes.resize(first);
+    return {value, 0};
+  }
+  return {BlockType(), first};
+}
+
+BlockType Octree::get(int x, int y, int z) const {
+  if ((x < 0 || y < 0 || z < 0) || (x > _x_len - 1 || y > _y_len - 1 || z > _z_len - 1)) {
+    throw std::out_of_range("Out of bounds Octree access at " + to_string(Coordinate(x, y, z)));
+  }
+  const Node* node = &_nodes[0];
+  int size = _size;
+  while (node->children != 0) {
+    size /= 2;
+    int i = ((y & size) != 0 ? 4 : 0) | ((x & size) != 0 ? 2 : 0) | ((z & size) != 0 ? 1 : 0);
+    node = &_nodes[node->children + i];
+  }
+  return node->value;
+}
+
+BlockType Octree::get_worldspace(const Coordinate& pos) const {
+  Coordinate array_pos = pos - _base_pt;
+  if ((array_pos.x < 0 || array_pos.y < 0 || array_pos.z < 0) ||
+      (array_pos.x > _x_len - 1 || array_pos.y > _y_len - 1 || array_pos.z > _z_len - 1)) {
+    throw std::out_of_range("Out of bounds Octree access at " + to_string(array_pos) +
+                            " (world coordinate " + to_string(pos) + " )");
+  }
+  return get(array_pos.x, array_pos.y, array_pos.z);
+}
+
+Chunk Octree::to_chunk() const {
+  size_t x_len = _x_len;
+  size_t z_len = _z_len;
+  std::vector<BlockType> blocks(x_len * _y_len * z_len, Blocks::AIR);
+  // Non-air leaves never reach into the padding, so no clipping is needed
+  for_each_leaf([&](const Coordinate& origin, int size, BlockType block) {
+    Coordinate local = origin - _base_pt;
+    for (int y = local.y; y < local.y + size; y++) {
+      for (int x = local.x; x < local.x + size; x++) {
+        auto row = blocks.begin() + (y * x_len * z_len) + (x * z_len) + local.z;
+        std::fill(row, row + size, block);
+      }
+    }
+  });
+  return Chunk{_base_pt, _base_pt + Coordinate(_x_len - 1, _y_len - 1, _z_len - 1), blocks};
+}
+
+} // namespace mcpp
@@ -0,0 +1,192 @@
+#include "../include/mcpp/paletted_chunk.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace mcpp {
+
+namespace {
+constexpr int LEN = PalettedChunk::SECTION_LEN;
+
+uint8_t bits_for(size_t palette_size) {
+  if (palette_size <= 1) {
+    return 0;
+  }
+  uint8_t bits = 4;
+  while (bits < 8 && (size_t{1} << bits) < palette_size) {
+    bits++;
+  }
+  return palette_size <= 256 ? bits : 16;
+}
+
+uint16_t direct_value(const BlockType& block) {
+  return static_cast<uint16_t>((block.id << 8) | block.mod);
+}
+} // namespace
+
+PalettedChunk::PalettedChunk(const Chunk& chunk)
+    : _base_pt(chunk.base_pt()), _x_len(chunk.x_len()), _y_len(chunk.y_len()),
+      _z_len(chunk.z_len()), _sections_x((_x_len + LEN - 1) / LEN),
+      _sections_z((_z_len + LEN - 1) / LEN) {
+  int sections_y = (_y_len + LEN - 1) / LEN;
+  _sections.resize(static_cast<size_t>(sections_y) * _sections_x * _sections_z);
+
+  // Palette slot of every BlockType in the current section, valid when the
+  // stamp matches so the table does not need clearing between sections
+  std::vector<uint32_t> stamp(1 << 16, 0);
+  std::vector<uint16_t> slot(1 << 16);
+  std::vector<uint16_t> indices;
+  const BlockType* data = chunk.data();
+  uint32_t generation = 0;
+
+  for (int sy = 0; sy < sections_y; sy++) {
+    for (int sx = 0; sx < _sections_x; sx++) {
+      for (int sz = 0; sz < _sections_z; sz++) {
+        Section& section = _sections[(sy * _sections_x * _sections_z) + (sx * _sections_z) + sz];
+        section.x_len = static_cast<uint8_t>(std::min(LEN, _x_len - sx * LEN));
+        section.y_len = static_cast<uint8_t>(std::min(LEN, _y_len - sy * LEN));
+        section.z_len = static_cast<uint8_t>(std::min(LEN, _z_len - sz * LEN));
+        generation++;
+
+        indices.clear();
+        for (int y = 0; y < section.y_len; y++) {
+          for (int x = 0; x < section.x_len; x++) {
+            const BlockType* row = data + (static_cast<size_t>(sy * LEN + y) * _x_len * _z_len) +
+                                   (static_cast<size_t>(sx * LEN + x) * _z_len) + (sz * LEN);
+            for (int z = 0; z < section.z_len; z++) {
+              uint16_t key = direct_value(row[z]);
+              if (stamp[key] != generation) {
+                stamp[key] = generation;
+                slot[key] = static_cast<uint16_t>(section.palette.size());
+                section.palette.push_back(row[z]);
+              }
+              indices.push_back(slot[key]);
+            }
+          }
+        }
+
+        section.bits = bits_for(section.palette.size());
+        if (section.bits == 0) {
+          continue;
+        }
+        if (section.bits == 16) {
+          // Too many distinct blocks for a palette to pay off
+          for (uint16_t& index : indices) {
+            index = direct_value(section.palette[index]);
+          }
+          section.palette.clear();
+          section.palette.shrink_to_fit();
+        }
+        section.per_word = static_cast<uint8_t>(64 / section.bits);
+        section.div_magic = static_cast<uint32_t>(((uint64_t{1} << 32) + section.per_word - 1) /
+                                                  section.per_word);
+        size_t per_word = section.per_word;
+        section.data.assign((indices.size() + per_word - 1) / per_word, 0);
+        for (size_t i = 0; i < indices.size(); i++) {
+          section.data[i / per_word] |= static_cast<uint64_t>(indices[i])
+                                        << ((i % per_word) * section.bits);
+        }
+      }
+    }
+  }
+}
+
+BlockType PalettedChunk::get_unchecked(int x, int y, int z) const {
+  const Section& section = _sections[((y / LEN) * _sections_x * _sections_z) +
+                                     ((x / LEN) * _sections_z) + (z / LEN)];
+  if (section.bits == 0) {
+    return section.palette[0];
+  }
+  size_t i = ((y % LEN) * section.x_len * section.z_len) + ((x % LEN) * section.z_len) + (z % LEN);
+  // Division by the runtime index count per word through a reciprocal
+  size_t word = (i * section.div_magic) >> 32;
+  size_t slot = i - word * section.per_word;
+  uint64_t mask = (uint64_t{1} << section.bits) - 1;
+  auto value = static_cast<uint16_t>((section.data[word] >> (slot * section.bits)) & mask);
+  if (section.bits == 16) {
+    return {static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value & 0xff)};
+  }
+  return section.palette[value];
+}
+
+BlockType PalettedChunk::get(int x, int y, int z) const {
+  if ((x < 0 || y < 0 || z < 0) || (x > _x_len - 1 || y > _y_len - 1 || z > _z_len - 1)) {
+    throw std::out_of_range("Out of bounds PalettedChunk access at " +
+                            to_string(Coordinate(x, y, z)));
+  }
+  return get_unchecked(x, y, z);
+}
+
+BlockType PalettedChunk::get_worldspace(const Coordinate& pos) const {
+  Coordinate array_pos = pos - _base_pt;
+  if ((array_pos.x < 0 || array_pos.y < 0 || array_pos.z < 0) ||
+      (array_pos.x > _x_len - 1 || array_pos.y > _y_len - 1 || array_pos.z > _z_len - 1)) {
+    throw std::out_of_range("Out of bounds PalettedChunk access at " + to_string(array_pos) +
+                            " (world coordinate " + to_string(pos) + " )");
+  }
+  return get_unchecked(array_pos.x, array_pos.y, array_pos.z);
+}
+
+void PalettedChunk::ConstIterator::locate() {
+  _section = &_chunk->_sections[((_y / LEN) * _chunk->_sections_x * _chunk->_sections_z) +
+                                ((_x / LEN) * _chunk->_sections_z) + (_z / LEN)];
+  if (_section->bits != 0) {
+    size_t i = ((_y % LEN) * _section->x_len * _section->z_len) + ((_x % LEN) * _section->z_len) +
+               (_z % LEN);
+    _word = i / _section->per_word;
+    _slot = i % _section->per_word;
+  }
+}
+
+Chunk PalettedChunk::to_chunk() const {
+  std::vector<BlockType> blocks(static_cast<size_t>(_x_len) * _y_len * _z_len);
+  BlockType decoded[LEN * LEN * LEN];
+  int sections_y = (_y_len + LEN - 1) / LEN;
+
+  for (int sy = 0; sy < sections_y; sy++) {
+    for (int sx = 0; sx < _sections_x; sx++) {
+      for (int sz = 0; sz < _sections_z; sz++) {
+        const Section& section =
+            _sections[(sy * _sections_x * _sections_z) + (sx * _sections_z) + sz];
+        size_t count = static_cast<size_t>(section.x_len) * section.y_len * section.z_len;
+
+        // Unpack sequentially, then copy rows into place
+        if (section.bits == 0) {
+          std::fill(decoded, decoded + count, section.palette[0]);
+        } else {
+          uint64_t mask = (uint64_t{1} << section.bits) - 1;
+          size_t i = 0;
+          for (uint64_t word : section.data) {
+            for (int slot = 0; slot < section.per_word && i < count; slot++, i++) {
+              auto value = static_cast<uint16_t>(word & mask);
+              word >>= section.bits;
+              decoded[i] = section.bits == 16 ? BlockType(value >> 8, value & 0xff)
+                                              : section.palette[value];
+            }
+          }
+        }
+        const BlockType* in = decoded;
+        for (int y = 0; y < section.y_len; y++) {
+          for (int x = 0; x < section.x_len; x++) {
+            size_t out = (static_cast<size_t>(sy * LEN + y) * _x_len * _z_len) +
+                         (static_cast<size_t>(sx * LEN + x) * _z_len) + (sz * LEN);
+            std::copy(in, in + section.z_len, blocks.begin() + out);
+            in += section.z_len;
+          }
+        }
+      }
+    }
+  }
+  return Chunk{_base_pt, _base_pt + Coordinate(_x_len - 1, _y_len - 1, _z_len - 1), blocks};
+}
+
+size_t PalettedChunk::memory_usage() const {
+  size_t bytes = _sections.capacity() * sizeof(Section);
+  for (const Section& section : _sections) {
+    bytes += section.palette.capacity() * sizeof(BlockType);
+    bytes += section.data.capacity() * sizeof(uint64_t);
+  }
+  return bytes;
+}
+
+} // namespace mcpp
@@ -0,0 +1,236 @@
+#include "shadow_state.h"
+#include "world_cache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace mcpp {
+
+namespace {
+constexpr int LEN = WorldCache::SECTION_LEN;
+
+size_t index(const Coordinate& offset) {
+  return (offset.y * LEN * LEN) + (offset.x * LEN) + offset.z;
+}
+
+bool is_air(const BlockType& block) { return block.id == Blocks::AIR.id; }
+} // namespace
+
+template <typename Fn>
+void ShadowState::for_each_section(const Coordinate& min, const Coordinate& max, Fn fn) {
+  Coordinate lo = WorldCache::section_origin(min);
+  Coordinate hi = WorldCache::section_origin(max);
+  for (auto& [origin, section] : _sections) {
+    if (origin.x >= lo.x && origin.x <= hi.x && origin.y >= lo.y && origin.y <= hi.y &&
+        origin.z >= lo.z && origin.z <= hi.z) {
+      fn(origin, section);
+    }
+  }
+}
+
+std::optional<BlockType> ShadowState::get(const Coordinate& loc) const {
+  Coordinate origin = WorldCache::section_origin(loc);
+  auto it = _sections.find(origin);
+  if (it == _sections.end()) {
+    return std::nullopt;
+  }
+  size_t i = index(loc - origin);
+  if (!it->second.known[i]) {
+    return std::nullopt;
+  }
+  return it->second.blocks[i];
+}
+
+bool ShadowState::matches(const Coordinate& min, const Coordinate& max,
+                          const BlockType& block) const {
+  for (int y = min.y; y <= max.y; y++) {
+    for (int x = min.x; x <= max.x; x++) {
+      // Check the row a section at a time
+      for (int z = min.z; z <= max.z;) {
+        Coordinate loc(x, y, z);
+        Coordinate origin = WorldCache::section_origin(loc);
+        int run = std::min(max.z, origin.z + LEN - 1) - z + 1;
+        auto it = _sections.find(origin);
+        if (it == _sections.end()) {
+          return false;
+        }
+        size_t start = index(loc - origin);
+        for (size_t i = start; i < start + run; i++) {
+          if (!it->second.known[i] || it->second.blocks[i] != block) {
+            return false;
+          }
+        }
+        z += run;
+      }
+    }
+  }
+  return true;
+}
+
+void ShadowState::set(const Coordinate& loc, const BlockType& block) {
+  Coordinate origin = WorldCache::section_origin(loc);
+  Section& section = _sections[origin];
+  size_t i = index(loc - origin);
+  section.blocks[i] = block;
+  section.known.set(i);
+}
+
+void ShadowState::observe(const Coordinate& loc, const BlockType& block) { set(loc, block); }
+
+void ShadowState::observe(const ChunkView& chunk) {
+  if (static_cast<size_t>(chunk.x_len()) * chunk.y_len() * chunk.z_len() > MAX_RECORDED_VOLUME) {
+    return;
+  }
+  Coordinate base = chunk.base_pt();
+  auto in = chunk.begin();
+  for (int y = 0; y < chunk.y_len(); y++) {
+    for (int x = 0; x < chunk.x_len(); x++) {
+      for (int z = 0; z < chunk.z_len();) {
+        Coordinate loc = base + Coordinate(x, y, z);
+        Coordinate origin = WorldCache::section_origin(loc);
+        int run = std::min<int>(chunk.z_len() - z, origin.z + LEN - loc.z);
+        Section& section = _sections[origin];
+        size_t start = index(loc - origin);
+        for (size_t i = start; i < start + run; i++, ++in) {
+          section.blocks[i] = *in;
+          section.known.set(i);
+        }
+        z += run;
+      }
+    }
+  }
+}
+
+void ShadowState::observe_height(const Coordinate2D& loc, int32_t height) {
+  _heights[loc] = height;
+}
+
+void ShadowState::observe(const HeightMap& heights) {
+  Coordinate2D base = heights.base_pt();
+  for (int x = 0; x < heights.x_len(); x++) {
+    for (int z = 0; z < heights.z_len(); z++) {
+      _heights[Coordinate2D(base.x + x, base.z + z)] = heights(x, z);
+    }
+  }
+}
+
+void ShadowState::write(const Coordinate& loc, const BlockType& block) {
+  set(loc, block);
+  update_height(loc.x, loc.z, loc.y, loc.y, block);
+}
+
+void ShadowState::fill(const Coordinate& min, const Coordinate& max, const BlockType& block) {
+  Coordinate dim = max - min + Coordinate(1, 1, 1);
+  size_t volume = static_cast<size_t>(dim.x) * dim.y * dim.z;
+  if (volume <= MAX_RECORDED_VOLUME) {
+    for (int y = min.y; y <= max.y; y++) {
+      for (int x = min.x; x <= max.x; x++) {
+        for (int z = min.z; z <= max.z;) {
+          Coordinate loc(x, y, z);
+          Coordinate origin = WorldCache::section_origin(loc);
+          int run = std::min(max.z, origin.z + LEN - 1) - z + 1;
+          Section& section = _sections[origin];
+          size_t start = index(loc - origin);
+          std::fill(section.blocks + start, section.blocks + start + run, block);
+          for (size_t i = start; i < start + run; i++) {
+            section.known.set(i);
+          }
+          z += run;
+        }
+      }
+    }
+  } else {
+    for_each_section(min, max, [&](const Coordinate& origin, Section& section) {
+      for (int y = std::max(min.y, origin.y); y <= std::min(max.y, origin.y + LEN - 1); y++) {
+        for (int x = std::max(min.x, origin.x); x <= std::min(max.x, origin.x + LEN - 1); x++) {
+          for (int z = std::max(min.z, origin.z); z <= std::min(max.z, origin.z + LEN - 1); z++) {
+            section.known.reset(index(Coordinate(x, y, z) - origin));
+          }
+        }
+      }
+    });
+  }
+
+  // Collect first, updating a column may forget it
+  std::vector<Coordinate2D> columns;
+  if (static_cast<size_t>(dim.x) * dim.z <= _heights.size()) {
+    for (int x = min.x; x <= max.x; x++) {
+      for (int z = min.z; z <= max.z; z++) {
+        if (_heights.count(Coordinate2D(x, z)) != 0) {
+          columns.emplace_back(x, z);
+        }
+      }
+    }
+  } else {
+    for (const auto& [column, height] : _heights) {
+      if (column.x >= min.x && column.x <= max.x && column.z >= min.z && column.z <= max.z) {
+        columns.push_back(column);
+      }
+    }
+  }
+  for (const Coordinate2D& column : columns) {
+    update_height(column.x, column.z, min.y, max.y, block);
+  }
+}
+
+void ShadowState::update_height(int x, int z, int32_t min_y, int32_t max_y,
+                                const BlockType& block) {
+  auto it = _heights.find(Coordinate2D(x, z));
+  if (it == _heights.end()) {
+    return;
+  }
+  int32_t& height = it->second;
+  if (!is_air(block)) {
+    height = std::max(height, max_y);
+    return;
+  }
+  if (height < min_y || height > max_y) {
+    return;
+  }
+  // The top was cleared, walk down through known blocks to the next solid one
+  for (int32_t y = min_y - 1;; y--) {
+    std::optional<BlockType> below = get(Coordinate(x, y, z));
+    if (!below) {
+      _heights.erase(it);
+      return;
+    }
+    if (!is_air(*below)) {
+      height = y;
+      return;
+    }
+  }
+}
+
+std::optional<int32_t> ShadowState::height(const Coordinate2D& loc) const {
+  auto it = _heights.find(loc);
+  if (it == _heights.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+std::optional<HeightMap> ShadowState::heights(const Coordinate2D& loc1,
+                                              const Coordinate2D& loc2) const {
+  std::vector<int16_t> heights;
+  heights.reserve(static_cast<size_t>(std::abs(loc1.x - loc2.x) + 1) *
+                  (std::abs(loc1.z - loc2.z) + 1));
+  // Same x-major order as world.getHeights
+  for (int x = std::min(loc1.x, loc2.x); x <= std::max(loc1.x, loc2.x); x++) {
+    for (int z = std::min(loc1.z, loc2.z); z <= std::max(loc1.z, loc2.z); z++) {
+      auto it = _heights.find(Coordinate2D(x, z));
+      if (it == _heights.end()) {
+        return std::nullopt;
+      }
+      heights.push_back(static_cast<int16_t>(it->second));
+    }
+  }
+  return HeightMap{loc1, loc2, heights};
+}
+
+void ShadowState::clear() {
+  _sections.clear();
+  _heights.clear();
+}
+
+} // namespace mcpp
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "../include/mcpp/block.h"
+#include "../include/mcpp/chunk.h"
+#include "../include/mcpp/chunk_view.h"
+#include "../include/mcpp/coordinate.h"
+#include "../include/mcpp/heightmap.h"
+
+#include <bitset>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+/** @file
+ * @brief ShadowState class backing MinecraftConnection::enableShadowState().
+ */
+namespace mcpp {
+
+/**
+ * Last known state of the blocks and column heights a client has read or
+ * written, used to drop writes that would not change anything. Blocks are
+ * kept in 16x16x16 sections with a bit per block marking whether it is known.
+ */
+class ShadowState {
+public:
+  /// setBlocks boxes above this many blocks are not recorded block by block,
+  /// the blocks they cover are forgotten instead
+  static constexpr size_t MAX_RECORDED_VOLUME = 1 << 20;
+
+  /**
+   * Returns the last known block at loc, if any.
+   */
+  std::optional<BlockType> get(const Coordinate& loc) const;
+
+  /**
+   * Whether every block in the box is known to already be block.
+   */
+  bool matches(const Coordinate& min, const Coordinate& max, const BlockType& block) const;
+
+  /**
+   * Records a block read from the server.
+   */
+  void observe(const Coordinate& loc, const BlockType& block);
+
+  /**
+   * Records every block of a chunk read from the server.
+   */
+  void observe(const ChunkView& blocks);
+
+  /**
+   * Records a column height read from the server.
+   */
+  void observe_height(const Coordinate2D& loc, int32_t height);
+
+  /**
+   * Records every column height of a height map read from the server.
+   */
+  void observe(const HeightMap& heights);
+
+  /**
+   * Records a setBlock, keeping known column heights current.
+   */
+  void write(const Coordinate& loc, const BlockType& block);
+
+  /**
+   * Records a setBlocks over the box, keeping known column heights current.
+   */
+  void fill(const Coordinate& min, const Coordinate& max, const BlockType& block);
+
+  /**
+   * Returns the known height of a column, if any.
+   */
+  std::optional<int32_t> height(const Coordinate2D& loc) const;
+
+  /**
+   * Returns the heights of the rectangle if every column in it is known.
+   */
+  std::optional<HeightMap> heights(const Coordinate2D& loc1, const Coordinate2D& loc2) const;
+
+  void clear();
+
+private:
+  struct Section {
+    BlockType blocks[16 * 16 * 16];
+    std::bitset<16 * 16 * 16> known;
+  };
+
+  /// Calls fn(origin, section) for every existing section overlapping the box
+  template <typename Fn> void for_each_section(const Coordinate& min, const Coordinate& max, Fn fn);
+  void set(const Coordinate& loc, const BlockType& block);
+  void update_height(int x, int z, int32_t min_y, int32_t max_y, const BlockType& block);
+
+  std::unordered_map<Coordinate, Section, Coordinate> _sections;
+  std::unordered_map<Coordinate2D, int32_t, Coordinate2D> _heights;
+};
+
+} // namespace mcpp
@@ -0,0 +1,54 @@
+#include "../include/mcpp/storage_chunk.h"
+#include "block_scan.h"
+
+namespace mcpp {
+
+size_t AosStorage::count(const BlockType& block, bool match_mod) const {
+  uint16_t mask = match_mod ? 0xffff : 0x00ff;
+  return scan::active().count(_blocks.data(), _blocks.size(), scan::lane(block) & mask, mask);
+}
+
+size_t AosStorage::find(const BlockType& block, bool match_mod) const {
+  uint16_t mask = match_mod ? 0xffff : 0x00ff;
+  return scan::active().find(_blocks.data(), _blocks.size(), scan::lane(block) & mask, mask);
+}
+
+size_t SoaStorage::count(const BlockType& block, bool match_mod) const {
+  if (!match_mod) {
+    return scan::active().count_bytes(_ids.data(), _ids.size(), block.id);
+  }
+  // Branch free so the compiler vectorises it over both arrays
+  size_t count = 0;
+  for (size_t i = 0; i < _ids.size(); i++) {
+    count += static_cast<size_t>((_ids[i] == block.id) & (_mods[i] == block.mod));
+  }
+  return count;
+}
+
+size_t SoaStorage::find(const BlockType& block, bool match_mod) const {
+  const scan::Kernels& kernels = scan::active();
+  size_t n = _ids.size();
+  size_t i = kernels.find_bytes(_ids.data(), n, block.id);
+  while (match_mod && i < n && _mods[i] != block.mod) {
+    i++;
+    i += kernels.find_bytes(_ids.data() + i, n - i, block.id);
+  }
+  return i;
+}
+
+size_t IdOnlyStorage::count(const BlockType& block, bool match_mod) const {
+  // Every stored block reads back with a mod of 0
+  if (match_mod && block.mod != 0) {
+    return 0;
+  }
+  return scan::active().count_bytes(_ids.data(), _ids.size(), block.id);
+}
+
+size_t IdOnlyStorage::find(const BlockType& block, bool match_mod) const {
+  if (match_mod && block.mod != 0) {
+    return _ids.size();
+  }
+  return scan::active().find_bytes(_ids.data(), _ids.size(), block.id);
+}
+
+} // namespace mcpp
@@ -0,0 +1,103 @@
+#include "../include/mcpp/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace mcpp {
+
+struct ThreadPool::Job {
+  const std::function<void(size_t)>* task;
+  size_t count;
+  std::atomic<size_t> next{0};
+  std::atomic<size_t> done{0};
+  std::mutex error_mutex;
+  std::exception_ptr error;
+};
+
+ThreadPool::ThreadPool(size_t threads) {
+  for (size_t i = 1; i < std::max<size_t>(threads, 1); i++) {
+    _workers.emplace_back([this] { worker_loop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stopping = true;
+  }
+  _wake.notify_all();
+  for (std::thread& worker : _workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::work(Job& job) {
+  for (size_t i = job.next++; i < job.count; i = job.next++) {
+    try {
+      (*job.task)(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(job.error_mutex);
+      if (!job.error) {
+        job.error = std::current_exception();
+      }
+    }
+    if (++job.done == job.count) {
+      // Under the lock so the waiting thread cannot miss the notification
+      std::lock_guard<std::mutex> lock(_mutex);
+      _finished.notify_all();
+    }
+  }
+}
+
+void ThreadPool::worker_loop() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    _wake.wait(lock, [this] { return _stopping || !_jobs.empty(); });
+    if (_stopping) {
+      return;
+    }
+    std::shared_ptr<Job> job = _jobs.front();
+    if (job->next >= job->count) {
+      // Every task has been claimed, the job stays alive until its owner returns
+      _jobs.pop_front();
+      continue;
+    }
+    lock.unlock();
+    work(*job);
+    lock.lock();
+  }
+}
+
+void ThreadPool::run(size_t count, const std::function<void(size_t)>& task) {
+  if (count == 0) {
+    return;
+  }
+  auto job = std::make_shared<Job>();
+  job->task = &task;
+  job->count = count;
+  if (!_workers.empty() && count > 1) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _jobs.push_back(job);
+    }
+    _wake.notify_all();
+  }
+
+  work(*job);
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _finished.wait(lock, [&] { return job->done == job->count; });
+    _jobs.erase(std::remove(_jobs.begin(), _jobs.end(), job), _jobs.end());
+  }
+  if (job->error) {
+    std::rethrow_exception(job->error);
+  }
+}
+
+ThreadPool& ThreadPool::shared() {
+  static ThreadPool pool;
+  return pool;
+}
+
+} // namespace mcpp
@@ -0,0 +1,145 @@
+#include "../include/mcpp/trace.h"
+#include "instrument.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace mcpp {
+namespace {
+struct TraceEvent {
+  const char* name;
+  const char* category;
+  uint32_t tid;
+  int64_t start_ns;
+  int64_t end_ns;
+  int64_t bytes;
+};
+
+std::atomic<bool> trace_enabled{false};
+std::mutex trace_mutex;
+std::vector<TraceEvent> trace_events;
+} // namespace
+
+// Small sequential ids read better in trace viewers than native thread handles
+uint32_t trace_thread_id() {
+  static std::atomic<uint32_t> next_id{1};
+  thread_local uint32_t id = next_id.fetch_add(1);
+  return id;
+}
+
+void Tracer::start() { trace_enabled.store(true, std::memory_order_relaxed); }
+
+void Tracer::stop() { trace_enabled.store(false, std::memory_order_relaxed); }
+
+bool Tracer::enabled() { return trace_enabled.load(std::memory_order_relaxed); }
+
+void Tracer::clear() {
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  trace_events.clear();
+  instrument::reset();
+}
+
+bool Tracer::instrumented() {
+#ifdef MCPP_INSTRUMENTATION
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::vector<ProfileEntry> Tracer::profile() {
+  // Same name may come from several threads, and pointer identity is not
+  // guaranteed across translation units, so merge by string
+  std::map<std::string, ProfileEntry> merged;
+  instrument::for_each_buffer([&](const instrument::ThreadBuffer& buffer) {
+    for (const instrument::Stat& stat : buffer.stats) {
+      const char* name = stat.name.load(std::memory_order_acquire);
+      if (name == nullptr) {
+        continue;
+      }
+      auto [it, inserted] = merged.try_emplace(
+          name, ProfileEntry{name, stat.is_counter.load(std::memory_order_relaxed), 0, 0});
+      it->second.calls += stat.calls.load(std::memory_order_relaxed);
+      it->second.total += stat.total.load(std::memory_order_relaxed);
+    }
+  });
+
+  std::vector<ProfileEntry> entries;
+  entries.reserve(merged.size());
+  for (auto& [name, entry] : merged) {
+    entries.push_back(std::move(entry));
+  }
+  return entries;
+}
+
+size_t Tracer::event_count() {
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  return trace_events.size();
+}
+
+void Tracer::record(const char* name, int64_t start_ns, int64_t end_ns, int64_t bytes) {
+  uint32_t tid = trace_thread_id();
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  trace_events.push_back({name, "mcpp", tid, start_ns, end_ns, bytes});
+}
+
+void Tracer::write_chrome_json(std::ostream& out) {
+  std::lock_guard<std::mutex> lock(trace_mutex);
+
+  std::vector<TraceEvent> events = trace_events;
+  instrument::for_each_buffer([&](const instrument::ThreadBuffer& buffer) {
+    size_t size = buffer.size.load(std::memory_order_acquire);
+    for (size_t i = 0; i < size; i++) {
+      const instrument::ScopeRecord& record = buffer.records[i];
+      events.push_back(
+          {record.name, "instrument", buffer.record_tid(i), record.start_ns, record.end_ns, -1});
+    }
+  });
+
+  // Timestamps are relative to the first recorded span to keep numbers short
+  int64_t origin = 0;
+  if (!events.empty()) {
+    origin = events.front().start_ns;
+    for (const TraceEvent& event : events) {
+      origin = std::min(origin, event.start_ns);
+    }
+  }
+
+  auto micros = [](int64_t ns) {
+    return std::to_string(ns / 1000) + "." + std::to_string(1000 + (ns % 1000)).substr(1);
+  };
+
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  for (const TraceEvent& event : events) {
+    if (!first) {
+      out << ",";
+    }
+    first = false;
+    out << "\n{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+        << "\",\"ph\":\"X\",\"pid\":" << getpid()
+        << ",\"tid\":" << event.tid << ",\"ts\":" << micros(event.start_ns - origin)
+        << ",\"dur\":" << micros(event.end_ns - event.start_ns);
+    if (event.bytes >= 0) {
+      out << ",\"args\":{\"bytes\":" << event.bytes << "}";
+    }
+    out << "}";
+  }
+  out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void Tracer::write_chrome_json(const std::string& path) {
+  std::ofstream file(path);
+  if (!file) {
+    throw std::runtime_error("Failed to open trace output file: " + path);
+  }
+  write_chrome_json(file);
+}
+} // namespace mcpp
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../include/mcpp/trace.h"
+
+#include <chrono>
+#include <cstdint>
+
+/** @file
+ * @brief TraceSpan class.
+ *
+ */
+namespace mcpp {
+/**
+ * Small sequential id of the calling thread, shared by all recorded spans.
+ */
+uint32_t trace_thread_id();
+
+/**
+ * Scoped span that records its lifetime with the Tracer if tracing was enabled
+ * when it was created. Names must be string literals as only the pointer is
+ * stored.
+ */
+class TraceSpan {
+private:
+  const char* _name;
+  int64_t _start_ns = 0;
+  int64_t _bytes = -1;
+  bool _active;
+
+public:
+  static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  explicit TraceSpan(const char* name) : _name(name), _active(Tracer::enabled()) {
+    if (_active) {
+      _start_ns = now_ns();
+    }
+  }
+
+  ~TraceSpan() { end(); }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+  /**
+   * Attaches a byte count to the span, shown as an argument in the trace.
+   */
+  void set_bytes(int64_t bytes) { _bytes = bytes; }
+
+  /**
+   * Ends the span early. Further calls and the destructor do nothing.
+   */
+  void end() {
+    if (_active) {
+      Tracer::record(_name, _start_ns, now_ns(), _bytes);
+      _active = false;
+    }
+  }
+};
+} // namespace mcpp
@@ -1,12 +1,15 @@
 #pragma once
 
 #include <cmath>
+#include <cstdlib>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <vector>
 
+#include "../include/mcpp/block.h"
+
 template <typename T> void split_response(const std::string& str, std::vector<T>& vec) {
   static_assert(std::is_integral_v<T>, "T must be an integral type.");
 
@@ -21,3 +24,86 @@ template <typename T> void split_response(const std::string& str, std::vector<T>
     }
   }
 }
+
+/**
+ * Parses a getBlocksWithData response of format 1,2;1,2;1,2 where 1,2 is a
+ * block of type 1 and mod 2, appending each block to vec.
+ */
+inline void parse_blocks(const std::string& str, std::vector<mcpp::BlockType>& vec) {
+  std::stringstream stream(str);
+
+  // uint16_t because stupid << is overloaded to read first character instead
+  // of number for uint8_t raaaa
+  // This shouldn't return anything larger than a uint8_t anyway
+  uint16_t id;
+  uint16_t mod;
+  char delimiter;
+  while (stream >> id) {
+    stream >> delimiter;
+    if (delimiter == ',') {
+      stream >> mod;
+      vec.emplace_back(id, mod);
+      stream >> delimiter;
+    }
+    if (delimiter == ';') {
+      continue;
+    }
+    if (delimiter == EOF) {
+      break;
+    }
+  }
+}
+
+/**
+ * Parses a comma separated response into exactly n values at out without
+ * allocating, for filling existing storage.
+ */
+template <typename T> void split_response(const std::string& str, T* out, size_t n) {
+  static_assert(std::is_integral_v<T>, "T must be an integral type.");
+
+  const char* pos = str.c_str();
+  size_t count = 0;
+  while (*pos != '\0') {
+    char* end;
+    // Integers are the common case, strtod is only needed for fractions
+    auto value = static_cast<T>(std::strtol(pos, &end, 10));
+    if (*end == '.' || *end == 'e' || *end == 'E') {
+      value = static_cast<T>(std::floor(std::strtod(pos, &end)));
+    }
+    if (end == pos || (*end != ',' && *end != '\0') || count == n) {
+      throw std::runtime_error("Server call returned malformed response string: " + str);
+    }
+    out[count++] = value;
+    pos = *end == ',' ? end + 1 : end;
+  }
+  if (count != n) {
+    throw std::runtime_error("Server call returned malformed response string: " + str);
+  }
+}
+
+/**
+ * Parses a getBlocksWithData response into exactly n blocks at out without
+ * allocating, for filling existing storage.
+ */
+inline void parse_blocks(const std::string& str, mcpp::BlockType* out, size_t n) {
+
+  const char* pos = str.c_str();
+  size_t count = 0;
+  while (*pos != '\0') {
+    char* end;
+    long id = std::strtol(pos, &end, 10);
+    if (end == pos || *end != ',' || count == n) {
+      throw std::runtime_error("Server call returned malformed response string: " + str);
+    }
+    pos = end + 1;
+    long mod = std::strtol(pos, &end, 10);
+    if (end == pos || (*end != ';' && *end != '\0')) {
+      throw std::runtime_error("Server call returned malformed response string: " + str);
+    }
+    out[count++] = mcpp::BlockType(static_cast<uint8_t>(id), static_cast<uint8_t>(mod));
+    pos = *end == ';' ? end + 1 : end;
+  }
+  if (count != n) {
+    throw std::runtime_error("Server call returned malformed response string: " + str);
+  }
+}
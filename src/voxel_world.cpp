@@ -0,0 +1,216 @@
+#include "../include/mcpp/voxel_world.h"
+#include "block_hash.h"
+
+#include <algorithm>
+
+namespace mcpp {
+
+namespace {
+int floor_div(int v) {
+  return v >= 0 ? v / VoxelWorld::SECTION_LEN
+                : -((-v + VoxelWorld::SECTION_LEN - 1) / VoxelWorld::SECTION_LEN);
+}
+
+bool is_air(const BlockType& block) { return block == Blocks::AIR; }
+} // namespace
+
+void VoxelWorld::Section::set(int x, int y, int z, const BlockType& block) {
+  if (_blocks.empty()) {
+    if (block == _uniform) {
+      return;
+    }
+    _blocks.assign(SECTION_VOLUME, _uniform);
+  }
+  _hashed = false;
+  BlockType& current = _blocks[index(x, y, z)];
+  _non_air += static_cast<int>(!is_air(block)) - static_cast<int>(!is_air(current));
+  current = block;
+}
+
+bool VoxelWorld::Section::collapse() {
+  if (_blocks.empty()) {
+    return true;
+  }
+  BlockType first = _blocks[0];
+  if (std::any_of(_blocks.begin(), _blocks.end(),
+                  [&](const BlockType& block) { return block != first; })) {
+    return false;
+  }
+  _uniform = first;
+  _blocks.clear();
+  _blocks.shrink_to_fit();
+  return true;
+}
+
+uint64_t VoxelWorld::Section::hash() const {
+  if (!_hashed) {
+    // Row by row either way, so uniform and expanded sections agree
+    hash::Hasher hasher;
+    std::vector<BlockType> uniform_row;
+    if (_blocks.empty()) {
+      uniform_row.assign(SECTION_LEN, _uniform);
+    }
+    for (int row = 0; row < SECTION_LEN * SECTION_LEN; row++) {
+      hasher.add(_blocks.empty() ? uniform_row.data() : _blocks.data() + (row * SECTION_LEN),
+                 SECTION_LEN);
+    }
+    _hash = hasher.finish();
+    _hashed = true;
+  }
+  return _hash;
+}
+
+VoxelWorld::VoxelWorld(const Chunk& chunk) { import_chunk(chunk); }
+
+Coordinate VoxelWorld::section_of(const Coordinate& pos) {
+  return {floor_div(pos.x), floor_div(pos.y), floor_div(pos.z)};
+}
+
+Coordinate VoxelWorld::section_origin(const Coordinate& section) {
+  return {section.x * SECTION_LEN, section.y * SECTION_LEN, section.z * SECTION_LEN};
+}
+
+BlockType VoxelWorld::get(const Coordinate& pos) const {
+  Coordinate key = section_of(pos);
+  auto it = _sections.find(key);
+  if (it == _sections.end()) {
+    return Blocks::AIR;
+  }
+  Coordinate local = pos - section_origin(key);
+  return it->second.get(local.x, local.y, local.z);
+}
+
+void VoxelWorld::set(const Coordinate& pos, const BlockType& block) {
+  Coordinate key = section_of(pos);
+  auto it = _sections.find(key);
+  if (it == _sections.end()) {
+    if (is_air(block)) {
+      return;
+    }
+    it = _sections.emplace(key, Section()).first;
+  }
+  Coordinate local = pos - section_origin(key);
+  it->second.set(local.x, local.y, local.z, block);
+  if (it->second._non_air == 0) {
+    _sections.erase(it);
+  }
+}
+
+void VoxelWorld::import_chunk(const Chunk& chunk) {
+  Coordinate base = chunk.base_pt();
+  Coordinate last = base + Coordinate(chunk.x_len() - 1, chunk.y_len() - 1, chunk.z_len() - 1);
+  Coordinate lo = section_of(base);
+  Coordinate hi = section_of(last);
+  const BlockType* data = chunk.data();
+  size_t x_len = chunk.x_len();
+  size_t z_len = chunk.z_len();
+
+  for (int sy = lo.y; sy <= hi.y; sy++) {
+    for (int sx = lo.x; sx <= hi.x; sx++) {
+      for (int sz = lo.z; sz <= hi.z; sz++) {
+        Coordinate key(sx, sy, sz);
+        Coordinate origin = section_origin(key);
+        Coordinate from(std::max(base.x, origin.x), std::max(base.y, origin.y),
+                        std::max(base.z, origin.z));
+        Coordinate to(std::min(last.x, origin.x + SECTION_LEN - 1),
+                      std::min(last.y, origin.y + SECTION_LEN - 1),
+                      std::min(last.z, origin.z + SECTION_LEN - 1));
+
+        Section& section = _sections[key];
+        if (section._blocks.empty()) {
+          section._blocks.assign(SECTION_VOLUME, section._uniform);
+        }
+        section._hashed = false;
+        for (int y = from.y; y <= to.y; y++) {
+          for (int x = from.x; x <= to.x; x++) {
+            size_t in = ((y - base.y) * x_len * z_len) + ((x - base.x) * z_len) + (from.z - base.z);
+            size_t out = Section::index(x - origin.x, y - origin.y, from.z - origin.z);
+            std::copy(data + in, data + in + (to.z - from.z + 1), section._blocks.begin() + out);
+          }
+        }
+        section._non_air = static_cast<int>(std::count_if(
+            section._blocks.begin(), section._blocks.end(),
+            [](const BlockType& block) { return !is_air(block); }));
+
+        if (section._non_air == 0) {
+          _sections.erase(key);
+        } else {
+          section.collapse();
+        }
+      }
+    }
+  }
+}
+
+Chunk VoxelWorld::export_chunk(const Coordinate& loc1, const Coordinate& loc2) const {
+  Coordinate min{std::min(loc1.x, loc2.x), std::min(loc1.y, loc2.y), std::min(loc1.z, loc2.z)};
+  Coordinate max{std::max(loc1.x, loc2.x), std::max(loc1.y, loc2.y), std::max(loc1.z, loc2.z)};
+  Coordinate dim = max - min + Coordinate(1, 1, 1);
+  std::vector<BlockType> blocks(static_cast<size_t>(dim.x) * dim.y * dim.z, Blocks::AIR);
+
+  auto out = blocks.begin();
+  for (int y = min.y; y <= max.y; y++) {
+    for (int x = min.x; x <= max.x; x++) {
+      // Copy the row a section at a time, missing sections stay air
+      for (int z = min.z; z <= max.z;) {
+        Coordinate pos(x, y, z);
+        Coordinate key = section_of(pos);
+        Coordinate local = pos - section_origin(key);
+        int run = std::min(max.z - z + 1, SECTION_LEN - local.z);
+        auto it = _sections.find(key);
+        if (it != _sections.end()) {
+          const Section& section = it->second;
+          if (section.is_uniform()) {
+            std::fill(out, out + run, section._uniform);
+          } else {
+            auto row = section._blocks.begin() + Section::index(local.x, local.y, local.z);
+            std::copy(row, row + run, out);
+          }
+        }
+        out += run;
+        z += run;
+      }
+    }
+  }
+  return Chunk{min, max, blocks};
+}
+
+std::vector<Coordinate> VoxelWorld::changed_sections(const VoxelWorld& other) const {
+  // Sections that are not stored are all air, and stored ones never are
+  std::vector<Coordinate> changed;
+  for (const auto& [key, section] : _sections) {
+    auto it = other._sections.find(key);
+    if (it == other._sections.end() || it->second.hash() != section.hash()) {
+      changed.push_back(key);
+    }
+  }
+  for (const auto& [key, section] : other._sections) {
+    if (_sections.count(key) == 0) {
+      changed.push_back(key);
+    }
+  }
+  return changed;
+}
+
+void VoxelWorld::compact() {
+  for (auto it = _sections.begin(); it != _sections.end();) {
+    if (it->second._non_air == 0) {
+      it = _sections.erase(it);
+    } else {
+      it->second.collapse();
+      ++it;
+    }
+  }
+}
+
+size_t VoxelWorld::memory_usage() const {
+  // Node and bucket overhead of the map plus any expanded block storage
+  size_t bytes = _sections.bucket_count() * sizeof(void*);
+  for (const auto& [key, section] : _sections) {
+    bytes += sizeof(SectionMap::value_type) + 2 * sizeof(void*);
+    bytes += section._blocks.capacity() * sizeof(BlockType);
+  }
+  return bytes;
+}
+
+} // namespace mcpp
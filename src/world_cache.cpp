@@ -0,0 +1,207 @@
+#include "world_cache.h"
+
+#include <algorithm>
+
+namespace mcpp {
+
+namespace {
+int floor_section(int v) {
+  return v - (((v % WorldCache::SECTION_LEN) + WorldCache::SECTION_LEN) % WorldCache::SECTION_LEN);
+}
+} // namespace
+
+WorldCache::WorldCache(const CacheOptions& options) : _ttl(options.ttl) {
+  // Block data plus bookkeeping of the map and LRU list per section
+  size_t section_bytes = SECTION_VOLUME * sizeof(BlockType) + sizeof(Section) + 64;
+  _capacity = std::max<size_t>(1, options.max_bytes / section_bytes);
+}
+
+Coordinate WorldCache::section_origin(const Coordinate& loc) {
+  return {floor_section(loc.x), floor_section(loc.y), floor_section(loc.z)};
+}
+
+size_t WorldCache::index(const Coordinate& offset) {
+  return (offset.y * SECTION_LEN * SECTION_LEN) + (offset.x * SECTION_LEN) + offset.z;
+}
+
+size_t WorldCache::section_count(const Coordinate& min, const Coordinate& max) {
+  Coordinate span = section_origin(max) - section_origin(min);
+  return static_cast<size_t>(span.x / SECTION_LEN + 1) * (span.y / SECTION_LEN + 1) *
+         (span.z / SECTION_LEN + 1);
+}
+
+bool WorldCache::fits(const Coordinate& min, const Coordinate& max) const {
+  return section_count(min, max) <= _capacity;
+}
+
+WorldCache::Section* WorldCache::find(const Coordinate& origin) {
+  auto it = _sections.find(origin);
+  if (it == _sections.end()) {
+    return nullptr;
+  }
+  if (_ttl.count() > 0 && Clock::now() - it->second.fetched > _ttl) {
+    _lru.erase(it->second.lru_pos);
+    _sections.erase(it);
+    return nullptr;
+  }
+  return &it->second;
+}
+
+void WorldCache::touch(Section& section) {
+  _lru.splice(_lru.begin(), _lru, section.lru_pos);
+}
+
+void WorldCache::evict_to(size_t sections) {
+  while (_sections.size() > sections) {
+    _sections.erase(_lru.back());
+    _lru.pop_back();
+    _stats.evictions++;
+  }
+}
+
+std::optional<BlockType> WorldCache::get(const Coordinate& loc) {
+  Coordinate origin = section_origin(loc);
+  Section* section = find(origin);
+  if (section == nullptr) {
+    _stats.misses++;
+    return std::nullopt;
+  }
+  _stats.hits++;
+  touch(*section);
+  return section->blocks[index(loc - origin)];
+}
+
+std::vector<Coordinate> WorldCache::missing(const Coordinate& min, const Coordinate& max) {
+  Coordinate lo = section_origin(min);
+  Coordinate hi = section_origin(max);
+  std::vector<Coordinate> result;
+  for (int y = lo.y; y <= hi.y; y += SECTION_LEN) {
+    for (int x = lo.x; x <= hi.x; x += SECTION_LEN) {
+      for (int z = lo.z; z <= hi.z; z += SECTION_LEN) {
+        Coordinate origin(x, y, z);
+        if (Section* section = find(origin)) {
+          _stats.hits++;
+          touch(*section);
+        } else {
+          _stats.misses++;
+          result.push_back(origin);
+        }
+      }
+    }
+  }
+  return result;
+}
+
+void WorldCache::insert(const Chunk& chunk) {
+  Coordinate base = chunk.base_pt();
+  size_t x_len = chunk.x_len();
+  size_t z_len = chunk.z_len();
+  const BlockType* data = chunk.data();
+  Clock::time_point now = Clock::now();
+
+  for (int sy = 0; sy < chunk.y_len(); sy += SECTION_LEN) {
+    for (int sx = 0; sx < chunk.x_len(); sx += SECTION_LEN) {
+      for (int sz = 0; sz < chunk.z_len(); sz += SECTION_LEN) {
+        Coordinate origin = base + Coordinate(sx, sy, sz);
+        auto [it, inserted] = _sections.try_emplace(origin);
+        Section& section = it->second;
+        if (inserted) {
+          section.blocks.resize(SECTION_VOLUME);
+          _lru.push_front(origin);
+          section.lru_pos = _lru.begin();
+        } else {
+          touch(section);
+        }
+        section.fetched = now;
+
+        for (int y = 0; y < SECTION_LEN; y++) {
+          for (int x = 0; x < SECTION_LEN; x++) {
+            const BlockType* row = data + ((sy + y) * x_len * z_len) + ((sx + x) * z_len) + sz;
+            std::copy(row, row + SECTION_LEN, &section.blocks[index(Coordinate(x, y, 0))]);
+          }
+        }
+      }
+    }
+  }
+  evict_to(_capacity);
+}
+
+Chunk WorldCache::read(const Coordinate& min, const Coordinate& max) const {
+  Coordinate dim = max - min + Coordinate(1, 1, 1);
+  std::vector<BlockType> blocks(static_cast<size_t>(dim.x) * dim.y * dim.z);
+  auto out = blocks.begin();
+  for (int y = min.y; y <= max.y; y++) {
+    for (int x = min.x; x <= max.x; x++) {
+      // Copy the row a section at a time
+      for (int z = min.z; z <= max.z;) {
+        Coordinate loc(x, y, z);
+        Coordinate origin = section_origin(loc);
+        int run = std::min(max.z, origin.z + SECTION_LEN - 1) - z + 1;
+        const std::vector<BlockType>& section = _sections.at(origin).blocks;
+        auto row = section.begin() + index(loc - origin);
+        out = std::copy(row, row + run, out);
+        z += run;
+      }
+    }
+  }
+  return Chunk{min, max, blocks};
+}
+
+void WorldCache::write(const Coordinate& loc, const BlockType& block) {
+  Coordinate origin = section_origin(loc);
+  auto it = _sections.find(origin);
+  if (it != _sections.end()) {
+    it->second.blocks[index(loc - origin)] = block;
+  }
+}
+
+void WorldCache::fill(const Coordinate& min, const Coordinate& max, const BlockType& block) {
+  auto fill_section = [&](const Coordinate& origin, Section& section) {
+    Coordinate last = origin + Coordinate(SECTION_LEN - 1, SECTION_LEN - 1, SECTION_LEN - 1);
+    Coordinate from(std::max(min.x, origin.x), std::max(min.y, origin.y),
+                    std::max(min.z, origin.z));
+    Coordinate to(std::min(max.x, last.x), std::min(max.y, last.y), std::min(max.z, last.z));
+    for (int y = from.y; y <= to.y; y++) {
+      for (int x = from.x; x <= to.x; x++) {
+        auto row = section.blocks.begin() + index(Coordinate(x, y, from.z) - origin);
+        std::fill(row, row + (to.z - from.z + 1), block);
+      }
+    }
+  };
+
+  // Walk whichever is smaller, the sections under the box or the cache
+  Coordinate lo = section_origin(min);
+  Coordinate hi = section_origin(max);
+  if (section_count(min, max) <= _sections.size()) {
+    for (int y = lo.y; y <= hi.y; y += SECTION_LEN) {
+      for (int x = lo.x; x <= hi.x; x += SECTION_LEN) {
+        for (int z = lo.z; z <= hi.z; z += SECTION_LEN) {
+          auto it = _sections.find(Coordinate(x, y, z));
+          if (it != _sections.end()) {
+            fill_section(it->first, it->second);
+          }
+        }
+      }
+    }
+    return;
+  }
+  for (auto& [origin, section] : _sections) {
+    if (origin.x >= lo.x && origin.x <= hi.x && origin.y >= lo.y && origin.y <= hi.y &&
+        origin.z >= lo.z && origin.z <= hi.z) {
+      fill_section(origin, section);
+    }
+  }
+}
+
+void WorldCache::clear() {
+  _sections.clear();
+  _lru.clear();
+}
+
+CacheStats WorldCache::stats() const {
+  CacheStats stats = _stats;
+  stats.sections = _sections.size();
+  return stats;
+}
+
+} // namespace mcpp
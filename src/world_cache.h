@@ -0,0 +1,102 @@
+#pragma once
+
+#include "../include/mcpp/block.h"
+#include "../include/mcpp/chunk.h"
+#include "../include/mcpp/coordinate.h"
+#include "../include/mcpp/mcpp.h"
+
+#include <chrono>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+/** @file
+ * @brief WorldCache class backing MinecraftConnection::enableCache().
+ */
+namespace mcpp {
+
+/**
+ * Client-side copy of fetched world blocks, stored in 16x16x16 sections
+ * aligned to multiples of 16. Sections are evicted least recently used first
+ * once the memory budget is reached and are not trusted after their TTL.
+ */
+class WorldCache {
+public:
+  static constexpr int SECTION_LEN = 16;
+  static constexpr size_t SECTION_VOLUME = SECTION_LEN * SECTION_LEN * SECTION_LEN;
+
+  explicit WorldCache(const CacheOptions& options);
+
+  /**
+   * Returns the origin of the section containing loc.
+   */
+  static Coordinate section_origin(const Coordinate& loc);
+
+  /**
+   * Whether every section overlapping the box fits within the memory budget
+   * at once. Larger requests are passed straight through to the server.
+   */
+  bool fits(const Coordinate& min, const Coordinate& max) const;
+
+  /**
+   * Returns the cached block at loc, or nothing if its section is missing or
+   * expired.
+   */
+  std::optional<BlockType> get(const Coordinate& loc);
+
+  /**
+   * Returns the origins of the sections overlapping the box that have to be
+   * fetched. Sections that are present are marked as recently used.
+   */
+  std::vector<Coordinate> missing(const Coordinate& min, const Coordinate& max);
+
+  /**
+   * Stores every section in a chunk whose bounds lie on section boundaries.
+   */
+  void insert(const Chunk& chunk);
+
+  /**
+   * Assembles a box whose sections are all present into a Chunk.
+   */
+  Chunk read(const Coordinate& min, const Coordinate& max) const;
+
+  /**
+   * Write-through of setBlock, updates the block if its section is cached.
+   */
+  void write(const Coordinate& loc, const BlockType& block);
+
+  /**
+   * Write-through of setBlocks, updates the cached parts of the box.
+   */
+  void fill(const Coordinate& min, const Coordinate& max, const BlockType& block);
+
+  void clear();
+
+  CacheStats stats() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Section {
+    std::vector<BlockType> blocks;
+    Clock::time_point fetched;
+    std::list<Coordinate>::iterator lru_pos;
+  };
+
+  /// Returns the section at origin if it is present and fresh
+  Section* find(const Coordinate& origin);
+  void touch(Section& section);
+  void evict_to(size_t sections);
+  static size_t index(const Coordinate& offset);
+  static size_t section_count(const Coordinate& min, const Coordinate& max);
+
+  std::unordered_map<Coordinate, Section, Coordinate> _sections;
+  /// Section origins, most recently used first
+  std::list<Coordinate> _lru;
+  size_t _capacity;
+  std::chrono::milliseconds _ttl;
+  CacheStats _stats{};
+};
+
+} // namespace mcpp
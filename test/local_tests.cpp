@@ -1,9 +1,31 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 
 #include "../include/mcpp/block.h"
+#include "../include/mcpp/chunk.h"
+#include "../include/mcpp/chunk_view.h"
 #include "../include/mcpp/coordinate.h"
+#include "../include/mcpp/heightmap.h"
+#include "../include/mcpp/heightmap_view.h"
+#include "../include/mcpp/layout_chunk.h"
+#include "../include/mcpp/octree.h"
+#include "../include/mcpp/paletted_chunk.h"
+#include "../include/mcpp/static_chunk.h"
+#include "../include/mcpp/storage_chunk.h"
+#include "../include/mcpp/parallel.h"
+#include "../include/mcpp/voxel_world.h"
+#include "../src/block_scan.h"
+#include "../src/shadow_state.h"
+#include "../src/trace_span.h"
+#include "../src/util.h"
+#include "../src/world_cache.h"
 #include "doctest.h"
+#include <atomic>
+#include <numeric>
+#include <optional>
 #include <random>
+#include <sstream>
+#include <thread>
+#include <utility>
 
 // NOLINTBEGIN
 
@@ -127,4 +149,1172 @@ TEST_CASE("Test block class") {
   }
 }
 
+TEST_CASE("Test extents beyond 16 bits") {
+  // Long thin areas keep memory small while exceeding uint16_t lengths
+  const int len = 70000;
+
+  SUBCASE("Chunk") {
+    std::vector<BlockType> blocks(static_cast<size_t>(len) * 2, Blocks::AIR);
+    blocks[(static_cast<size_t>(len) - 1) * 2 + 1] = Blocks::STONE;
+    Chunk chunk(Coordinate(-len / 2, 0, 0), Coordinate(len / 2 - 1, 0, 1), blocks);
+    CHECK_EQ(chunk.x_len(), len);
+    CHECK_EQ(chunk.get(len - 1, 0, 1), Blocks::STONE);
+    CHECK_EQ(chunk.get_worldspace(Coordinate(len / 2 - 1, 0, 1)), Blocks::STONE);
+    CHECK_THROWS_AS(chunk.get(len, 0, 0), std::out_of_range);
+    CHECK_EQ(static_cast<size_t>(std::distance(chunk.cbegin(), chunk.cend())), blocks.size());
+  }
+
+  SUBCASE("HeightMap") {
+    std::vector<int16_t> heights(len);
+    heights[len - 1] = 42;
+    HeightMap map(Coordinate2D(0, 0), Coordinate2D(0, len - 1), heights);
+    CHECK_EQ(map.z_len(), len);
+    CHECK_EQ(map.get(0, len - 1), 42);
+
+    HeightMap copy(Coordinate2D(0, 0), Coordinate2D(0, 0), {0});
+    copy = map;
+    CHECK_EQ(copy.z_len(), len);
+    CHECK_EQ(copy.get_worldspace(Coordinate2D(0, len - 1)), 42);
+  }
+}
+
+TEST_CASE("Test Chunk set") {
+  std::vector<BlockType> blocks(3 * 4 * 5, Blocks::STONE);
+  Chunk chunk({0, 0, 0}, {2, 3, 4}, blocks);
+  CHECK_EQ(chunk.dirty_count(), 0);
+
+  chunk.set(1, 2, 3, Blocks::DIRT);
+  chunk.set_worldspace({1, 2, 3}, Blocks::GRASS);
+  chunk.set_worldspace({2, 3, 4}, Blocks::DIRT);
+  CHECK_EQ(chunk.get(1, 2, 3), Blocks::GRASS);
+  CHECK_EQ(chunk.get_worldspace({2, 3, 4}), Blocks::DIRT);
+  CHECK_EQ(chunk.dirty_count(), 2);
+  CHECK_THROWS_AS(chunk.set(3, 0, 0, Blocks::DIRT), std::out_of_range);
+  CHECK_THROWS_AS(chunk.set_worldspace({0, -1, 0}, Blocks::DIRT), std::out_of_range);
+
+  // A copy is a snapshot of the blocks, with nothing of its own to commit
+  Chunk copy(chunk);
+  CHECK_EQ(copy.dirty_count(), 0);
+  CHECK_EQ(copy.get(1, 2, 3), Blocks::GRASS);
+}
+
+TEST_CASE("Test cells") {
+  SUBCASE("Chunk") {
+    std::vector<BlockType> blocks(3 * 4 * 5);
+    for (size_t i = 0; i < blocks.size(); i++) {
+      blocks[i] = BlockType(static_cast<int>(i));
+    }
+    Chunk chunk({-5, 60, 7}, {-3, 63, 11}, blocks);
+    size_t visited = 0;
+    for (auto [pos, block] : chunk.cells()) {
+      CHECK_EQ(block, chunk.get_worldspace(pos));
+      visited++;
+    }
+    CHECK_EQ(visited, blocks.size());
+  }
+
+  SUBCASE("HeightMap") {
+    std::vector<int16_t> values(4 * 3);
+    std::iota(values.begin(), values.end(), int16_t{-2});
+    HeightMap heights({-1, 9}, {2, 11}, values);
+    size_t visited = 0;
+    for (auto [pos, height] : heights.cells()) {
+      CHECK_EQ(height, heights.get_worldspace(pos));
+      visited++;
+    }
+    CHECK_EQ(visited, values.size());
+  }
+}
+
+TEST_CASE("Test Chunk copy on write") {
+  std::vector<BlockType> blocks(4 * 4 * 4, Blocks::STONE);
+  Chunk original({0, 0, 0}, {3, 3, 3}, blocks);
+  CHECK_FALSE(original.is_shared());
+
+  Chunk copy(original);
+  Chunk assigned({0, 0, 0}, {0, 0, 0}, {Blocks::AIR});
+  assigned = copy;
+  const Chunk& view = original;
+  CHECK(original.is_shared());
+  CHECK_EQ(std::as_const(copy).data(), view.data());
+  CHECK_EQ(std::as_const(assigned).data(), view.data());
+
+  SUBCASE("Changes are private to the changed copy") {
+    copy.set(1, 2, 3, Blocks::GOLD_BLOCK);
+    CHECK_NE(std::as_const(copy).data(), view.data());
+    CHECK_EQ(copy.get(1, 2, 3), Blocks::GOLD_BLOCK);
+    CHECK_EQ(original.get(1, 2, 3), Blocks::STONE);
+    CHECK_EQ(assigned.get(1, 2, 3), Blocks::STONE);
+    CHECK_FALSE(copy.is_shared());
+    CHECK(original.is_shared());
+  }
+
+  SUBCASE("Replace copies only when something matches") {
+    CHECK_EQ(copy.replace(Blocks::DIRT, Blocks::GRASS), 0);
+    CHECK_EQ(std::as_const(copy).data(), view.data());
+    CHECK_EQ(copy.replace(Blocks::STONE, Blocks::GRASS), blocks.size());
+    CHECK_EQ(original.count(Blocks::STONE), blocks.size());
+  }
+
+  SUBCASE("Const iteration keeps sharing") {
+    CHECK_EQ(static_cast<size_t>(std::count(copy.cbegin(), copy.cend(), Blocks::STONE)),
+             blocks.size());
+    CHECK_EQ(std::as_const(copy).data(), view.data());
+    CHECK(copy.is_shared());
+  }
+
+  SUBCASE("Mutable access unshares") {
+    *copy.begin() = Blocks::DIRT;
+    copy.data()[1] = Blocks::DIRT;
+    CHECK_EQ(original.get(0, 0, 0), Blocks::STONE);
+    CHECK_EQ(original.get(0, 0, 1), Blocks::STONE);
+    CHECK_EQ(copy.get(0, 0, 1), Blocks::DIRT);
+  }
+
+  SUBCASE("Pending changes are not copied") {
+    original.set(0, 0, 0, Blocks::DIRT);
+    assigned.set(1, 1, 1, Blocks::DIRT);
+    Chunk snapshot(original);
+    assigned = original;
+    CHECK_EQ(original.dirty_count(), 1);
+    CHECK_EQ(snapshot.dirty_count(), 0);
+    CHECK_EQ(assigned.dirty_count(), 0);
+    CHECK_EQ(snapshot.get(0, 0, 0), Blocks::DIRT);
+  }
+
+  SUBCASE("Reshape leaves shared blocks to the copies") {
+    copy.reshape({0, 0, 0}, {3, 3, 3});
+    CHECK_FALSE(copy.is_shared());
+    CHECK_EQ(original.get(3, 3, 3), Blocks::STONE);
+  }
+}
+
+TEST_CASE("Test buffer ownership and reuse") {
+  SUBCASE("Chunk takes its blocks without copying") {
+    auto blocks = std::make_unique<BlockType[]>(2 * 3 * 4);
+    blocks[23] = Blocks::GOLD_BLOCK;
+    const BlockType* storage = blocks.get();
+    Chunk chunk({5, 6, 7}, {4, 4, 4}, std::move(blocks));
+    CHECK_EQ(std::as_const(chunk).data(), storage);
+    CHECK_EQ(chunk.base_pt(), Coordinate(4, 4, 4));
+    CHECK_EQ(chunk.get(1, 2, 3), Blocks::GOLD_BLOCK);
+
+    chunk.set(0, 0, 0, Blocks::DIRT);
+    chunk.reshape({0, 0, 0}, {3, 2, 1});
+    CHECK_EQ(std::as_const(chunk).data(), storage);
+    CHECK_EQ(chunk.x_len(), 4);
+    CHECK_EQ(chunk.dirty_count(), 0);
+    chunk.reshape({0, 0, 0}, {3, 3, 1});
+    CHECK_EQ(chunk.size(), 4 * 4 * 2);
+  }
+
+  SUBCASE("HeightMap takes its heights without copying") {
+    auto values = std::make_unique<int16_t[]>(3 * 2);
+    values[5] = 70;
+    const int16_t* storage = values.get();
+    HeightMap heights({2, 2}, {0, 1}, std::move(values));
+    CHECK_EQ(heights.data(), storage);
+    CHECK_EQ(heights.get_worldspace({2, 2}), 70);
+
+    heights.reshape({0, 0}, {1, 2});
+    CHECK_EQ(heights.data(), storage);
+    CHECK_EQ(heights.x_len(), 2);
+  }
+
+  SUBCASE("Responses parse into existing storage") {
+    BlockType blocks[3];
+    parse_blocks("1,0;35,14;0,0", blocks, 3);
+    CHECK_EQ(blocks[1], BlockType(35, 14));
+    CHECK_THROWS_AS(parse_blocks("1,0;35,14", blocks, 3), std::runtime_error);
+    CHECK_THROWS_AS(parse_blocks("1,0;35;0,0", blocks, 3), std::runtime_error);
+
+    int16_t heights[4];
+    split_response("63,-12,70.0,-0.5", heights, 4);
+    CHECK_EQ(heights[1], -12);
+    CHECK_EQ(heights[2], 70);
+    CHECK_EQ(heights[3], -1);
+    CHECK_THROWS_AS(split_response("63,64,65,66,67", heights, 4), std::runtime_error);
+  }
+}
+
+TEST_CASE("Test unchecked access") {
+  SUBCASE("Chunk") {
+    std::vector<BlockType> blocks(3 * 4 * 5);
+    for (size_t i = 0; i < blocks.size(); i++) {
+      blocks[i] = BlockType(static_cast<int>(i));
+    }
+    Chunk chunk({-5, 60, 7}, {-3, 63, 11}, blocks);
+    CHECK_EQ(chunk.size(), blocks.size());
+    CHECK_EQ(chunk.x_stride(), 5);
+    CHECK_EQ(chunk.y_stride(), 3 * 5);
+    const BlockType* data = std::as_const(chunk).data();
+    for (int y = 0; y < chunk.y_len(); y++) {
+      for (int x = 0; x < chunk.x_len(); x++) {
+        for (int z = 0; z < chunk.z_len(); z++) {
+          BlockType block = chunk.get(x, y, z);
+          CHECK_EQ(chunk(x, y, z), block);
+          CHECK_EQ(chunk.at_unchecked(chunk.base_pt() + Coordinate(x, y, z)), block);
+          CHECK_EQ(data[(y * chunk.y_stride()) + (x * chunk.x_stride()) + z], block);
+        }
+      }
+    }
+  }
+
+  SUBCASE("HeightMap") {
+    std::vector<int16_t> values(4 * 3);
+    std::iota(values.begin(), values.end(), int16_t{-2});
+    HeightMap heights({-1, 9}, {2, 11}, values);
+    CHECK_EQ(heights.size(), values.size());
+    CHECK_EQ(heights.x_stride(), 3);
+    for (int x = 0; x < heights.x_len(); x++) {
+      for (int z = 0; z < heights.z_len(); z++) {
+        int16_t height = heights.get(x, z);
+        CHECK_EQ(heights(x, z), height);
+        CHECK_EQ(heights.at_unchecked(Coordinate2D(-1 + x, 9 + z)), height);
+        CHECK_EQ(heights.data()[(x * heights.x_stride()) + z], height);
+      }
+    }
+  }
+}
+
+TEST_CASE("Test block scan kernels") {
+  // Runs of a few blocks with odd mods, long enough for the 16-bit counters
+  // of the vector kernels to be flushed more than once
+  std::mt19937 gen(9);
+  std::uniform_int_distribution<int> pick(0, 5);
+  std::uniform_int_distribution<int> run(1, 40);
+  const BlockType palette[] = {Blocks::AIR,         Blocks::STONE,     BlockType(1, 3),
+                               Blocks::DIAMOND_ORE, BlockType(56, 20), BlockType(255, 15)};
+  std::vector<BlockType> blocks;
+  while (blocks.size() < 1100000) {
+    blocks.insert(blocks.end(), run(gen), palette[pick(gen)]);
+  }
+  blocks.resize(1100003);
+
+  std::vector<scan::Isa> isas{scan::Isa::Scalar};
+  if (scan::best_isa() != scan::Isa::Scalar) {
+    isas.push_back(scan::Isa::SSE2);
+  }
+  if (scan::best_isa() == scan::Isa::AVX2) {
+    isas.push_back(scan::Isa::AVX2);
+  }
+
+  for (scan::Isa isa : isas) {
+    CAPTURE(static_cast<int>(isa));
+    const scan::Kernels& kernels = scan::kernels(isa);
+    for (size_t n : {size_t{0}, size_t{7}, size_t{33}, blocks.size()}) {
+      CAPTURE(n);
+      for (uint16_t mask : {uint16_t{0xffff}, uint16_t{0x00ff}}) {
+        uint16_t value = scan::lane(Blocks::STONE) & mask;
+        size_t expected = 0;
+        size_t first = n;
+        for (size_t i = 0; i < n; i++) {
+          if ((scan::lane(blocks[i]) & mask) == value) {
+            first = std::min(first, i);
+            expected++;
+          }
+        }
+        CHECK_EQ(kernels.count(blocks.data(), n, value, mask), expected);
+        CHECK_EQ(kernels.find(blocks.data(), n, value, mask), first);
+
+        std::vector<BlockType> replaced(blocks.begin(), blocks.begin() + n);
+        std::vector<uint64_t> dirty((n + 63) / 64, 0);
+        size_t count =
+            kernels.replace(replaced.data(), n, value, mask, Blocks::GOLD_BLOCK, dirty.data());
+        CHECK_EQ(count, expected);
+        bool all_right = true;
+        for (size_t i = 0; i < n; i++) {
+          bool hit = (scan::lane(blocks[i]) & mask) == value;
+          bool marked = ((dirty[i / 64] >> (i % 64)) & 1) != 0;
+          all_right = all_right && hit == marked &&
+                      (hit ? replaced[i] == Blocks::GOLD_BLOCK : replaced[i] == blocks[i]);
+        }
+        CHECK(all_right);
+      }
+
+      std::vector<uint64_t> counts(scan::HISTOGRAM_SLOTS, 0);
+      std::vector<uint64_t> expected(scan::HISTOGRAM_SLOTS, 0);
+      kernels.histogram(blocks.data(), n, counts.data());
+      for (size_t i = 0; i < n; i++) {
+        const BlockType& block = blocks[i];
+        expected[block.mod < 16 ? (block.id * 16) + block.mod : scan::HISTOGRAM_SLOTS - 1]++;
+      }
+      CHECK(counts == expected);
+
+      std::vector<uint8_t> ids(n);
+      std::transform(blocks.begin(), blocks.begin() + n, ids.begin(),
+                     [](const BlockType& block) { return block.id; });
+      size_t first = std::find(ids.begin(), ids.end(), uint8_t{56}) - ids.begin();
+      CHECK_EQ(kernels.count_bytes(ids.data(), n, 56), std::count(ids.begin(), ids.end(), 56));
+      CHECK_EQ(kernels.find_bytes(ids.data(), n, 56), first);
+
+      // Sparse changes so most 32-block runs take the identical fast path
+      std::vector<BlockType> later(blocks.begin(), blocks.begin() + n);
+      for (size_t i = 5; i < n; i += 997) {
+        later[i] = Blocks::GOLD_BLOCK;
+      }
+      std::vector<uint64_t> changed((n + 63) / 64, 0);
+      size_t differ = kernels.diff(blocks.data(), later.data(), n, changed.data());
+      size_t expected_differ = 0;
+      bool all_marked = true;
+      for (size_t i = 0; i < n; i++) {
+        bool hit = !(blocks[i] == later[i]);
+        expected_differ += hit ? 1 : 0;
+        all_marked = all_marked && hit == (((changed[i / 64] >> (i % 64)) & 1) != 0);
+      }
+      CHECK_EQ(differ, expected_differ);
+      CHECK(all_marked);
+    }
+  }
+}
+
+TEST_CASE("Test Chunk scans") {
+  std::vector<BlockType> blocks(10 * 12 * 14, Blocks::STONE);
+  Chunk chunk({5, 60, -7}, {14, 71, 6}, blocks);
+  chunk.set(3, 4, 5, Blocks::DIAMOND_ORE);
+  chunk.set(9, 11, 13, Blocks::DIAMOND_ORE);
+  chunk.set(0, 2, 0, BlockType(1, 3));
+
+  CHECK_EQ(chunk.count(Blocks::DIAMOND_ORE), 2);
+  CHECK_EQ(chunk.count(Blocks::STONE), 10 * 12 * 14 - 3);
+  CHECK_EQ(chunk.count(Blocks::STONE, false), 10 * 12 * 14 - 2);
+  CHECK_EQ(chunk.find_first(Blocks::DIAMOND_ORE), Coordinate(8, 64, -2));
+  CHECK_EQ(chunk.find_first(BlockType(1, 7), false), Coordinate(5, 60, -7));
+  CHECK_FALSE(chunk.find_first(Blocks::GOLD_BLOCK).has_value());
+
+  BlockHistogram histogram = chunk.histogram();
+  CHECK_EQ(histogram.count(Blocks::DIAMOND_ORE), 2);
+  CHECK_EQ(histogram.count(BlockType(1, 3)), 1);
+  CHECK_EQ(histogram.other, 0);
+
+  size_t dirty = chunk.dirty_count();
+  CHECK_EQ(chunk.replace(Blocks::DIAMOND_ORE, Blocks::GOLD_BLOCK), 2);
+  CHECK_EQ(chunk.get(9, 11, 13), Blocks::GOLD_BLOCK);
+  CHECK_EQ(chunk.dirty_count(), dirty);
+  CHECK_EQ(chunk.replace(Blocks::STONE, Blocks::DIRT, false), 10 * 12 * 14 - 2);
+  CHECK_EQ(chunk.get(0, 2, 0), Blocks::DIRT);
+  CHECK_EQ(chunk.dirty_count(), 10 * 12 * 14);
+}
+
+TEST_CASE("Test Chunk diff") {
+  Chunk before({10, 20, 30}, {19, 24, 45}, std::vector<BlockType>(10 * 5 * 16, Blocks::STONE));
+  Chunk after = before;
+
+  SUBCASE("Shared and equal chunks have no changes") {
+    ChunkDiff changes = diff(before, after);
+    CHECK(changes.empty());
+    CHECK_EQ(changes.mask.size(), (before.size() + 63) / 64);
+    after.set(0, 0, 0, Blocks::STONE);
+    CHECK(diff(before, after).empty());
+  }
+
+  SUBCASE("Lists changes in iteration order with their new blocks") {
+    after.set_worldspace({19, 24, 45}, Blocks::GOLD_BLOCK);
+    after.set(3, 2, 1, Blocks::DIRT);
+    after.set(3, 2, 2, BlockType(1, 1));
+    ChunkDiff changes = diff(before, after);
+    REQUIRE_EQ(changes.size(), 3);
+    CHECK_EQ(changes.changes[0].pos, Coordinate(13, 22, 31));
+    CHECK_EQ(changes.changes[0].block, Blocks::DIRT);
+    CHECK_EQ(changes.changes[1].block, BlockType(1, 1));
+    CHECK_EQ(changes.changes[2].pos, Coordinate(19, 24, 45));
+    CHECK(changes.changed(before.size() - 1));
+    CHECK_FALSE(changes.changed(0));
+
+    // Refilling reuses the same ChunkDiff
+    after.set_worldspace({19, 24, 45}, Blocks::STONE);
+    diff(before, after, changes);
+    CHECK_EQ(changes.size(), 2);
+    CHECK_FALSE(changes.changed(before.size() - 1));
+  }
+
+  SUBCASE("Chunks over different areas") {
+    Chunk moved({11, 20, 30}, {20, 24, 45}, std::vector<BlockType>(10 * 5 * 16, Blocks::STONE));
+    CHECK_THROWS_AS(diff(before, moved), std::invalid_argument);
+  }
+}
+
+TEST_CASE("Test Chunk hashes") {
+  // Sections cut short at the far edges along every axis
+  std::mt19937 gen(11);
+  std::uniform_int_distribution<int> id(0, 3);
+  std::vector<BlockType> blocks(40 * 20 * 33);
+  for (BlockType& block : blocks) {
+    block = BlockType(id(gen));
+  }
+  Chunk before({0, 0, 0}, {39, 19, 32}, blocks);
+  const HashTree& tree = before.hashes();
+  CHECK_EQ(tree.section_count(), 3 * 2 * 3);
+  CHECK_EQ(tree.section_offset(4), Coordinate(16, 0, 16));
+  Chunk after = before;
+
+  SUBCASE("Equal blocks hash equally") {
+    Chunk rebuilt({0, 0, 0}, {39, 19, 32}, blocks);
+    CHECK_EQ(rebuilt.hashes().root(), before.hashes().root());
+    CHECK(changed_sections(before, rebuilt).empty());
+    CHECK(changed_sections(before, after).empty());
+  }
+
+  SUBCASE("Changes are found by section") {
+    after.set_worldspace({39, 19, 32}, Blocks::GOLD_BLOCK);
+    after.set(17, 3, 0, Blocks::GOLD_BLOCK);
+    CHECK_NE(after.hashes().root(), before.hashes().root());
+    std::vector<Coordinate> changed = changed_sections(before, after);
+    REQUIRE_EQ(changed.size(), 2);
+    CHECK_EQ(changed[0], Coordinate(16, 0, 0));
+    CHECK_EQ(changed[1], Coordinate(32, 16, 32));
+
+    // The original's tree is left alone by changes to the copy
+    CHECK_EQ(before.hashes().root(), Chunk({0, 0, 0}, {39, 19, 32}, blocks).hashes().root());
+
+    // Changing a block back restores the hash
+    after.set_worldspace({39, 19, 32}, before.get(39, 19, 32));
+    after.set(17, 3, 0, before.get(17, 3, 0));
+    CHECK_EQ(after.hashes().root(), before.hashes().root());
+  }
+
+  SUBCASE("Copies sharing a stale tree hash on separate threads") {
+    after.set(1, 1, 1, Blocks::GOLD_BLOCK);
+    std::vector<Chunk> snapshots(4, after);
+    std::vector<uint64_t> roots(snapshots.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < snapshots.size(); i++) {
+      threads.emplace_back([&, i] { roots[i] = snapshots[i].hashes().root(); });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    for (uint64_t root : roots) {
+      CHECK_EQ(root, after.hashes().root());
+    }
+    CHECK_NE(after.hashes().root(), before.hashes().root());
+  }
+
+  SUBCASE("Writes through iterators and replace") {
+    *(after.begin() + 5) = Blocks::GOLD_BLOCK;
+    CHECK_EQ(changed_sections(before, after), std::vector<Coordinate>{Coordinate(0, 0, 0)});
+    after.replace(BlockType(3), Blocks::GOLD_BLOCK);
+    CHECK_EQ(changed_sections(before, after).size(), tree.section_count());
+  }
+}
+
+TEST_CASE("Test tracer") {
+  Tracer::stop();
+  Tracer::clear();
+
+  SUBCASE("Disabled tracer records nothing") {
+    { TraceSpan span("encode"); }
+    CHECK_EQ(Tracer::event_count(), 0);
+  }
+
+  SUBCASE("Records spans while started") {
+    Tracer::start();
+    {
+      TraceSpan span("send");
+      span.set_bytes(42);
+    }
+    { TraceSpan span("wait"); }
+    Tracer::stop();
+    { TraceSpan span("receive"); }
+    CHECK_EQ(Tracer::event_count(), 2);
+  }
+
+  SUBCASE("Writes chrome trace json") {
+    Tracer::start();
+    {
+      TraceSpan span("parse");
+      span.set_bytes(7);
+    }
+    Tracer::stop();
+
+    std::stringstream ss;
+    Tracer::write_chrome_json(ss);
+    std::string json = ss.str();
+    CHECK_EQ(json.rfind("{\"traceEvents\":[", 0), 0);
+    CHECK_NE(json.find("\"name\":\"parse\""), std::string::npos);
+    CHECK_NE(json.find("\"ph\":\"X\""), std::string::npos);
+    CHECK_NE(json.find("\"args\":{\"bytes\":7}"), std::string::npos);
+  }
+
+  SUBCASE("Compile-time instrumentation profile") {
+    Chunk chunk({0, 0, 0}, {1, 1, 1}, std::vector<BlockType>(8, Blocks::STONE));
+    std::vector<ProfileEntry> profile = Tracer::profile();
+    if (Tracer::instrumented()) {
+      auto it = std::find_if(profile.begin(), profile.end(),
+                             [](const ProfileEntry& e) { return e.name == "chunk_blocks"; });
+      REQUIRE(it != profile.end());
+      CHECK(it->is_counter);
+      CHECK_EQ(it->calls, 1);
+      CHECK_EQ(it->total, 8);
+    } else {
+      CHECK(profile.empty());
+    }
+  }
+
+  SUBCASE("Exited threads keep their profile") {
+    // Thread churn, each thread's buffer is merged and recycled on exit
+    for (int i = 0; i < 20; i++) {
+      std::thread([] {
+        Chunk chunk({0, 0, 0}, {1, 1, 1}, std::vector<BlockType>(8, Blocks::STONE));
+      }).join();
+    }
+    std::vector<ProfileEntry> profile = Tracer::profile();
+    if (Tracer::instrumented()) {
+      auto it = std::find_if(profile.begin(), profile.end(),
+                             [](const ProfileEntry& e) { return e.name == "chunk_blocks"; });
+      REQUIRE(it != profile.end());
+      CHECK_EQ(it->calls, 20);
+      CHECK_EQ(it->total, 160);
+      std::ostringstream json;
+      Tracer::write_chrome_json(json);
+      CHECK_NE(json.str().find("chunk_construct"), std::string::npos);
+    } else {
+      CHECK(profile.empty());
+    }
+  }
+
+  Tracer::clear();
+}
+
+TEST_CASE("Test world cache") {
+  // One section of stone with a gold block at its origin
+  auto section = [](const Coordinate& origin) {
+    std::vector<BlockType> blocks(WorldCache::SECTION_VOLUME, Blocks::STONE);
+    blocks[0] = Blocks::GOLD_BLOCK;
+    return Chunk(origin, origin + Coordinate(15, 15, 15), blocks);
+  };
+  const size_t section_bytes = WorldCache::SECTION_VOLUME * sizeof(BlockType);
+
+  SUBCASE("Section origins floor negative coordinates") {
+    CHECK_EQ(WorldCache::section_origin({17, 0, 15}), Coordinate(16, 0, 0));
+    CHECK_EQ(WorldCache::section_origin({-1, -64, -17}), Coordinate(-16, -64, -32));
+  }
+
+  SUBCASE("Hits after insert and reads across sections") {
+    WorldCache cache(CacheOptions{});
+    CHECK_FALSE(cache.get({0, 0, 0}).has_value());
+    cache.insert(section({0, 0, 0}));
+    cache.insert(section({0, 0, 16}));
+    CHECK_EQ(*cache.get({0, 0, 0}), Blocks::GOLD_BLOCK);
+    CHECK_EQ(*cache.get({3, 4, 5}), Blocks::STONE);
+
+    CHECK(cache.missing({10, 0, 10}, {12, 2, 20}).empty());
+    CHECK_EQ(cache.missing({0, 0, 0}, {0, 0, 32}), std::vector<Coordinate>{{0, 0, 32}});
+    Chunk chunk = cache.read({0, 0, 0}, {1, 1, 17});
+    CHECK_EQ(chunk.get(0, 0, 0), Blocks::GOLD_BLOCK);
+    CHECK_EQ(chunk.get(0, 0, 16), Blocks::GOLD_BLOCK);
+    CHECK_EQ(chunk.get(1, 1, 17), Blocks::STONE);
+  }
+
+  SUBCASE("Write-through updates cached blocks") {
+    WorldCache cache(CacheOptions{});
+    cache.insert(section({0, 0, 0}));
+    cache.write({1, 1, 1}, Blocks::DIRT);
+    cache.write({100, 1, 1}, Blocks::DIRT);
+    cache.fill({-5, 2, 2}, {3, 2, 40}, Blocks::AIR);
+    CHECK_EQ(*cache.get({1, 1, 1}), Blocks::DIRT);
+    CHECK_EQ(*cache.get({0, 2, 15}), Blocks::AIR);
+    CHECK_EQ(*cache.get({4, 2, 2}), Blocks::STONE);
+    CHECK_EQ(cache.stats().sections, 1);
+  }
+
+  SUBCASE("Evicts least recently used sections") {
+    CacheOptions options;
+    options.max_bytes = 2 * section_bytes + 2 * sizeof(void*) * 64;
+    WorldCache cache(options);
+    cache.insert(section({0, 0, 0}));
+    cache.insert(section({16, 0, 0}));
+    CHECK(cache.get({0, 0, 0}).has_value());
+    cache.insert(section({32, 0, 0}));
+
+    CHECK_EQ(cache.stats().evictions, 1);
+    CHECK(cache.get({0, 0, 0}).has_value());
+    CHECK_FALSE(cache.get({16, 0, 0}).has_value());
+    CHECK(cache.fits({0, 0, 0}, {31, 15, 15}));
+    CHECK_FALSE(cache.fits({0, 0, 0}, {47, 15, 15}));
+  }
+
+  SUBCASE("Sections expire after their ttl") {
+    CacheOptions options;
+    options.ttl = std::chrono::milliseconds(1);
+    WorldCache cache(options);
+    cache.insert(section({0, 0, 0}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    CHECK_FALSE(cache.get({0, 0, 0}).has_value());
+    CHECK_EQ(cache.stats().sections, 0);
+  }
+}
+
+TEST_CASE("Test shadow state") {
+  ShadowState shadow;
+
+  SUBCASE("Remembers reads and writes") {
+    CHECK_FALSE(shadow.get({1, 2, 3}).has_value());
+    shadow.observe({1, 2, 3}, Blocks::STONE);
+    shadow.write({-1, -2, -3}, Blocks::DIRT);
+    CHECK_EQ(*shadow.get({1, 2, 3}), Blocks::STONE);
+    CHECK_EQ(*shadow.get({-1, -2, -3}), Blocks::DIRT);
+    CHECK_FALSE(shadow.get({1, 2, 4}).has_value());
+
+    std::vector<BlockType> blocks(2 * 2 * 20, Blocks::SAND);
+    Chunk sand({10, 0, 10}, {11, 1, 29}, blocks);
+    shadow.observe(sand);
+    CHECK_EQ(*shadow.get({11, 1, 29}), Blocks::SAND);
+  }
+
+  SUBCASE("Matches only fully known boxes") {
+    shadow.fill({0, 0, 0}, {20, 1, 20}, Blocks::STONE);
+    CHECK(shadow.matches({0, 0, 0}, {20, 1, 20}, Blocks::STONE));
+    CHECK(shadow.matches({5, 1, 5}, {18, 1, 18}, Blocks::STONE));
+    CHECK_FALSE(shadow.matches({0, 0, 0}, {20, 2, 20}, Blocks::STONE));
+    shadow.write({17, 0, 17}, Blocks::DIRT);
+    CHECK_FALSE(shadow.matches({0, 0, 0}, {20, 1, 20}, Blocks::STONE));
+  }
+
+  SUBCASE("Large fills forget instead of recording") {
+    shadow.write({0, 0, 0}, Blocks::STONE);
+    shadow.fill({-200, -60, -200}, {200, 60, 200}, Blocks::AIR);
+    CHECK_FALSE(shadow.get({0, 0, 0}).has_value());
+  }
+
+  SUBCASE("Keeps known heights current") {
+    shadow.observe_height({5, 5}, 10);
+    CHECK_FALSE(shadow.height({5, 6}).has_value());
+
+    shadow.write({5, 12, 5}, Blocks::STONE);
+    CHECK_EQ(*shadow.height({5, 5}), 12);
+    shadow.write({5, 11, 5}, Blocks::AIR);
+    CHECK_EQ(*shadow.height({5, 5}), 12);
+
+    // Clearing the top walks down through the known blocks
+    shadow.observe({5, 10, 5}, Blocks::STONE);
+    shadow.write({5, 12, 5}, Blocks::AIR);
+    CHECK_EQ(*shadow.height({5, 5}), 10);
+
+    // Unknown block below the cleared top
+    shadow.fill({5, 10, 5}, {5, 10, 5}, Blocks::AIR);
+    CHECK_FALSE(shadow.height({5, 5}).has_value());
+  }
+
+  SUBCASE("Builds height maps of known columns") {
+    shadow.observe(HeightMap({0, 0}, {1, 2}, {1, 2, 3, 4, 5, 6}));
+    std::optional<HeightMap> heights = shadow.heights({1, 2}, {0, 0});
+    REQUIRE(heights.has_value());
+    CHECK_EQ(heights->get(1, 2), 6);
+    CHECK_EQ(heights->base_pt(), Coordinate2D(0, 0));
+    CHECK_FALSE(shadow.heights({0, 0}, {2, 2}).has_value());
+  }
+}
+
+TEST_CASE("Test VoxelWorld") {
+  VoxelWorld world;
+
+  SUBCASE("Get and set in world space") {
+    CHECK_EQ(world.get({5, -70, 20000}), Blocks::AIR);
+    world.set({5, -70, 20000}, Blocks::STONE);
+    world.set({-1, -1, -1}, Blocks::DIRT);
+    CHECK_EQ(world.get({5, -70, 20000}), Blocks::STONE);
+    CHECK_EQ(world.get({-1, -1, -1}), Blocks::DIRT);
+    CHECK_EQ(world.get({0, 0, 0}), Blocks::AIR);
+    CHECK_EQ(world.sections().size(), 2);
+    CHECK_EQ(world.sections().count(VoxelWorld::section_of({-1, -1, -1})), 1);
+    CHECK_EQ(VoxelWorld::section_of({-1, -16, -17}), Coordinate(-1, -1, -2));
+
+    // Sections cleared back to air are dropped
+    world.set({-1, -1, -1}, Blocks::AIR);
+    CHECK_EQ(world.sections().size(), 1);
+  }
+
+  SUBCASE("Memory scales with content") {
+    for (int i = 0; i < 100; i++) {
+      world.set({i * 200, 64, i * 200}, Blocks::GOLD_BLOCK);
+    }
+    CHECK_EQ(world.sections().size(), 100);
+    CHECK_LT(world.memory_usage(), 100 * VoxelWorld::SECTION_VOLUME * sizeof(BlockType) * 2);
+  }
+
+  SUBCASE("Chunk import collapses uniform sections") {
+    std::vector<BlockType> blocks(32 * 20 * 32, Blocks::STONE);
+    // Air above y = 16, a single gold block in the lowest sections
+    for (size_t i = 16 * 32 * 32; i < blocks.size(); i++) {
+      blocks[i] = Blocks::AIR;
+    }
+    blocks[0] = Blocks::GOLD_BLOCK;
+    Chunk chunk({0, 0, 0}, {31, 19, 31}, blocks);
+    world.import_chunk(chunk);
+
+    CHECK_EQ(world.sections().size(), 4);
+    int uniform = 0;
+    for (const auto& [key, section] : world.sections()) {
+      uniform += section.is_uniform() ? 1 : 0;
+      CHECK_EQ(key.y, 0);
+    }
+    CHECK_EQ(uniform, 3);
+    CHECK_EQ(world.get({0, 0, 0}), Blocks::GOLD_BLOCK);
+    CHECK_EQ(world.get({31, 15, 31}), Blocks::STONE);
+    CHECK_EQ(world.get({31, 16, 31}), Blocks::AIR);
+
+    // Writes into a uniform section expand it, compact collapses it again
+    world.set({20, 3, 20}, Blocks::DIRT);
+    world.set({20, 3, 20}, Blocks::STONE);
+    world.compact();
+    uniform = 0;
+    for (const auto& [key, section] : world.sections()) {
+      uniform += section.is_uniform() ? 1 : 0;
+    }
+    CHECK_EQ(uniform, 3);
+  }
+
+  SUBCASE("Chunk export round trips") {
+    std::vector<BlockType> blocks;
+    for (int i = 0; i < 7 * 5 * 19; i++) {
+      blocks.push_back(BlockType(i % 5));
+    }
+    Chunk chunk({-3, 60, -10}, {3, 64, 8}, blocks);
+    VoxelWorld imported(chunk);
+    Chunk exported = imported.export_chunk({3, 64, 8}, {-3, 60, -10});
+    CHECK_EQ(exported.base_pt(), chunk.base_pt());
+    CHECK(std::equal(chunk.cbegin(), chunk.cend(), exported.cbegin()));
+
+    Chunk larger = imported.export_chunk({-4, 60, -10}, {3, 64, 8});
+    CHECK_EQ(larger.get(0, 0, 0), Blocks::AIR);
+    CHECK_EQ(larger.get(1, 0, 1), chunk.get(0, 0, 1));
+  }
+
+  SUBCASE("Changed sections") {
+    VoxelWorld other;
+    world.set({0, 0, 0}, Blocks::STONE);
+    world.set({40, 0, 0}, Blocks::STONE);
+    other.set({0, 0, 0}, Blocks::STONE);
+    other.set({-1, 0, 0}, Blocks::STONE);
+    std::vector<Coordinate> changed = world.changed_sections(other);
+    std::sort(changed.begin(), changed.end(), [](const Coordinate& a, const Coordinate& b) {
+      return a.x < b.x;
+    });
+    CHECK_EQ(changed, std::vector<Coordinate>{{-1, 0, 0}, {2, 0, 0}});
+
+    // Uniform and expanded sections with the same blocks hash equally
+    Coordinate origin = VoxelWorld::section_origin({5, 5, 5});
+    world.import_chunk(Chunk(origin, origin + Coordinate(15, 15, 15),
+                             std::vector<BlockType>(VoxelWorld::SECTION_VOLUME, Blocks::DIRT)));
+    for (int y = 0; y < 16; y++) {
+      for (int x = 0; x < 16; x++) {
+        for (int z = 0; z < 16; z++) {
+          other.set(origin + Coordinate(x, y, z), Blocks::DIRT);
+        }
+      }
+    }
+    CHECK(world.sections().at({5, 5, 5}).is_uniform());
+    CHECK_FALSE(other.sections().at({5, 5, 5}).is_uniform());
+    CHECK_EQ(world.changed_sections(other).size(), 2);
+
+    other.set(origin, Blocks::STONE);
+    CHECK_EQ(world.changed_sections(other).size(), 3);
+  }
+}
+
+TEST_CASE("Test PalettedChunk") {
+  auto make_chunk = [](int distinct) {
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int> pick(0, distinct - 1);
+    std::vector<BlockType> blocks(20 * 33 * 18);
+    for (BlockType& block : blocks) {
+      int v = pick(gen);
+      block = BlockType(v % 256, v / 256);
+    }
+    return Chunk({-5, 10, 3}, {14, 42, 20}, blocks);
+  };
+
+  SUBCASE("Round trips for every index width") {
+    for (int distinct : {1, 2, 16, 17, 100, 256, 300, 2000}) {
+      Chunk chunk = make_chunk(distinct);
+      PalettedChunk paletted(chunk);
+      CHECK_EQ(paletted.x_len(), chunk.x_len());
+      CHECK_EQ(paletted.base_pt(), chunk.base_pt());
+      CHECK(std::equal(chunk.cbegin(), chunk.cend(), paletted.begin()));
+      CHECK_EQ(paletted.get(19, 32, 17), chunk.get(19, 32, 17));
+      CHECK_EQ(paletted.get_worldspace({0, 20, 10}), chunk.get_worldspace({0, 20, 10}));
+
+      Chunk back = paletted.to_chunk();
+      CHECK_EQ(back.base_pt(), chunk.base_pt());
+      CHECK(std::equal(chunk.cbegin(), chunk.cend(), back.cbegin()));
+    }
+  }
+
+  SUBCASE("Compresses small palettes") {
+    Chunk chunk = make_chunk(16);
+    size_t dense = static_cast<size_t>(chunk.x_len()) * chunk.y_len() * chunk.z_len() *
+                   sizeof(BlockType);
+    CHECK_LT(PalettedChunk(chunk).memory_usage(), dense / 3);
+    CHECK_LT(PalettedChunk(make_chunk(1)).memory_usage(), dense / 20);
+  }
+
+  SUBCASE("Bounds checking") {
+    PalettedChunk paletted(make_chunk(4));
+    CHECK_THROWS(paletted.get(20, 0, 0));
+    CHECK_THROWS(paletted.get(0, -1, 0));
+    CHECK_THROWS(paletted.get_worldspace({-6, 10, 3}));
+  }
+}
+
+TEST_CASE("Test Octree") {
+  // Terrain up to y = 4 with scattered blocks in the sky above it
+  std::mt19937 gen(7);
+  std::uniform_int_distribution<int> id(1, 5);
+  std::bernoulli_distribution sky_block(0.002);
+  Coordinate base(-10, 60, 5);
+  std::vector<BlockType> blocks;
+  for (int y = 0; y < 70; y++) {
+    for (int x = 0; x < 20; x++) {
+      for (int z = 0; z < 33; z++) {
+        bool solid = y < 4 || (y > 10 && sky_block(gen));
+        blocks.push_back(solid ? BlockType(id(gen)) : Blocks::AIR);
+      }
+    }
+  }
+  Chunk chunk(base, base + Coordinate(19, 69, 32), blocks);
+  Octree tree(chunk);
+
+  SUBCASE("Point lookup matches the chunk") {
+    int mismatches = 0;
+    for (int y = 0; y < 70; y++) {
+      for (int x = 0; x < 20; x++) {
+        for (int z = 0; z < 33; z++) {
+          mismatches += tree.get(x, y, z) != chunk.get(x, y, z) ? 1 : 0;
+        }
+      }
+    }
+    CHECK_EQ(mismatches, 0);
+    CHECK_EQ(tree.get_worldspace(base + Coordinate(1, 2, 3)), chunk.get(1, 2, 3));
+    CHECK_THROWS(tree.get(20, 0, 0));
+    CHECK_THROWS(tree.get_worldspace(base - Coordinate(1, 0, 0)));
+  }
+
+  SUBCASE("Air collapses") {
+    size_t volume = blocks.size();
+    CHECK_LT(tree.node_count(), volume / 4);
+    Octree empty(Chunk(base, base + Coordinate(99, 99, 99), std::vector<BlockType>(1000000)));
+    CHECK_EQ(empty.node_count(), 1);
+  }
+
+  SUBCASE("Region iteration visits only non-air blocks") {
+    Coordinate loc1 = base + Coordinate(3, 2, 30);
+    Coordinate loc2 = base + Coordinate(15, 50, 4);
+    size_t expected = 0;
+    for (int y = 2; y <= 50; y++) {
+      for (int x = 3; x <= 15; x++) {
+        for (int z = 4; z <= 30; z++) {
+          expected += chunk.get(x, y, z) != Blocks::AIR ? 1 : 0;
+        }
+      }
+    }
+    size_t visited = 0;
+    tree.for_each_block(loc1, loc2, [&](const Coordinate& pos, BlockType block) {
+      CHECK_NE(block, Blocks::AIR);
+      CHECK_EQ(block, chunk.get_worldspace(pos));
+      visited++;
+    });
+    CHECK_EQ(visited, expected);
+  }
+
+  SUBCASE("Reconstructs the dense chunk") {
+    Chunk back = tree.to_chunk();
+    CHECK_EQ(back.base_pt(), base);
+    CHECK_EQ(back.y_len(), 70);
+    CHECK(std::equal(chunk.cbegin(), chunk.cend(), back.cbegin()));
+  }
+}
+
+TEST_CASE("Test StaticChunk") {
+  using Board = StaticChunk<3, 2, 4>;
+  static_assert(Board::size() == 24 && Board::y_stride() == 12 && Board::x_stride() == 4);
+
+  Board board({10, 20, 30}, Blocks::STONE);
+  board.set(2, 1, 3, Blocks::GOLD_BLOCK);
+  board.set_worldspace({10, 20, 31}, Blocks::DIRT);
+  board(1, 0, 0) = Blocks::GRASS;
+  CHECK_EQ(board.get(2, 1, 3), Blocks::GOLD_BLOCK);
+  CHECK_EQ(board.get_worldspace({12, 21, 33}), Blocks::GOLD_BLOCK);
+  CHECK_EQ(board.at_unchecked({10, 20, 31}), Blocks::DIRT);
+  CHECK_EQ(board.data()[4], Blocks::GRASS);
+  CHECK_THROWS_AS(board.get(3, 0, 0), std::out_of_range);
+  CHECK_THROWS_AS(board.get_worldspace({10, 19, 30}), std::out_of_range);
+
+  Chunk chunk = board.to_chunk();
+  CHECK_EQ(chunk.base_pt(), board.base_pt());
+  CHECK_EQ(chunk.y_len(), 2);
+  CHECK(std::equal(board.begin(), board.end(), chunk.cbegin(), chunk.cend()));
+
+  ChunkView view = board.view();
+  CHECK_EQ(view.get(2, 1, 3), Blocks::GOLD_BLOCK);
+  CHECK_EQ(view.layer(1).get_worldspace({12, 21, 33}), Blocks::GOLD_BLOCK);
+}
+
+TEST_CASE_TEMPLATE("Test LayoutChunk", Layout, LinearLayout, BrickedLayout, MortonLayout) {
+  // Lengths that are not multiples of a brick or powers of two
+  std::mt19937 gen(8);
+  std::uniform_int_distribution<int> id(0, 255);
+  std::vector<BlockType> blocks(13 * 21 * 9);
+  for (BlockType& block : blocks) {
+    block = BlockType(id(gen));
+  }
+  Chunk chunk({4, -20, 7}, {-8, 0, 15}, blocks);
+  LayoutChunk<Layout> laid_out(chunk);
+
+  SUBCASE("Hides the layout from accessors and iterators") {
+    CHECK_EQ(laid_out.base_pt(), chunk.base_pt());
+    CHECK_EQ(laid_out.x_len(), 13);
+    CHECK(std::equal(chunk.cbegin(), chunk.cend(), laid_out.begin(), laid_out.end()));
+    for (int y = 0; y < chunk.y_len(); y++) {
+      for (int x = 0; x < chunk.x_len(); x++) {
+        for (int z = 0; z < chunk.z_len(); z++) {
+          REQUIRE_EQ(laid_out.get(x, y, z), chunk.get(x, y, z));
+        }
+      }
+    }
+    CHECK_EQ(laid_out.get_worldspace({-8, -20, 7}), chunk.get(0, 0, 0));
+    CHECK_THROWS_AS(laid_out.get(13, 0, 0), std::out_of_range);
+  }
+
+  SUBCASE("Set and round trip") {
+    laid_out.set(12, 20, 8, Blocks::GOLD_BLOCK);
+    laid_out.set_worldspace({-8, -20, 7}, Blocks::DIAMOND_BLOCK);
+    Chunk back = laid_out.to_chunk();
+    CHECK_EQ(back.base_pt(), chunk.base_pt());
+    CHECK_EQ(back.get(12, 20, 8), Blocks::GOLD_BLOCK);
+    CHECK_EQ(back.get(0, 0, 0), Blocks::DIAMOND_BLOCK);
+    CHECK_EQ(back.get(5, 5, 5), chunk.get(5, 5, 5));
+  }
+
+  SUBCASE("Fill constructor") {
+    LayoutChunk<Layout> filled({0, 0, 0}, {2, 3, 4}, Blocks::STONE);
+    CHECK_EQ(std::count(filled.begin(), filled.end(), Blocks::STONE), 3 * 4 * 5);
+  }
+}
+
+TEST_CASE_TEMPLATE("Test StorageChunk", Storage, AosStorage, SoaStorage, IdOnlyStorage) {
+  std::mt19937 gen(10);
+  std::uniform_int_distribution<int> pick(0, 3);
+  const BlockType palette[] = {Blocks::AIR, Blocks::STONE, BlockType(1, 3), BlockType(56)};
+  std::vector<BlockType> blocks(13 * 21 * 9);
+  for (BlockType& block : blocks) {
+    block = palette[pick(gen)];
+  }
+  // Id-only storage reads every mod back as 0
+  bool keeps_mods = !std::is_same_v<Storage, IdOnlyStorage>;
+  auto stored = [&](BlockType block) { return keeps_mods ? block : BlockType(block.id); };
+
+  Chunk chunk({4, -20, 7}, {-8, 0, 15}, blocks);
+  StorageChunk<Storage> stored_chunk(chunk);
+
+  SUBCASE("Accessors, iterators and round trip") {
+    CHECK_EQ(stored_chunk.base_pt(), chunk.base_pt());
+    CHECK_EQ(stored_chunk.z_len(), 9);
+    CHECK_EQ(stored_chunk.get(3, 4, 5), stored(chunk.get(3, 4, 5)));
+    CHECK_EQ(stored_chunk.get_worldspace({-8, -20, 7}), stored(chunk.get(0, 0, 0)));
+    CHECK_THROWS_AS(stored_chunk.get(0, 21, 0), std::out_of_range);
+
+    stored_chunk.set(12, 20, 8, Blocks::GOLD_BLOCK);
+    stored_chunk.set_worldspace({-8, -20, 7}, Blocks::DIAMOND_BLOCK);
+    Chunk back = stored_chunk.to_chunk();
+    CHECK_EQ(back.get(12, 20, 8), Blocks::GOLD_BLOCK);
+    CHECK_EQ(back.get(0, 0, 0), Blocks::DIAMOND_BLOCK);
+    CHECK(std::equal(back.cbegin(), back.cend(), stored_chunk.begin(), stored_chunk.end()));
+    CHECK_EQ(back.get(5, 5, 5), stored(chunk.get(5, 5, 5)));
+  }
+
+  SUBCASE("Count and find") {
+    for (const BlockType& block : palette) {
+      for (bool match_mod : {true, false}) {
+        CAPTURE(block);
+        CAPTURE(match_mod);
+        auto matches = [&](const BlockType& other) {
+          BlockType kept = stored(other);
+          return match_mod ? kept == block : kept.id == block.id;
+        };
+        CHECK_EQ(stored_chunk.count(block, match_mod),
+                 std::count_if(blocks.begin(), blocks.end(), matches));
+        std::optional<Coordinate> expected;
+        for (const Chunk::Cell& cell : chunk.cells()) {
+          if (matches(cell.block)) {
+            expected = cell.pos;
+            break;
+          }
+        }
+        CHECK_EQ(stored_chunk.find_first(block, match_mod), expected);
+      }
+    }
+    CHECK_FALSE(stored_chunk.find_first(Blocks::GOLD_BLOCK).has_value());
+  }
+
+  SUBCASE("Fill constructor") {
+    StorageChunk<Storage> filled({0, 0, 0}, {2, 3, 4}, Blocks::STONE);
+    CHECK_EQ(filled.count(Blocks::STONE), 3 * 4 * 5);
+    CHECK_EQ(filled.storage().bytes(), 3 * 4 * 5 * (keeps_mods ? 2 : 1));
+  }
+}
+
+TEST_CASE("Test views") {
+  std::vector<BlockType> blocks(6 * 5 * 4);
+  for (size_t i = 0; i < blocks.size(); i++) {
+    blocks[i] = BlockType(static_cast<int>(i));
+  }
+  Chunk chunk({10, 20, 30}, {15, 24, 33}, blocks);
+
+  SUBCASE("Whole chunk") {
+    ChunkView view(chunk);
+    CHECK_EQ(view.base_pt(), chunk.base_pt());
+    CHECK_EQ(view.y_stride(), 6 * 4);
+    CHECK(std::equal(chunk.cbegin(), chunk.cend(), view.begin(), view.end()));
+    CHECK_EQ(view.get(5, 4, 3), chunk.get(5, 4, 3));
+    CHECK_THROWS_AS(view.get(6, 0, 0), std::out_of_range);
+  }
+
+  SUBCASE("Slices of slices") {
+    ChunkView box = ChunkView(chunk).slice({14, 21, 31}, {11, 23, 33});
+    CHECK_EQ(box.base_pt(), Coordinate(11, 21, 31));
+    CHECK_EQ(box.x_len(), 4);
+    CHECK_EQ(box.y_len(), 3);
+    CHECK_EQ(box.z_len(), 3);
+    CHECK_EQ(box.get(0, 0, 0), chunk.get_worldspace({11, 21, 31}));
+    CHECK_EQ(box.get_worldspace({14, 23, 33}), chunk.get_worldspace({14, 23, 33}));
+    CHECK_THROWS_AS(box.get_worldspace({10, 21, 31}), std::out_of_range);
+    CHECK_THROWS_AS(box.slice({10, 21, 31}, {12, 22, 32}), std::out_of_range);
+
+    ChunkView layer = box.layer(1);
+    CHECK_EQ(layer.y_len(), 1);
+    CHECK_EQ(layer.base_pt(), Coordinate(11, 22, 31));
+    std::vector<BlockType> expected;
+    for (int x = 11; x <= 14; x++) {
+      for (int z = 31; z <= 33; z++) {
+        expected.push_back(chunk.get_worldspace({x, 22, z}));
+      }
+    }
+    CHECK(std::equal(expected.begin(), expected.end(), layer.begin(), layer.end()));
+
+    Chunk copy = layer.slice({12, 22, 32}, {13, 22, 33}).to_chunk();
+    CHECK_EQ(copy.base_pt(), Coordinate(12, 22, 32));
+    CHECK_EQ(copy.get(1, 0, 1), chunk.get_worldspace({13, 22, 33}));
+  }
+
+  SUBCASE("Height maps") {
+    std::vector<int16_t> heights(7 * 5);
+    for (size_t i = 0; i < heights.size(); i++) {
+      heights[i] = static_cast<int16_t>(i);
+    }
+    HeightMap map({-3, 4}, {3, 8}, heights);
+    HeightMapView view(map);
+    CHECK(std::equal(map.begin(), map.end(), view.begin(), view.end()));
+
+    HeightMapView part = view.slice({1, 7}, {-1, 5});
+    CHECK_EQ(part.base_pt(), Coordinate2D(-1, 5));
+    CHECK_EQ(part.x_len(), 3);
+    CHECK_EQ(part.get(2, 2), map.get_worldspace({1, 7}));
+    Coordinate pos(0, 0, 6);
+    part.fill_coord(pos);
+    CHECK_EQ(pos.y, map.get_worldspace({0, 6}));
+    CHECK_THROWS_AS(part.get_worldspace({2, 5}), std::out_of_range);
+
+    HeightMap copy = part.to_heightmap();
+    CHECK_EQ(copy.base_pt(), Coordinate2D(-1, 5));
+    CHECK(std::equal(part.begin(), part.end(), copy.begin(), copy.end()));
+  }
+}
+
+TEST_CASE("Test parallel algorithms") {
+  // More threads than this machine may have, so the tasks really interleave
+  ThreadPool pool(4);
+  std::mt19937 gen(10);
+  std::uniform_int_distribution<int> id(0, 20);
+  std::vector<BlockType> blocks(30 * 17 * 25);
+  for (BlockType& block : blocks) {
+    block = BlockType(id(gen));
+  }
+  Chunk chunk({0, 0, 0}, {29, 16, 24}, blocks);
+  auto is_ore = [](const BlockType& block) { return block.id == 14 || block.id == 15; };
+  auto expected = static_cast<size_t>(std::count_if(chunk.cbegin(), chunk.cend(), is_ore));
+
+  SUBCASE("Random-access iterators") {
+    auto it = chunk.begin();
+    it += 100;
+    CHECK_EQ(it - chunk.begin(), 100);
+    CHECK_EQ(it[5], blocks[105]);
+    CHECK_EQ(*(it - 100), blocks[0]);
+    CHECK(chunk.begin() < it);
+    CHECK_EQ(static_cast<size_t>(chunk.end() - chunk.begin()), blocks.size());
+
+    const Chunk& const_chunk = chunk;
+    CHECK_EQ(*(const_chunk.end() - 1), blocks.back());
+    std::sort(chunk.begin(), chunk.end(),
+              [](const BlockType& a, const BlockType& b) { return a.id < b.id; });
+    CHECK(std::is_sorted(const_chunk.begin(), const_chunk.end(),
+                         [](const BlockType& a, const BlockType& b) { return a.id < b.id; }));
+  }
+
+  SUBCASE("for_each, transform and reduce") {
+    std::atomic<size_t> ores{0};
+    parallel_for_each(
+        chunk.cbegin(), chunk.cend(), [&](const BlockType& block) { ores += is_ore(block); }, pool);
+    CHECK_EQ(ores.load(), expected);
+
+    std::vector<int> ids(blocks.size());
+    parallel_transform(
+        chunk.cbegin(), chunk.cend(), ids.begin(), [](const BlockType& block) { return block.id; },
+        pool);
+    CHECK_EQ(ids[1234], blocks[1234].id);
+
+    size_t reduced = parallel_reduce(
+        chunk.cbegin(), chunk.cend(), size_t{0}, std::plus<>(),
+        [&](const BlockType& block) { return is_ore(block) ? size_t{1} : size_t{0}; }, pool);
+    CHECK_EQ(reduced, expected);
+    CHECK_EQ(parallel_reduce(ids.begin(), ids.end(), 0, std::plus<>(), pool),
+             std::accumulate(ids.begin(), ids.end(), 0));
+  }
+
+  SUBCASE("Layers and tiles") {
+    std::atomic<size_t> ores{0};
+    std::atomic<int> layers{0};
+    parallel_for_layers(
+        chunk,
+        [&](const ChunkView& layer) {
+          ores += static_cast<size_t>(std::count_if(layer.begin(), layer.end(), is_ore));
+          layers++;
+        },
+        pool);
+    CHECK_EQ(ores.load(), expected);
+    CHECK_EQ(layers.load(), 17);
+
+    std::vector<int16_t> heights(50 * 37);
+    std::iota(heights.begin(), heights.end(), 0);
+    HeightMap map({-10, 5}, {39, 41}, heights);
+    std::atomic<long> sum{0};
+    std::atomic<int> tiles{0};
+    parallel_for_tiles(
+        map, 16,
+        [&](const HeightMapView& tile) {
+          sum += std::accumulate(tile.begin(), tile.end(), 0L);
+          tiles++;
+        },
+        pool);
+    CHECK_EQ(sum.load(), std::accumulate(heights.begin(), heights.end(), 0L));
+    CHECK_EQ(tiles.load(), 4 * 3);
+    CHECK_THROWS_AS(parallel_for_tiles(map, 0, [](const HeightMapView&) {}, pool),
+                    std::invalid_argument);
+  }
+
+  SUBCASE("Exceptions reach the caller") {
+    CHECK_THROWS_AS(pool.run(64,
+                             [](size_t i) {
+                               if (i == 40) {
+                                 throw std::runtime_error("task failed");
+                               }
+                             }),
+                    std::runtime_error);
+    // Still usable afterwards, and from inside its own tasks
+    std::atomic<int> calls{0};
+    pool.run(8, [&](size_t) { pool.run(8, [&](size_t) { calls++; }); });
+    CHECK_EQ(calls.load(), 64);
+  }
+}
+
 // NOLINTEND
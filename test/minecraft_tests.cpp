@@ -417,6 +417,197 @@ TEST_CASE("HeightMap functionality") {
   mc.setBlocks(Coordinate{200, 300, 200}, Coordinate{210, 301, 210}, Blocks::AIR);
 }
 
+TEST_CASE("Client-side block cache") {
+  MinecraftConnection cached;
+  cached.enableCache();
+  Coordinate loc1{200, 100, 200};
+  Coordinate loc2{220, 104, 210};
+  mc.setBlocks(loc1, loc2, Blocks::STONE);
+  mc.setBlock(loc1, Blocks::GOLD_BLOCK);
+  Chunk expected = mc.getBlocks(loc1, loc2);
+
+  SUBCASE("Matches uncached reads") {
+    Chunk first = cached.getBlocks(loc1, loc2);
+    Chunk second = cached.getBlocks(loc2, loc1);
+    CHECK(std::equal(expected.begin(), expected.end(), first.begin()));
+    CHECK(std::equal(expected.begin(), expected.end(), second.begin()));
+    CHECK_EQ(first.base_pt(), loc1);
+    CHECK_EQ(cached.getBlock(loc1), Blocks::GOLD_BLOCK);
+
+    CacheStats stats = cached.cacheStats();
+    CHECK_GT(stats.hits, 0);
+    CHECK_EQ(stats.misses, 4);
+  }
+
+  SUBCASE("Own writes are seen without refetching") {
+    CHECK_EQ(cached.getBlock(loc1), Blocks::GOLD_BLOCK);
+    cached.setBlock(loc1, Blocks::DIAMOND_BLOCK);
+    cached.setBlocks(loc1 + Coordinate(1, 0, 0), loc1 + Coordinate(3, 0, 0), Blocks::DIRT);
+    CHECK_EQ(cached.getBlock(loc1), Blocks::DIAMOND_BLOCK);
+    CHECK_EQ(cached.getBlock(loc1 + Coordinate(2, 0, 0)), Blocks::DIRT);
+    CHECK_EQ(cached.cacheStats().misses, 1);
+
+    // Written through to the server as well
+    cached.clearCache();
+    CHECK_EQ(cached.getBlock(loc1), Blocks::DIAMOND_BLOCK);
+  }
+
+  SUBCASE("Cleared cache sees other writers") {
+    CHECK_EQ(cached.getBlock(loc1), Blocks::GOLD_BLOCK);
+    mc.setBlock(loc1, Blocks::IRON_BLOCK);
+    // Round trip so the write has landed before the other connection reads
+    CHECK_EQ(mc.getBlock(loc1), Blocks::IRON_BLOCK);
+    cached.clearCache();
+    CHECK_EQ(cached.getBlock(loc1), Blocks::IRON_BLOCK);
+  }
+
+  mc.setBlocks(loc1, loc2, Blocks::AIR);
+}
+
+TEST_CASE("Shadow state write elision") {
+  MinecraftConnection shadowed;
+  shadowed.enableShadowState();
+  Coordinate loc1{240, 100, 240};
+  Coordinate loc2{250, 100, 250};
+  // Round trip so the clear has landed before shadowed writes
+  mc.setBlocks(loc1 - Coordinate(0, 1, 0), loc2 + Coordinate(0, 10, 0), Blocks::AIR);
+  CHECK_EQ(mc.getBlock(loc1), Blocks::AIR);
+
+  SUBCASE("Drops writes that change nothing") {
+    shadowed.setBlocks(loc1, loc2, Blocks::STONE);
+    shadowed.setBlocks(loc1, loc2, Blocks::STONE);
+    shadowed.setBlock(loc1, Blocks::STONE);
+    CHECK_EQ(shadowed.elidedWrites(), 2);
+
+    shadowed.setBlock(loc1, Blocks::GOLD_BLOCK);
+    shadowed.setBlocks(loc1, loc2, Blocks::STONE);
+    CHECK_EQ(shadowed.elidedWrites(), 2);
+    CHECK_EQ(shadowed.getBlock(loc1), Blocks::STONE);
+  }
+
+  SUBCASE("Remembers blocks it read") {
+    mc.setBlock(loc1, Blocks::DIRT);
+    CHECK_EQ(mc.getBlock(loc1), Blocks::DIRT);
+    shadowed.clearShadowState();
+    CHECK_EQ(shadowed.getBlock(loc1), Blocks::DIRT);
+    shadowed.setBlock(loc1, Blocks::DIRT);
+    CHECK_EQ(shadowed.elidedWrites(), 1);
+  }
+
+  SUBCASE("Heights of written columns are answered locally") {
+    shadowed.setBlocks(loc1, loc2, Blocks::STONE);
+    int height = shadowed.getHeight(loc1);
+    CHECK_EQ(height, loc1.y);
+    shadowed.setBlock(loc1 + Coordinate(0, 5, 0), Blocks::DIRT);
+    CHECK_EQ(shadowed.getHeight(loc1), loc1.y + 5);
+    shadowed.setBlock(loc1 + Coordinate(0, 5, 0), Blocks::AIR);
+    CHECK_EQ(shadowed.getHeight(loc1), loc1.y);
+
+    shadowed.clearShadowState();
+    CHECK_EQ(shadowed.getHeight(loc1), loc1.y);
+  }
+
+  // Round trip so this connection's writes have landed before it is closed,
+  // otherwise they can race the next subcase's connection. The block differs
+  // by subcase and only the call matters, it flushes the queued writes
+  static_cast<void>(shadowed.getBlock(loc1));
+  mc.setBlocks(loc1, loc2 + Coordinate(0, 10, 0), Blocks::AIR);
+  CHECK_EQ(mc.getBlock(loc1), Blocks::AIR);
+}
+
+TEST_CASE("Chunk commit") {
+  Coordinate loc1{260, 100, 260};
+  Coordinate loc2{269, 103, 267};
+  mc.setBlocks(loc1, loc2, Blocks::STONE);
+  Chunk chunk = mc.getBlocks(loc1, loc2);
+
+  SUBCASE("Merges changed blocks into boxes") {
+    for (int y = 0; y < 2; y++) {
+      for (int x = 2; x < 6; x++) {
+        for (int z = 1; z < 4; z++) {
+          chunk.set(x, y, z, Blocks::GOLD_BLOCK);
+        }
+      }
+    }
+    chunk.set_worldspace(loc2, Blocks::DIRT);
+    CHECK_EQ(chunk.dirty_count(), 2 * 4 * 3 + 1);
+    CHECK_EQ(chunk.commit(mc), 2);
+    CHECK_EQ(chunk.dirty_count(), 0);
+    CHECK_EQ(chunk.commit(mc), 0);
+
+    Chunk written = mc.getBlocks(loc1, loc2);
+    CHECK(std::equal(chunk.begin(), chunk.end(), written.begin()));
+  }
+
+  SUBCASE("Writes only changed blocks") {
+    chunk.set(0, 0, 0, Blocks::DIAMOND_BLOCK);
+    chunk.set(9, 3, 7, Blocks::DIAMOND_BLOCK);
+    // Another writer changes a block this chunk has not touched
+    mc.setBlock(loc1 + Coordinate(5, 2, 5), Blocks::DIRT);
+    CHECK_EQ(chunk.commit(mc), 2);
+
+    CHECK_EQ(mc.getBlock(loc1), Blocks::DIAMOND_BLOCK);
+    CHECK_EQ(mc.getBlock(loc2), Blocks::DIAMOND_BLOCK);
+    CHECK_EQ(mc.getBlock(loc1 + Coordinate(5, 2, 5)), Blocks::DIRT);
+  }
+
+  SUBCASE("Self-assignment keeps pending changes") {
+    chunk.set(1, 1, 1, Blocks::GOLD_BLOCK);
+    Chunk& alias = chunk;
+    chunk = alias;
+    CHECK_EQ(chunk.dirty_count(), 1);
+    CHECK_EQ(chunk.commit(mc), 1);
+    CHECK_EQ(mc.getBlock(loc1 + Coordinate(1, 1, 1)), Blocks::GOLD_BLOCK);
+  }
+
+  mc.setBlocks(loc1, loc2, Blocks::AIR);
+}
+
+TEST_CASE("Fetching into existing storage") {
+  Coordinate loc1{280, 100, 280};
+  Coordinate loc2{283, 102, 285};
+  mc.setBlocks(loc1, loc2, Blocks::STONE);
+  mc.setBlock(loc2, Blocks::GOLD_BLOCK);
+
+  SUBCASE("Blocks") {
+    Chunk chunk = mc.getBlocks(loc1, loc1);
+    mc.getBlocksInto(loc2, loc1, chunk);
+    Chunk expected = mc.getBlocks(loc1, loc2);
+    CHECK_EQ(chunk.base_pt(), loc1);
+    CHECK_EQ(chunk.z_len(), 6);
+    CHECK(std::equal(chunk.begin(), chunk.end(), expected.begin(), expected.end()));
+
+    // Same volume, so the storage is refilled in place
+    const BlockType* storage = chunk.data();
+    mc.setBlock(loc1, Blocks::DIRT);
+    mc.getBlocksInto(loc1, loc2, chunk);
+    CHECK_EQ(chunk.data(), storage);
+    CHECK_EQ(chunk.get_worldspace(loc1), Blocks::DIRT);
+    CHECK_EQ(chunk.get_worldspace(loc2), Blocks::GOLD_BLOCK);
+  }
+
+  SUBCASE("Fixed size blocks") {
+    auto board = mc.getBlocks<4, 3, 6>(loc1);
+    Chunk expected = mc.getBlocks(loc1, loc2);
+    CHECK_EQ(board.base_pt(), loc1);
+    CHECK(std::equal(board.begin(), board.end(), expected.begin(), expected.end()));
+    CHECK_EQ(board.get_worldspace(loc2), Blocks::GOLD_BLOCK);
+  }
+
+  SUBCASE("Heights") {
+    Coordinate2D corner1(loc1.x, loc1.z);
+    Coordinate2D corner2(loc2.x, loc2.z);
+    HeightMap heights = mc.getHeights(corner1, corner2);
+    const int16_t* storage = heights.data();
+    mc.getHeightsInto(corner2, corner1, heights);
+    HeightMap expected = mc.getHeights(corner1, corner2);
+    CHECK_EQ(heights.data(), storage);
+    CHECK(std::equal(heights.begin(), heights.end(), expected.begin(), expected.end()));
+  }
+
+  mc.setBlocks(loc1, loc2, Blocks::AIR);
+}
+
 // Requires player joined to server, will throw serverside if player is not
 // joined
 #ifdef PLAYER_TEST